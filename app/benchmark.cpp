@@ -0,0 +1,1112 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "culling.h"
+#include "gltf.h"
+#include "meshCodec.h"
+#include "meshOptimizer.h"
+#include "meshRegistry.h"
+#include "model.h"
+#include "noise.h"
+#include "perlin.h"
+#include "terrainGenerator.h"
+#include "threadPool.h"
+
+namespace App::Benchmark
+{
+namespace
+{
+// Fastest of nRuns calls to fn, in milliseconds
+template <typename F>
+double timeMs(F&& fn, const int nRuns = 3)
+{
+  double best = 1e30;
+
+  for (int i=0; i < nRuns; i++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end   = std::chrono::steady_clock::now();
+
+    best = std::min(
+      best, std::chrono::duration<double, std::milli>(end - start).count()
+    );
+  }
+
+  return best;
+}
+
+bool sameModelData(
+  const Excal::Model::ModelData& a,
+  const Excal::Model::ModelData& b
+) {
+  return a.indices  == b.indices
+      && a.vertices == b.vertices;
+}
+
+// Inverse of the octahedral encoding in packVertices
+glm::vec3 decodeOctahedral(const glm::vec2& encoded)
+{
+  glm::vec3 n(encoded.x, encoded.y, 0.0f);
+  n.z = 1.0f - std::abs(n.x) - std::abs(n.y);
+
+  const float t = std::max(-n.z, 0.0f);
+  n.x += n.x >= 0.0f ? -t : t;
+  n.y += n.y >= 0.0f ? -t : t;
+
+  return glm::normalize(n);
+}
+
+glm::vec3 decodeOctahedral(const int16_t encoded[2])
+{
+  return decodeOctahedral(glm::vec2(
+    std::max(encoded[0] / 32767.0f, -1.0f),
+    std::max(encoded[1] / 32767.0f, -1.0f)
+  ));
+}
+
+glm::vec3 decodeOctahedral(const int8_t encoded[2])
+{
+  return decodeOctahedral(glm::vec2(
+    std::max(encoded[0] / 127.0f, -1.0f),
+    std::max(encoded[1] / 127.0f, -1.0f)
+  ));
+}
+
+// Column and row of a vertex in its mesh's grid, as in terrainShaderHeight.vert
+glm::vec2 getGridPosition(const Excal::Model::Mesh& mesh, const int vertex)
+{
+  const int width  = mesh.gridWidth;
+  const int height = mesh.gridHeight;
+
+  if (vertex < width * height) {
+    return glm::vec2(vertex % width, vertex / width);
+  }
+
+  int skirt = vertex - width * height;
+
+  if (skirt < width) {
+    return glm::vec2(skirt, 0);
+  }
+  skirt -= width;
+
+  if (skirt < height) {
+    return glm::vec2(width - 1, skirt);
+  }
+  skirt -= height;
+
+  if (skirt < width) {
+    return glm::vec2(width - 1 - skirt, height - 1);
+  }
+  skirt -= width;
+
+  return glm::vec2(0, height - 1 - skirt);
+}
+}
+
+int run()
+{
+  benchmarkObjLoading("../models/helmet.obj");
+
+  // Large synthetic model, 2 million triangles
+  const std::string gridPath = "excal-benchmark-grid.obj";
+  writeGridObj(gridPath, 1000);
+  benchmarkObjLoading(gridPath);
+  std::remove(gridPath.c_str());
+
+  benchmarkWelding(
+    "../models/helmet.obj",
+    Excal::ObjParser::parseObj("../models/helmet.obj")
+  );
+
+  // 2237^2 quads is just over 10 million triangles
+  benchmarkWelding("10M triangle grid", makeGridObjData(2237));
+
+  benchmarkOverdraw("../models/helmet.obj");
+
+  benchmarkMeshletCulling(
+    "../models/helmet.obj", Excal::Model::loadModel("../models/helmet.obj")
+  );
+  benchmarkMeshletCulling("2M triangle sphere", makeSphereModelData(1000));
+
+  benchmarkVertexPacking(
+    "../models/helmet.obj", Excal::Model::loadModel("../models/helmet.obj")
+  );
+  benchmarkVertexPacking("2M triangle sphere", makeSphereModelData(1000));
+
+  benchmarkMeshRegistry("../models/helmet.obj", 500);
+
+  benchmarkGlbLoading(
+    "../models/helmet.obj", Excal::Model::loadModel("../models/helmet.obj"),
+    "../models/helmet.obj"
+  );
+
+  benchmarkMeshCodec(
+    "../models/helmet.obj", Excal::Model::loadModel("../models/helmet.obj")
+  );
+  benchmarkMeshCodec("2M triangle sphere", makeSphereModelData(1000));
+
+  writeGridObj(gridPath, 1000);
+  benchmarkGlbLoading("2M triangle grid", Excal::Model::loadModel(gridPath), gridPath);
+  std::remove(gridPath.c_str());
+
+  benchmarkPerlinNoise();
+  benchmarkNoiseBasis();
+  benchmarkTerrainGeneration();
+  benchmarkTerrainLod();
+  benchmarkHeightVertices();
+
+  return EXIT_SUCCESS;
+}
+
+void benchmarkObjLoading(const std::string& modelPath)
+{
+  std::ifstream file(modelPath, std::ios::ate | std::ios::binary);
+  const double fileMb = file.tellg() / (1024.0 * 1024.0);
+
+  Excal::Model::ModelData tinyObjData, excalData;
+
+  const double tinyObjMs = timeMs([&] {
+    tinyObjData = Excal::Model::loadModelTinyObj(modelPath);
+  });
+
+  const double excalMs = timeMs([&] {
+    excalData = Excal::Model::loadModel(modelPath);
+  });
+
+  printf("OBJ loading: %s (%.1f MB, %zu triangles)\n",
+    modelPath.c_str(), fileMb, excalData.indices.size() / 3
+  );
+  printf("  tinyobj    %9.2f ms  %8.1f MB/s\n", tinyObjMs, fileMb / tinyObjMs * 1000);
+  printf("  ObjParser  %9.2f ms  %8.1f MB/s  (%.2fx)\n",
+    excalMs, fileMb / excalMs * 1000, tinyObjMs / excalMs
+  );
+  printf("  Output %s\n",
+    sameModelData(tinyObjData, excalData) ? "matches" : "DIFFERS"
+  );
+}
+
+void benchmarkWelding(
+  const std::string&               name,
+  const Excal::ObjParser::ObjData& objData
+) {
+  Excal::Model::ModelData hashedData, tupleData;
+
+  const double hashedMs = timeMs([&] {
+    hashedData = Excal::Model::weldVerticesHashed(objData);
+  }, 1);
+
+  const double tupleMs = timeMs([&] {
+    tupleData = Excal::Model::weldVertices(objData);
+  }, 1);
+
+  const double nCorners = objData.corners.size();
+
+  printf("Vertex welding: %s (%zu corners, %zu vertices)\n",
+    name.c_str(), objData.corners.size(), tupleData.vertices.size()
+  );
+  printf("  Hashed vertices  %9.2f ms  %8.2f M corners/s\n",
+    hashedMs, nCorners / hashedMs / 1000
+  );
+  printf("  Index tuples     %9.2f ms  %8.2f M corners/s  (%.2fx)\n",
+    tupleMs, nCorners / tupleMs / 1000, hashedMs / tupleMs
+  );
+  printf("  Output %s\n",
+    sameModelData(hashedData, tupleData) ? "matches" : "DIFFERS"
+  );
+}
+
+void benchmarkOverdraw(const std::string& modelPath)
+{
+  const auto modelData = Excal::Model::loadModel(modelPath);
+  const auto& vertices = modelData.vertices;
+
+  auto cacheIndices = modelData.indices;
+  Excal::MeshOptimizer::optimizeVertexCache(cacheIndices, vertices.size());
+
+  auto overdrawIndices = cacheIndices;
+  Excal::MeshOptimizer::optimizeOverdraw(overdrawIndices, vertices, 1.05f);
+
+  printf("Overdraw: %s (%zu triangles)\n",
+    modelPath.c_str(), modelData.indices.size() / 3
+  );
+
+  const std::pair<const char*, const std::vector<uint32_t>*> orders[] = {
+    { "Original        ", &modelData.indices },
+    { "Vertex cache    ", &cacheIndices      },
+    { "Cache + overdraw", &overdrawIndices   },
+  };
+
+  for (const auto& [label, indices] : orders) {
+    const auto overdraw = Excal::MeshOptimizer::analyzeOverdraw(*indices, vertices);
+    const auto cache    = Excal::MeshOptimizer::analyzeVertexCache(
+      *indices, vertices.size()
+    );
+
+    printf("  %s  overdraw %.3f  ACMR %.3f\n",
+      label, overdraw.overdraw, cache.acmr
+    );
+  }
+}
+
+void benchmarkMeshletCulling(
+  const std::string&      name,
+  Excal::Model::ModelData modelData
+) {
+  auto& indices  = modelData.indices;
+  auto& vertices = modelData.vertices;
+
+  Excal::MeshOptimizer::optimizeVertexCache(indices, vertices.size());
+
+  std::vector<Excal::MeshOptimizer::Meshlet> meshlets;
+
+  const double buildMs = timeMs([&] {
+    meshlets = Excal::MeshOptimizer::buildMeshlets(
+      indices, vertices, 0, indices.size()
+    );
+  }, 1);
+
+  const glm::vec3 center    = (modelData.boundsMin + modelData.boundsMax) * 0.5f;
+  const float     size      = glm::length(modelData.boundsMax - modelData.boundsMin);
+  const glm::vec3 cameraPos = center + glm::vec3(0.0f, 0.0f, size * 0.6f);
+
+  auto proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, size * 4.0f);
+  proj[1][1] *= -1;
+
+  const auto view    = glm::lookAt(cameraPos, center, glm::vec3(0.0f, 1.0f, 0.0f));
+  const auto frustum = Excal::Culling::getFrustum(proj * view);
+
+  size_t frustumCulled  = 0;
+  size_t backfaceCulled = 0;
+
+  const double cullMs = timeMs([&] {
+    frustumCulled  = 0;
+    backfaceCulled = 0;
+
+    for (const auto& meshlet : meshlets) {
+      const glm::vec3 meshletCenter(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+
+      if (!Excal::Culling::isSphereInFrustum(frustum, meshletCenter, meshlet.radius)) {
+        frustumCulled += meshlet.indexCount / 3;
+      } else if (Excal::Culling::isMeshletBackfacing(meshlet, cameraPos)) {
+        backfaceCulled += meshlet.indexCount / 3;
+      }
+    }
+  });
+
+  const double nTriangles = indices.size() / 3;
+
+  printf("Meshlet culling: %s (%zu triangles, %zu meshlets)\n",
+    name.c_str(), indices.size() / 3, meshlets.size()
+  );
+  printf("  Build     %9.2f ms\n", buildMs);
+  printf("  Cull      %9.3f ms\n", cullMs);
+  printf("  Triangles culled by frustum %5.1f%%, by normal cone %5.1f%%\n",
+    100.0 * frustumCulled / nTriangles, 100.0 * backfaceCulled / nTriangles
+  );
+}
+
+void benchmarkVertexPacking(
+  const std::string&             name,
+  const Excal::Model::ModelData& modelData
+) {
+  const auto& vertices = modelData.vertices;
+
+  std::vector<PackedVertex>         packedVertices;
+  Excal::Model::VertexQuantization quantization;
+
+  const double packMs = timeMs([&] {
+    packedVertices = Excal::Model::packVertices(vertices, quantization);
+  });
+
+  float maxPosError    = 0.0f;
+  float maxNormalError = 0.0f; // Degrees
+
+  for (size_t i=0; i < vertices.size(); i++) {
+    const auto& packed = packedVertices[i];
+
+    const glm::vec3 pos = quantization.positionOffset + quantization.positionScale
+                        * glm::vec3(packed.pos[0], packed.pos[1], packed.pos[2])
+                        / 65535.0f;
+
+    maxPosError = std::max(maxPosError, glm::length(pos - vertices[i].pos));
+
+    if (glm::length(vertices[i].normal) > 0.0f) {
+      const float cosAngle = glm::dot(
+        decodeOctahedral(packed.normal), glm::normalize(vertices[i].normal)
+      );
+
+      maxNormalError = std::max(
+        maxNormalError,
+        glm::degrees(std::acos(std::clamp(cosAngle, -1.0f, 1.0f)))
+      );
+    }
+  }
+
+  const double floatMb  = vertices.size() * sizeof(Vertex)       / (1024.0 * 1024.0);
+  const double packedMb = vertices.size() * sizeof(PackedVertex) / (1024.0 * 1024.0);
+  const float  diagonal = glm::length(modelData.boundsMax - modelData.boundsMin);
+
+  printf("Vertex packing: %s (%zu vertices)\n", name.c_str(), vertices.size());
+  printf("  Vertex        %9.2f MB (%zu bytes per vertex)\n", floatMb,  sizeof(Vertex));
+  printf("  PackedVertex  %9.2f MB (%zu bytes per vertex), %.1fx smaller\n",
+    packedMb, sizeof(PackedVertex), floatMb / packedMb
+  );
+  printf("  Pack          %9.2f ms\n", packMs);
+  printf("  Max error: position %.2e of the bounds diagonal, normal %.3f degrees\n",
+    maxPosError / diagonal, maxNormalError
+  );
+}
+
+void benchmarkMeshRegistry(const std::string& modelPath, const int nModels)
+{
+  Excal::Model::ModelCreateInfo createInfo;
+  createInfo.modelPath                   = modelPath;
+  createInfo.options.optimizeVertexCache = true;
+  createInfo.options.lodCount            = 4;
+
+  std::vector<Excal::Model::Model> models;
+
+  // Registry is cleared so that every run loads the mesh
+  const double singleMs = timeMs([&] {
+    Excal::MeshRegistry::clear();
+    models = Excal::Model::createModels({ createInfo });
+  });
+
+  const double sharedMs = timeMs([&] {
+    Excal::MeshRegistry::clear();
+    models = Excal::Model::createModels(
+      std::vector<Excal::Model::ModelCreateInfo>(nModels, createInfo)
+    );
+  });
+
+  const auto& mesh = *models[0].mesh;
+  const double meshMb = (  mesh.vertices.size() * sizeof(Vertex)
+                         + mesh.indices.size()   * sizeof(uint32_t))
+                      / (1024.0 * 1024.0);
+
+  printf("Mesh registry: %s x %d\n", modelPath.c_str(), nModels);
+  printf("  1 model    %9.2f ms\n", singleMs);
+  printf("  %d models %9.2f ms, %zu mesh loaded\n",
+    nModels, sharedMs, Excal::MeshRegistry::getMeshCount()
+  );
+  printf("  Mesh memory %.2f MB, %.2f MB without sharing\n",
+    meshMb, meshMb * nModels
+  );
+
+  Excal::MeshRegistry::clear();
+}
+
+void benchmarkGlbLoading(
+  const std::string&             name,
+  const Excal::Model::ModelData& modelData,
+  const std::string&             objPath
+) {
+  const std::string glbPath = "excal-benchmark.glb";
+  writeGlb(glbPath, modelData);
+
+  // Stand-in for the mapped staging buffer, allocated once so that
+  // timings only include loading and writing vertices
+  std::vector<Vertex> staging(modelData.vertices.size());
+
+  const double objMs = timeMs([&] {
+    const auto objData = Excal::Model::loadModel(objPath);
+    std::copy(objData.vertices.begin(), objData.vertices.end(), staging.begin());
+  });
+
+  Excal::Model::Mesh mesh;
+
+  const double glbMs = timeMs([&] {
+    auto glb = Excal::Gltf::loadGlb(glbPath);
+
+    mesh.indices     = std::move(glb.indices);
+    mesh.glbVertices = std::move(glb.vertices);
+    Excal::Model::writeVertices(mesh, staging.data());
+  });
+
+  bool matches = mesh.indices == modelData.indices;
+  for (size_t i=0; i < staging.size(); i++) {
+    matches = matches && staging[i] == modelData.vertices[i];
+  }
+
+  printf("GLB loading: %s (%zu vertices)\n", name.c_str(), staging.size());
+  printf("  OBJ        %9.2f ms\n", objMs);
+  printf("  GLB        %9.2f ms  (%.2fx)\n", glbMs, objMs / glbMs);
+  printf("  Output %s\n", matches ? "matches" : "DIFFERS");
+
+  std::remove(glbPath.c_str());
+}
+
+void benchmarkMeshCodec(
+  const std::string&      name,
+  Excal::Model::ModelData modelData
+) {
+  // Vertices are compressed in the order they'd be stored in
+  Excal::Model::Mesh mesh;
+  mesh.indices  = std::move(modelData.indices);
+  mesh.vertices = std::move(modelData.vertices);
+
+  Excal::Model::ModelOptions options;
+  options.optimizeVertexCache = true;
+  options.optimizeVertexFetch = true;
+  Excal::Model::optimizeMesh(mesh, options);
+
+  Excal::Model::VertexQuantization quantization;
+  const auto packedVertices = Excal::Model::packVertices(mesh.vertices, quantization);
+
+  const auto encodedIndices = Excal::MeshCodec::encodeIndices(
+    mesh.indices.data(), mesh.indices.size()
+  );
+  const auto encodedVertices = Excal::MeshCodec::encodeVertices(
+    mesh.vertices.data(), mesh.vertices.size(), sizeof(Vertex)
+  );
+  const auto encodedPacked = Excal::MeshCodec::encodeVertices(
+    packedVertices.data(), packedVertices.size(), sizeof(PackedVertex)
+  );
+
+  const size_t indicesSize  = mesh.indices.size()   * sizeof(uint32_t);
+  const size_t verticesSize = mesh.vertices.size()  * sizeof(Vertex);
+  const size_t packedSize   = packedVertices.size() * sizeof(PackedVertex);
+
+  std::vector<uint32_t>     indices(mesh.indices.size());
+  std::vector<Vertex>       vertices(mesh.vertices.size());
+  std::vector<PackedVertex> packed(packedVertices.size());
+
+  printf("Mesh codec: %s (%zu vertices, %zu triangles)\n",
+    name.c_str(), mesh.vertices.size(), mesh.indices.size() / 3
+  );
+  printf("  Indices         %6.1f%% of %.2f MB\n",
+    100.0 * encodedIndices.size() / indicesSize, indicesSize / (1024.0 * 1024.0)
+  );
+  printf("  Vertex          %6.1f%% of %.2f MB\n",
+    100.0 * encodedVertices.size() / verticesSize, verticesSize / (1024.0 * 1024.0)
+  );
+  printf("  PackedVertex    %6.1f%% of %.2f MB\n",
+    100.0 * encodedPacked.size() / packedSize, packedSize / (1024.0 * 1024.0)
+  );
+
+  const bool simdEnabled = Excal::MeshCodec::isSimdEnabled();
+
+  // Throughput is measured in decoded bytes
+  for (const bool simd : { false, true }) {
+    Excal::MeshCodec::setSimdEnabled(simd);
+
+    if (simd && !Excal::MeshCodec::isSimdEnabled()) {
+      printf("  SIMD decoder isn't supported on this CPU\n");
+      break;
+    }
+
+    const double indicesMs = timeMs([&] {
+      Excal::MeshCodec::decodeIndices(
+        encodedIndices.data(), encodedIndices.size(), indices.size(), indices.data()
+      );
+    });
+    const double verticesMs = timeMs([&] {
+      Excal::MeshCodec::decodeVertices(
+        encodedVertices.data(), encodedVertices.size(),
+        vertices.size(), sizeof(Vertex), vertices.data()
+      );
+    });
+    const double packedMs = timeMs([&] {
+      Excal::MeshCodec::decodeVertices(
+        encodedPacked.data(), encodedPacked.size(),
+        packed.size(), sizeof(PackedVertex), packed.data()
+      );
+    });
+
+    const bool matches =
+         indices == mesh.indices
+      && memcmp(vertices.data(), mesh.vertices.data(), verticesSize) == 0
+      && memcmp(packed.data(),   packedVertices.data(), packedSize)  == 0;
+
+    printf("  %-6s decode   indices %5.2f GB/s, Vertex %5.2f GB/s, PackedVertex %5.2f GB/s, output %s\n",
+      simd ? "SIMD" : "scalar",
+      indicesSize  / indicesMs  / 1e6,
+      verticesSize / verticesMs / 1e6,
+      packedSize   / packedMs   / 1e6,
+      matches ? "matches" : "DIFFERS"
+    );
+  }
+
+  Excal::MeshCodec::setSimdEnabled(simdEnabled);
+}
+
+void benchmarkPerlinNoise()
+{
+  const size_t count = 1 << 20;
+
+  auto p = Perlin::get_permutation_vector();
+
+  const App::Noise::NoiseGenerator noise(App::Noise::perlinReferenceSeed);
+
+  // Pseudo random samples over several lattice periods, including negative
+  // coordinates, so every hash and floor path is covered
+  std::vector<float>  xs(count), ys(count), out(count);
+  std::vector<double> reference(count);
+
+  uint32_t state = 1;
+  auto random = [&state] {
+    state = state * 1664525 + 1013904223;
+    return (state >> 8) / float(1 << 24);
+  };
+
+  for (size_t i=0; i < count; i++) {
+    xs[i] = random() * 1024.0f - 512.0f;
+    ys[i] = random() * 1024.0f - 512.0f;
+  }
+
+  const double referenceMs = timeMs([&] {
+    for (size_t i=0; i < count; i++) {
+      reference[i] = Perlin::perlin_noise(xs[i], ys[i], p);
+    }
+  });
+
+  printf("Perlin noise: %zu samples, tolerance %.1e\n", count, App::Noise::perlinNoiseTolerance);
+  printf("  %-10s %9.2f M samples/s\n", "reference", count / referenceMs / 1e3);
+
+  for (const auto kernel : {
+    App::Noise::Kernel::eScalar, App::Noise::Kernel::eSse41, App::Noise::Kernel::eAvx2
+  }) {
+    const bool supported = kernel == App::Noise::Kernel::eScalar
+                        || int(kernel) <= int(App::Noise::getBestKernel());
+
+    if (!supported) {
+      printf("  %-10s isn't supported on this CPU\n", App::Noise::getKernelName(kernel));
+      continue;
+    }
+
+    const double kernelMs = timeMs([&] {
+      noise.perlinNoise(xs.data(), ys.data(), out.data(), count, kernel);
+    });
+
+    // Difference from the reference, computed in double precision
+    double maxError = 0;
+    for (size_t i=0; i < count; i++) {
+      maxError = std::max(maxError, std::abs(double(out[i]) - reference[i]));
+    }
+
+    printf("  %-10s %9.2f M samples/s  (%.2fx), max error %.2e\n",
+      App::Noise::getKernelName(kernel), count / kernelMs / 1e3,
+      referenceMs / kernelMs, maxError
+    );
+  }
+
+  const double chunkMs = timeMs([&] {
+    App::TerrainGenerator::generateNoiseMap(0, 0, 128, 128, noise);
+  });
+
+  printf("  128x128 chunk, 5 octaves %9.2f ms with %s\n",
+    chunkMs, App::Noise::getKernelName(App::Noise::Kernel::eAuto)
+  );
+}
+
+void benchmarkNoiseBasis()
+{
+  const size_t count = 1 << 20;
+
+  std::vector<float> xs(count), ys(count), out(count);
+
+  uint32_t state = 1;
+  auto random = [&state] {
+    state = state * 1664525 + 1013904223;
+    return (state >> 8) / float(1 << 24);
+  };
+
+  for (size_t i=0; i < count; i++) {
+    xs[i] = random() * 1024.0f - 512.0f;
+    ys[i] = random() * 1024.0f - 512.0f;
+  }
+
+  printf("Noise basis: %zu samples\n", count);
+
+  for (const auto basis : {
+    App::Noise::Basis::ePerlin3dSlice, App::Noise::Basis::eGradient2d
+  }) {
+    printf("  %s\n", App::Noise::getBasisName(basis));
+
+    App::Noise::FractalOptions options;
+    options.basis = basis;
+
+    const App::Noise::NoiseGenerator noise(App::Noise::perlinReferenceSeed, options);
+
+    for (const auto kernel : {
+      App::Noise::Kernel::eScalar, App::Noise::Kernel::eSse41, App::Noise::Kernel::eAvx2
+    }) {
+      if (int(kernel) > int(App::Noise::getBestKernel())) {
+        continue;
+      }
+
+      const double kernelMs = timeMs([&] {
+        noise.noise(basis, xs.data(), ys.data(), out.data(), count, kernel);
+      });
+
+      printf("    %-10s %9.2f M samples/s\n",
+        App::Noise::getKernelName(kernel), count / kernelMs / 1e3
+      );
+    }
+
+    std::vector<float> noiseMap;
+    const double chunkMs = timeMs([&] {
+      noiseMap = App::TerrainGenerator::generateNoiseMap(0, 0, 128, 128, noise);
+    });
+
+    double sum = 0, sumSquares = 0;
+    float  minHeight = noiseMap[0], maxHeight = noiseMap[0];
+
+    for (const float height : noiseMap) {
+      sum        += height;
+      sumSquares += height * height;
+      minHeight   = std::min(minHeight, height);
+      maxHeight   = std::max(maxHeight, height);
+    }
+
+    const double mean = sum / noiseMap.size();
+
+    printf("    128x128 chunk, 5 octaves %7.2f ms, heights %.3f to %.3f, mean %.3f, std dev %.3f\n",
+      chunkMs, minHeight, maxHeight, mean,
+      std::sqrt(sumSquares / noiseMap.size() - mean * mean)
+    );
+  }
+}
+
+void benchmarkTerrainGeneration()
+{
+  App::Noise::FractalOptions options;
+  options.basis = App::Noise::Basis::eGradient2d;
+
+  const App::Noise::NoiseGenerator noise(1234, options);
+
+  printf("Terrain generation: %zu threads\n", Excal::getThreadPool().getThreadCount());
+
+  for (const int mapSize : { 2, 4, 16 }) {
+    std::vector<Excal::Model::Model> chunks;
+
+    const double mapMs = timeMs([&] {
+      chunks = App::TerrainGenerator::generateMap(
+        mapSize, mapSize, 128, 128, 0.1, 32, noise
+      );
+    }, 1);
+
+    // Chunks are compared against generating the first row serially
+    const auto topology = App::TerrainGenerator::generateChunkTopology(128, 128);
+
+    bool matches = true;
+
+    for (int xPos = 0; xPos < mapSize; xPos++) {
+      const auto chunk = App::TerrainGenerator::generateMapChunk(
+        xPos, 0, mapSize, mapSize, 128, 128, 0.1, 32, noise, topology
+      );
+
+      matches = matches
+        && Excal::Model::getIndices(*chunk.mesh) == Excal::Model::getIndices(*chunks[xPos].mesh)
+        && chunk.mesh->vertices == chunks[xPos].mesh->vertices;
+    }
+
+    // Index memory the engine uploads, since chunks share their indices
+    std::vector<const std::vector<uint32_t>*> indexArrays;
+    size_t indexBytes = 0, unsharedIndexBytes = 0;
+
+    for (const auto& chunk : chunks) {
+      const auto& indices = Excal::Model::getIndices(*chunk.mesh);
+
+      unsharedIndexBytes += indices.size() * sizeof(uint16_t);
+
+      if (std::find(indexArrays.begin(), indexArrays.end(), &indices) == indexArrays.end()) {
+        indexArrays.push_back(&indices);
+        indexBytes += indices.size() * sizeof(uint16_t);
+      }
+    }
+
+    printf("  %2dx%-2d map of 128x128 chunks %9.2f ms  (%.2f ms per chunk), output %s\n",
+      mapSize, mapSize, mapMs, mapMs / (mapSize * mapSize),
+      matches ? "matches" : "DIFFERS"
+    );
+    printf("        index memory %.2f MB, %.2f MB without sharing\n",
+      indexBytes / (1024.0 * 1024.0), unsharedIndexBytes / (1024.0 * 1024.0)
+    );
+  }
+
+  // A single large chunk is split into bands of rows, which must match
+  // generating every row on one thread
+  std::vector<float> noiseMap;
+
+  const double noiseMapMs = timeMs([&] {
+    noiseMap = App::TerrainGenerator::generateNoiseMap(0, 0, 2048, 2048, noise);
+  }, 1);
+
+  std::vector<float> serialNoiseMap(noiseMap.size());
+
+  for (int y=0; y < 2048; y++) {
+    noise.fractalNoiseRow(0, y, 2048, serialNoiseMap.data() + y*2048);
+  }
+
+  printf("  2048x2048 noise map %9.2f ms, output %s\n", noiseMapMs,
+    noiseMap == serialNoiseMap ? "matches" : "DIFFERS"
+  );
+}
+
+void benchmarkTerrainLod()
+{
+  App::Noise::FractalOptions options;
+  options.basis = App::Noise::Basis::eGradient2d;
+
+  const App::Noise::NoiseGenerator noise(1234, options);
+
+  Excal::Model::ModelOptions modelOptions;
+  modelOptions.lodCount = 6;
+
+  const int mapSize   = 16;
+  const int chunkSize = 129;
+
+  std::vector<Excal::Model::Model> chunks;
+
+  const double mapMs = timeMs([&] {
+    chunks = App::TerrainGenerator::generateMap(
+      mapSize, mapSize, chunkSize, chunkSize, 0.1, 32, noise, modelOptions
+    );
+  }, 1);
+
+  // Camera above the middle of the map, in a 1440x900 window with the
+  // engine's 45 degree field of view
+  const float     mapWidth      = mapSize * (chunkSize - 1);
+  const glm::vec3 cameraPos     = glm::vec3(mapWidth / 2, 70, mapWidth / 2);
+  const float     pixelsPerUnit = 900 / 2.0f / std::tan(glm::radians(45.0f) / 2);
+
+  printf("Terrain LOD: %dx%d map of %dx%d chunks, %zu LODs (%.2f ms)\n",
+    mapSize, mapSize, chunkSize, chunkSize,
+    chunks[0].mesh->lods.size(), mapMs
+  );
+
+  for (const float viewDistance : { 128.0f, 256.0f, 512.0f, 1024.0f }) {
+    for (const float maxPixelError : { 1.0f, 4.0f, 8.0f }) {
+      size_t fullTriangles = 0;
+      size_t lodTriangles  = 0;
+
+      for (const auto& chunk : chunks) {
+        const auto& mesh = *chunk.mesh;
+
+        if (glm::length(mesh.boundsCenter - cameraPos) - mesh.boundingRadius > viewDistance) {
+          continue;
+        }
+
+        fullTriangles += mesh.lods[0].indexCount / 3;
+        lodTriangles  += Excal::Model::selectLod(
+          chunk, cameraPos, pixelsPerUnit, maxPixelError
+        ).indexCount / 3;
+      }
+
+      printf("  View distance %5.0f, %.0f pixel error  %9zu triangles, %9zu with LODs\n",
+        viewDistance, maxPixelError, fullTriangles, lodTriangles
+      );
+    }
+  }
+}
+
+void benchmarkHeightVertices()
+{
+  App::Noise::FractalOptions options;
+  options.basis = App::Noise::Basis::eGradient2d;
+
+  const App::Noise::NoiseGenerator noise(1234, options);
+
+  // Vertices stay in grid order, as they must for height vertices
+  Excal::Model::ModelOptions modelOptions;
+  modelOptions.lodCount = 6;
+
+  const int mapSize   = 8;
+  const int chunkSize = 129;
+
+  const auto chunks = App::TerrainGenerator::generateMap(
+    mapSize, mapSize, chunkSize, chunkSize, 0.1, 32, noise, modelOptions
+  );
+
+  size_t vertexCount    = 0;
+  float  maxPosError    = 0.0f;
+  float  maxNormalError = 0.0f; // Degrees
+
+  std::vector<HeightVertex> heightVertices;
+
+  const double packMs = timeMs([&] {
+    for (const auto& chunk : chunks) {
+      const auto& mesh = *chunk.mesh;
+
+      heightVertices.resize(Excal::Model::getVertexCount(mesh));
+      Excal::Model::writeHeightVertices(
+        mesh, Excal::Model::getHeightQuantization(mesh), heightVertices.data()
+      );
+    }
+  }, 1);
+
+  for (const auto& chunk : chunks) {
+    const auto& mesh         = *chunk.mesh;
+    const auto  quantization = Excal::Model::getHeightQuantization(mesh);
+
+    heightVertices.resize(Excal::Model::getVertexCount(mesh));
+    Excal::Model::writeHeightVertices(mesh, quantization, heightVertices.data());
+
+    for (size_t i=0; i < mesh.vertices.size(); i++) {
+      const auto&     vertex       = mesh.vertices[i];
+      const glm::vec2 gridPosition = getGridPosition(mesh, i);
+
+      const glm::vec3 pos = quantization.positionOffset + quantization.positionScale
+                          * glm::vec3(
+                              gridPosition.x,
+                              heightVertices[i].height / 65535.0f,
+                              gridPosition.y
+                            );
+
+      maxPosError = std::max(maxPosError, glm::length(pos - vertex.pos));
+
+      const float cosAngle = glm::dot(
+        decodeOctahedral(heightVertices[i].normal), glm::normalize(vertex.normal)
+      );
+
+      maxNormalError = std::max(
+        maxNormalError,
+        glm::degrees(std::acos(std::clamp(cosAngle, -1.0f, 1.0f)))
+      );
+    }
+
+    vertexCount += mesh.vertices.size();
+  }
+
+  const double floatMb  = vertexCount * sizeof(Vertex)       / (1024.0 * 1024.0);
+  const double packedMb = vertexCount * sizeof(PackedVertex) / (1024.0 * 1024.0);
+  const double heightMb = vertexCount * sizeof(HeightVertex) / (1024.0 * 1024.0);
+
+  printf("Height vertices: %dx%d map of %dx%d chunks (%zu vertices)\n",
+    mapSize, mapSize, chunkSize, chunkSize, vertexCount
+  );
+  printf("  Vertex        %9.2f MB (%zu bytes per vertex)\n", floatMb,  sizeof(Vertex));
+  printf("  PackedVertex  %9.2f MB (%zu bytes per vertex), %.1fx smaller\n",
+    packedMb, sizeof(PackedVertex), floatMb / packedMb
+  );
+  printf("  HeightVertex  %9.2f MB (%zu bytes per vertex), %.1fx smaller\n",
+    heightMb, sizeof(HeightVertex), floatMb / heightMb
+  );
+  printf("  Pack          %9.2f ms\n", packMs);
+  printf("  Max error: position %.2e units, normal %.3f degrees\n",
+    maxPosError, maxNormalError
+  );
+}
+
+Excal::Model::ModelData makeSphereModelData(const int segments)
+{
+  Excal::Model::ModelData modelData;
+
+  const float pi = 3.14159265f;
+
+  for (int y = 0; y <= segments; y++) {
+    for (int x = 0; x <= segments; x++) {
+      const float u = x / float(segments);
+      const float v = y / float(segments);
+
+      Vertex vertex{};
+      vertex.pos = glm::vec3(
+        sin(v * pi) * cos(u * 2 * pi),
+        cos(v * pi),
+        sin(v * pi) * sin(u * 2 * pi)
+      );
+      vertex.color    = glm::vec3(1.0f);
+      vertex.normal   = vertex.pos;
+      vertex.texCoord = glm::vec2(u, v);
+
+      modelData.vertices.push_back(vertex);
+    }
+  }
+
+  // Counterclockwise seen from outside
+  for (int y = 0; y < segments; y++) {
+    for (int x = 0; x < segments; x++) {
+      uint32_t i = y * (segments + 1) + x;
+      uint32_t j = i + segments + 1;
+
+      for (uint32_t index : { i, i+1, j, j, i+1, j+1 }) {
+        modelData.indices.push_back(index);
+      }
+    }
+  }
+
+  modelData.boundsMin = glm::vec3(-1.0f);
+  modelData.boundsMax = glm::vec3( 1.0f);
+
+  return modelData;
+}
+
+Excal::ObjParser::ObjData makeGridObjData(const int gridSize)
+{
+  Excal::ObjParser::ObjData objData;
+
+  const int nVertices = gridSize + 1;
+
+  for (int y = 0; y < nVertices; y++) {
+    for (int x = 0; x < nVertices; x++) {
+      objData.positions.push_back(x * 0.01f);
+      objData.positions.push_back((x * y % 7) * 0.001f);
+      objData.positions.push_back(y * 0.01f);
+
+      objData.texcoords.push_back(x / float(gridSize));
+      objData.texcoords.push_back(y / float(gridSize));
+    }
+  }
+
+  for (int y = 0; y < gridSize; y++) {
+    for (int x = 0; x < gridSize; x++) {
+      int32_t i = y * nVertices + x;
+      int32_t j = i + nVertices;
+
+      for (int32_t corner : { i, j, j+1, i, j+1, i+1 }) {
+        objData.corners.push_back({ corner, corner, -1 });
+      }
+    }
+  }
+
+  return objData;
+}
+
+void writeGridObj(const std::string& path, const int gridSize)
+{
+  std::ofstream file(path);
+
+  const int nVertices = gridSize + 1;
+
+  for (int y = 0; y < nVertices; y++) {
+    for (int x = 0; x < nVertices; x++) {
+      file << "v " << x * 0.01f << " " << (x * y % 7) * 0.001f << " " << y * 0.01f << "\n";
+    }
+  }
+
+  for (int y = 0; y < nVertices; y++) {
+    for (int x = 0; x < nVertices; x++) {
+      file << "vt " << x / float(gridSize) << " " << y / float(gridSize) << "\n";
+    }
+  }
+
+  for (int y = 0; y < gridSize; y++) {
+    for (int x = 0; x < gridSize; x++) {
+      int i = y * nVertices + x + 1;
+      int j = i + nVertices;
+
+      file << "f " << i   << "/" << i   << " " << j   << "/" << j   << " "
+                   << j+1 << "/" << j+1 << " " << i+1 << "/" << i+1 << "\n";
+    }
+  }
+}
+
+void writeGlb(const std::string& path, const Excal::Model::ModelData& modelData)
+{
+  const size_t vertexCount = modelData.vertices.size();
+  const size_t indexCount  = modelData.indices.size();
+
+  // Attributes are stored one after another, each in its own buffer view
+  struct Attribute {
+    const char* name;
+    const char* type;
+    size_t      components;
+  };
+  const Attribute attributes[] = {
+    { "POSITION",   "VEC3", 3 },
+    { "NORMAL",     "VEC3", 3 },
+    { "TEXCOORD_0", "VEC2", 2 },
+    { "TANGENT",    "VEC4", 4 }
+  };
+
+  std::vector<float> attributeData;
+  std::vector<size_t> attributeOffsets;
+
+  glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+  if (vertexCount > 0) {
+    boundsMin = boundsMax = modelData.vertices[0].pos;
+  }
+  for (const auto& vertex : modelData.vertices) {
+    boundsMin = glm::min(boundsMin, vertex.pos);
+    boundsMax = glm::max(boundsMax, vertex.pos);
+  }
+
+  for (const auto& attribute : attributes) {
+    attributeOffsets.push_back(attributeData.size() * sizeof(float));
+
+    for (const auto& vertex : modelData.vertices) {
+      const float* values =
+          attribute.components == 2 ? &vertex.texCoord.x
+        : attribute.components == 4 ? &vertex.tangent.x
+        : attribute.name[0] == 'P'  ? &vertex.pos.x
+                                    : &vertex.normal.x;
+
+      attributeData.insert(attributeData.end(), values, values + attribute.components);
+    }
+  }
+
+  const size_t indexOffset = attributeData.size() * sizeof(float);
+  const size_t binSize     = indexOffset + indexCount * sizeof(uint32_t);
+
+  std::ostringstream json;
+  json.precision(9);
+  json << "{\"asset\":{\"version\":\"2.0\"},"
+       << "\"buffers\":[{\"byteLength\":" << binSize << "}],"
+       << "\"bufferViews\":[";
+
+  for (size_t i=0; i < 4; i++) {
+    json << "{\"buffer\":0,\"byteOffset\":" << attributeOffsets[i]
+         << ",\"byteLength\":" << vertexCount * attributes[i].components * sizeof(float)
+         << "},";
+  }
+  json << "{\"buffer\":0,\"byteOffset\":" << indexOffset
+       << ",\"byteLength\":" << indexCount * sizeof(uint32_t) << "}],"
+       << "\"accessors\":[";
+
+  for (size_t i=0; i < 4; i++) {
+    json << "{\"bufferView\":" << i << ",\"componentType\":5126,\"count\":"
+         << vertexCount << ",\"type\":\"" << attributes[i].type << "\"";
+
+    if (i == 0) {
+      json << ",\"min\":[" << boundsMin.x << "," << boundsMin.y << "," << boundsMin.z
+           << "],\"max\":[" << boundsMax.x << "," << boundsMax.y << "," << boundsMax.z
+           << "]";
+    }
+    json << "},";
+  }
+  json << "{\"bufferView\":4,\"componentType\":5125,\"count\":" << indexCount
+       << ",\"type\":\"SCALAR\"}],"
+       << "\"meshes\":[{\"primitives\":[{\"attributes\":{";
+
+  for (size_t i=0; i < 4; i++) {
+    json << (i ? "," : "") << "\"" << attributes[i].name << "\":" << i;
+  }
+  json << "},\"indices\":4}]}]}";
+
+  // Chunks are padded to 4 bytes, the JSON chunk with spaces
+  std::string jsonChunk = json.str();
+  jsonChunk.resize((jsonChunk.size() + 3) & ~size_t(3), ' ');
+
+  auto writeU32 = [](std::ofstream& file, const uint32_t value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+
+  std::ofstream file(path, std::ios::binary);
+
+  writeU32(file, 0x46546C67); // "glTF"
+  writeU32(file, 2);
+  writeU32(file, 12 + 8 + jsonChunk.size() + 8 + binSize);
+
+  writeU32(file, jsonChunk.size());
+  writeU32(file, 0x4E4F534A); // "JSON"
+  file.write(jsonChunk.data(), jsonChunk.size());
+
+  writeU32(file, binSize);
+  writeU32(file, 0x004E4942); // "BIN\0"
+  file.write(reinterpret_cast<const char*>(attributeData.data()), indexOffset);
+  file.write(
+    reinterpret_cast<const char*>(modelData.indices.data()),
+    indexCount * sizeof(uint32_t)
+  );
+}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+
+#include "model.h"
+#include "objParser.h"
+
+// Timings for the engine's CPU side loading and generation code
+// Results are printed to stdout
+namespace App::Benchmark
+{
+int run();
+
+// Compares Excal::ObjParser against tinyobjloader on the same OBJ file
+void benchmarkObjLoading(const std::string& modelPath);
+
+// Compares index tuple welding against hashing full vertices
+void benchmarkWelding(
+  const std::string&               name,
+  const Excal::ObjParser::ObjData& objData
+);
+
+// Prints overdraw and vertex cache ACMR of a model's original triangle
+// order, after optimizeVertexCache, and after optimizeOverdraw as well
+void benchmarkOverdraw(const std::string& modelPath);
+
+// Meshlet build time, and the triangles that frustum and normal cone culling
+// skip with the camera close to the model, looking at its center
+void benchmarkMeshletCulling(
+  const std::string&      name,
+  Excal::Model::ModelData modelData
+);
+
+// Vertex buffer size of Vertex against PackedVertex, the time to pack,
+// and the largest position and normal errors of the packed vertices
+void benchmarkVertexPacking(
+  const std::string&             name,
+  const Excal::Model::ModelData& modelData
+);
+
+// Loads nModels copies of a model with createModels, and compares the time
+// and mesh memory against loading a single copy
+void benchmarkMeshRegistry(const std::string& modelPath, const int nModels);
+
+// Compares loading an OBJ file and copying its vertices to a staging
+// buffer, against loading the same model from a GLB file and writing
+// vertices from the mapped file straight to the staging buffer
+void benchmarkGlbLoading(
+  const std::string&             name,
+  const Excal::Model::ModelData& modelData,
+  const std::string&             objPath
+);
+
+// Compressed size of an optimized mesh's indices, vertices, and packed
+// vertices, and decoding throughput with the SIMD and scalar decoders
+void benchmarkMeshCodec(
+  const std::string&      name,
+  Excal::Model::ModelData modelData
+);
+
+// Perlin noise samples per second with the double precision reference and
+// each batched kernel, the largest difference from the reference, and the
+// time to generate a terrain chunk's noise map
+void benchmarkPerlinNoise();
+
+// Compares 2D gradient noise against the 3D Perlin slice, in samples per
+// second with each kernel, the time to generate a terrain chunk's noise
+// map, and the spread of the noise map's heights
+void benchmarkNoiseBasis();
+
+// Time to generate terrain maps of a few sizes on the thread pool, and
+// whether the chunks match generating them serially
+void benchmarkTerrainGeneration();
+
+// Triangles drawn by a map of chunks with and without geomipmapped LODs,
+// seen from the middle of the map, out to a few view distances
+void benchmarkTerrainLod();
+
+// Vertex buffer size of terrain chunks with Vertex, PackedVertex and
+// HeightVertex, and the largest position and normal errors of height
+// vertices placed on their grid the way terrainShaderHeight.vert does
+void benchmarkHeightVertices();
+
+// UV sphere of radius 1 with segments x segments quads
+Excal::Model::ModelData makeSphereModelData(const int segments);
+
+// Parsed OBJ data of a gridSize x gridSize quad grid with texcoords
+Excal::ObjParser::ObjData makeGridObjData(const int gridSize);
+
+// Writes a GLB file with one primitive holding modelData's positions,
+// normals, texture coordinates, tangents, and indices
+void writeGlb(const std::string& path, const Excal::Model::ModelData& modelData);
+
+// Writes an OBJ file of a gridSize x gridSize quad grid with texcoords
+void writeGridObj(const std::string& path, const int gridSize);
+}
@@ -2,9 +2,13 @@
 
 #include "modelViewer.h"
 #include "terrainGenerator.h"
+#include "benchmark.h"
 
 int main()
 {
+  // Uncomment to print CPU side benchmarks instead of running an app
+  //return App::Benchmark::run();
+
   Excal::Engine excal;
 
   auto config = excal.createEngineConfig();
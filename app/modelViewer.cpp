@@ -1,5 +1,6 @@
 #include "modelViewer.h"
 
+#include "assetPack.h"
 #include "model.h"
 #include "engine.h"
 
@@ -8,30 +9,46 @@ namespace App::ModelViewer
 void run(
   Excal::Engine::EngineConfig& config
 ) {
-  auto model1 = Excal::Model::createModel(
-    "../models/wall.obj",
-    glm::vec3(-1.0, 0.0, 0.0), 1.0,
-    "../textures/wall_diffuse.jpg",
-    "../textures/wall_normal.jpg"
-  );
+  Excal::Model::ModelOptions modelOptions;
+  modelOptions.optimizeVertexCache = true;
+  modelOptions.optimizeOverdraw    = true;
+  modelOptions.optimizeVertexFetch = true;
+  modelOptions.printStats          = false; // Runs each pass' analysis, for tuning
+  modelOptions.lodCount            = 4;
+  modelOptions.buildMeshlets       = true;
 
-  auto model2 = Excal::Model::createModel(
-    "../models/wall.obj",
-    glm::vec3(0.0, 0.0, 0.0), 1.0,
-    "../textures/wall_diffuse.jpg",
-    "../textures/wall_normal.jpg"
-  );
+  // Meshes and textures baked with excal-bake are read from the pack,
+  // if it exists, instead of being loaded from their source files
+  Excal::AssetPack::mount("excal-assets.pack");
 
-  auto model3 = Excal::Model::createModel(
-    "../models/wall.obj",
-    glm::vec3(1.0, 0.0, 0.0), 1.0,
-    "../textures/wall_diffuse.jpg",
-    "../textures/wall_normal.jpg"
-  );
+  // Models are loaded in parallel, and returned in the same order
+  auto models = Excal::Model::createModels({
+    {
+      "../models/wall.obj",
+      glm::vec3(-1.0, 0.0, 0.0), 1.0,
+      "../textures/wall_diffuse.jpg",
+      "../textures/wall_normal.jpg",
+      modelOptions
+    },
+    {
+      "../models/wall.obj",
+      glm::vec3(0.0, 0.0, 0.0), 1.0,
+      "../textures/wall_diffuse.jpg",
+      "../textures/wall_normal.jpg",
+      modelOptions
+    },
+    {
+      "../models/wall.obj",
+      glm::vec3(1.0, 0.0, 0.0), 1.0,
+      "../textures/wall_diffuse.jpg",
+      "../textures/wall_normal.jpg",
+      modelOptions
+    }
+  });
 
   config.windowWidth             = 1440*0.9;
   config.windowHeight            = 900 *0.9;
-  config.models                  = { model1, model2, model3 };
+  config.models                  = models;
   config.vertShaderPath          = "../shaders/shader.vert.spv";
   config.fragShaderPath          = "../shaders/shader.frag.spv";
   config.camera.movementSpeed    = 1.5f;
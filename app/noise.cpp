@@ -0,0 +1,722 @@
+#include "noise.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "perlin.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define APP_NOISE_SIMD
+  #include <immintrin.h>
+
+  // SIMD kernels are compiled for their instruction set without raising
+  // the baseline of the whole build, and are only called after checking
+  // the CPU has it. FMA isn't enabled, so every kernel rounds the same way
+  #if defined(__GNUC__)
+    #define APP_TARGET_SSE41 __attribute__((target("sse4.1")))
+    #define APP_TARGET_AVX2  __attribute__((target("avx2")))
+  #else
+    #define APP_TARGET_SSE41
+    #define APP_TARGET_AVX2
+  #endif
+#endif
+
+namespace App::Noise
+{
+namespace
+{
+// Perlin::perlin_noise samples the z = 0.5 slice of 3D noise, so z is
+// constant and its fade curve is fade(0.5) = 0.5
+const float sliceZ    = 0.5f;
+const float sliceFade = 0.5f;
+
+// Scales 2D noise to the same standard deviation as the 3D slice, so
+// heightmaps built from either have the same range
+const float gradient2dScale = 0.58f;
+
+float fade(const float t)
+{
+  return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+float lerp(const float t, const float a, const float b)
+{
+  return a + t * (b - a);
+}
+
+// Same gradients as Perlin::grad, with the sign flips done on sign bits
+float grad(const int hash, const float x, const float y, const float z)
+{
+  const int h = hash & 15;
+
+  float u = h < 8 ? x : y;
+  float v = h < 4 ? y : (h == 12 || h == 14) ? x : z;
+
+  uint32_t uBits, vBits;
+  memcpy(&uBits, &u, 4);
+  memcpy(&vBits, &v, 4);
+
+  uBits ^= uint32_t(h & 1) << 31;
+  vBits ^= uint32_t(h & 2) << 30;
+
+  memcpy(&u, &uBits, 4);
+  memcpy(&v, &vBits, 4);
+
+  return u + v;
+}
+
+float perlinScalar(float x, float y, const uint8_t* p)
+{
+  const float xFloor = std::floor(x);
+  const float yFloor = std::floor(y);
+
+  const int X = int(xFloor) & 255;
+  const int Y = int(yFloor) & 255;
+
+  x -= xFloor;
+  y -= yFloor;
+
+  const float u = fade(x);
+  const float v = fade(y);
+
+  const int A  = p[X  ] + Y, AA = p[A], AB = p[A+1];
+  const int B  = p[X+1] + Y, BA = p[B], BB = p[B+1];
+  const float z = sliceZ;
+
+  return lerp(sliceFade, lerp(v, lerp(u, grad(p[AA  ], x,    y,    z     ),
+                                         grad(p[BA  ], x-1.f, y,    z     )),
+                                 lerp(u, grad(p[AB  ], x,    y-1.f, z     ),
+                                         grad(p[BB  ], x-1.f, y-1.f, z     ))),
+                         lerp(v, lerp(u, grad(p[AA+1], x,    y,    z-1.f),
+                                         grad(p[BA+1], x-1.f, y,    z-1.f)),
+                                 lerp(u, grad(p[AB+1], x,    y-1.f, z-1.f),
+                                         grad(p[BB+1], x-1.f, y-1.f, z-1.f))));
+}
+
+void perlinScalarBatch(
+  const float*   x,
+  const float*   y,
+  float*         out,
+  const size_t   count,
+  const uint8_t* p
+) {
+  for (size_t i=0; i < count; i++) {
+    out[i] = perlinScalar(x[i], y[i], p);
+  }
+}
+
+// 8 gradient directions, (+-1, +-2) and (+-2, +-1), picked by the low 3
+// bits of the hash, with the sign flips done on sign bits
+float grad2d(const int hash, const float x, const float y)
+{
+  const int h = hash & 7;
+
+  float u = h < 4 ? x : y;
+  float v = h < 4 ? y : x;
+  v += v;
+
+  uint32_t uBits, vBits;
+  memcpy(&uBits, &u, 4);
+  memcpy(&vBits, &v, 4);
+
+  uBits ^= uint32_t(h & 1) << 31;
+  vBits ^= uint32_t(h & 2) << 30;
+
+  memcpy(&u, &uBits, 4);
+  memcpy(&v, &vBits, 4);
+
+  return u + v;
+}
+
+float gradient2dScalar(float x, float y, const uint8_t* p)
+{
+  const float xFloor = std::floor(x);
+  const float yFloor = std::floor(y);
+
+  const int X = int(xFloor) & 255;
+  const int Y = int(yFloor) & 255;
+
+  x -= xFloor;
+  y -= yFloor;
+
+  const float u = fade(x);
+  const float v = fade(y);
+
+  const int A = p[X  ] + Y;
+  const int B = p[X+1] + Y;
+
+  return gradient2dScale * lerp(v, lerp(u, grad2d(p[A  ], x,     y    ),
+                                           grad2d(p[B  ], x-1.f, y    )),
+                                   lerp(u, grad2d(p[A+1], x,     y-1.f),
+                                           grad2d(p[B+1], x-1.f, y-1.f)));
+}
+
+void gradient2dScalarBatch(
+  const float*   x,
+  const float*   y,
+  float*         out,
+  const size_t   count,
+  const uint8_t* p
+) {
+  for (size_t i=0; i < count; i++) {
+    out[i] = gradient2dScalar(x[i], y[i], p);
+  }
+}
+
+#ifdef APP_NOISE_SIMD
+bool cpuSupports(const Kernel kernel)
+{
+#if defined(__GNUC__)
+  switch (kernel) {
+    case Kernel::eSse41: return __builtin_cpu_supports("sse4.1");
+    case Kernel::eAvx2:  return __builtin_cpu_supports("avx2");
+    default:             return true;
+  }
+#else
+  return kernel != Kernel::eAvx2;
+#endif
+}
+
+// SSE4.1 has no gather, so hashes are looked up one lane at a time
+APP_TARGET_SSE41
+__m128i gather(const uint8_t* p, const __m128i index)
+{
+  return _mm_setr_epi32(
+    p[_mm_extract_epi32(index, 0)], p[_mm_extract_epi32(index, 1)],
+    p[_mm_extract_epi32(index, 2)], p[_mm_extract_epi32(index, 3)]
+  );
+}
+
+APP_TARGET_SSE41
+__m128 fade(const __m128 t)
+{
+  const __m128 inner = _mm_add_ps(
+    _mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))),
+    _mm_set1_ps(10.0f)
+  );
+
+  return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+}
+
+APP_TARGET_SSE41
+__m128 lerp(const __m128 t, const __m128 a, const __m128 b)
+{
+  return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+// Branch free Perlin::grad, blends pick the components and the low
+// two bits of the hash are moved to the sign bits
+APP_TARGET_SSE41
+__m128 grad(__m128i hash, const __m128 x, const __m128 y, const __m128 z)
+{
+  hash = _mm_and_si128(hash, _mm_set1_epi32(15));
+
+  const __m128 below8  = _mm_castsi128_ps(_mm_cmplt_epi32(hash, _mm_set1_epi32(8)));
+  const __m128 below4  = _mm_castsi128_ps(_mm_cmplt_epi32(hash, _mm_set1_epi32(4)));
+  const __m128 is12or14 = _mm_castsi128_ps(_mm_cmpeq_epi32(
+    _mm_or_si128(hash, _mm_set1_epi32(2)), _mm_set1_epi32(14)
+  ));
+
+  __m128 u = _mm_blendv_ps(y, x, below8);
+  __m128 v = _mm_blendv_ps(_mm_blendv_ps(z, x, is12or14), y, below4);
+
+  u = _mm_xor_ps(u, _mm_castsi128_ps(_mm_slli_epi32(hash, 31)));
+  v = _mm_xor_ps(v, _mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(hash, 1), 31)));
+
+  return _mm_add_ps(u, v);
+}
+
+APP_TARGET_SSE41
+void perlinSse41(
+  const float*   xs,
+  const float*   ys,
+  float*         out,
+  const size_t   count,
+  const uint8_t* p
+) {
+  const __m128i mask255 = _mm_set1_epi32(255);
+  const __m128i one     = _mm_set1_epi32(1);
+  const __m128  oneF    = _mm_set1_ps(1.0f);
+  const __m128  z0      = _mm_set1_ps(sliceZ);
+  const __m128  z1      = _mm_set1_ps(sliceZ - 1.0f);
+
+  size_t i = 0;
+
+  for (; i + 4 <= count; i += 4) {
+    __m128 x = _mm_loadu_ps(xs + i);
+    __m128 y = _mm_loadu_ps(ys + i);
+
+    const __m128 xFloor = _mm_floor_ps(x);
+    const __m128 yFloor = _mm_floor_ps(y);
+
+    const __m128i X = _mm_and_si128(_mm_cvttps_epi32(xFloor), mask255);
+    const __m128i Y = _mm_and_si128(_mm_cvttps_epi32(yFloor), mask255);
+
+    x = _mm_sub_ps(x, xFloor);
+    y = _mm_sub_ps(y, yFloor);
+
+    const __m128 u = fade(x);
+    const __m128 v = fade(y);
+
+    const __m128i A  = _mm_add_epi32(gather(p, X), Y);
+    const __m128i B  = _mm_add_epi32(gather(p, _mm_add_epi32(X, one)), Y);
+    const __m128i AA = gather(p, A);
+    const __m128i AB = gather(p, _mm_add_epi32(A, one));
+    const __m128i BA = gather(p, B);
+    const __m128i BB = gather(p, _mm_add_epi32(B, one));
+
+    const __m128 x1 = _mm_sub_ps(x, oneF);
+    const __m128 y1 = _mm_sub_ps(y, oneF);
+
+    const __m128 near = lerp(v,
+      lerp(u, grad(gather(p, AA), x, y,  z0), grad(gather(p, BA), x1, y,  z0)),
+      lerp(u, grad(gather(p, AB), x, y1, z0), grad(gather(p, BB), x1, y1, z0))
+    );
+    const __m128 far = lerp(v,
+      lerp(u, grad(gather(p, _mm_add_epi32(AA, one)), x, y,  z1),
+              grad(gather(p, _mm_add_epi32(BA, one)), x1, y,  z1)),
+      lerp(u, grad(gather(p, _mm_add_epi32(AB, one)), x, y1, z1),
+              grad(gather(p, _mm_add_epi32(BB, one)), x1, y1, z1))
+    );
+
+    _mm_storeu_ps(out + i, lerp(_mm_set1_ps(sliceFade), near, far));
+  }
+
+  perlinScalarBatch(xs + i, ys + i, out + i, count - i, p);
+}
+
+APP_TARGET_SSE41
+__m128 grad2d(__m128i hash, const __m128 x, const __m128 y)
+{
+  hash = _mm_and_si128(hash, _mm_set1_epi32(7));
+
+  const __m128 below4 = _mm_castsi128_ps(_mm_cmplt_epi32(hash, _mm_set1_epi32(4)));
+
+  __m128 u = _mm_blendv_ps(y, x, below4);
+  __m128 v = _mm_blendv_ps(x, y, below4);
+  v = _mm_add_ps(v, v);
+
+  u = _mm_xor_ps(u, _mm_castsi128_ps(_mm_slli_epi32(hash, 31)));
+  v = _mm_xor_ps(v, _mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(hash, 1), 31)));
+
+  return _mm_add_ps(u, v);
+}
+
+APP_TARGET_SSE41
+void gradient2dSse41(
+  const float*   xs,
+  const float*   ys,
+  float*         out,
+  const size_t   count,
+  const uint8_t* p
+) {
+  const __m128i mask255 = _mm_set1_epi32(255);
+  const __m128i one     = _mm_set1_epi32(1);
+  const __m128  oneF    = _mm_set1_ps(1.0f);
+  const __m128  scale   = _mm_set1_ps(gradient2dScale);
+
+  size_t i = 0;
+
+  for (; i + 4 <= count; i += 4) {
+    __m128 x = _mm_loadu_ps(xs + i);
+    __m128 y = _mm_loadu_ps(ys + i);
+
+    const __m128 xFloor = _mm_floor_ps(x);
+    const __m128 yFloor = _mm_floor_ps(y);
+
+    const __m128i X = _mm_and_si128(_mm_cvttps_epi32(xFloor), mask255);
+    const __m128i Y = _mm_and_si128(_mm_cvttps_epi32(yFloor), mask255);
+
+    x = _mm_sub_ps(x, xFloor);
+    y = _mm_sub_ps(y, yFloor);
+
+    const __m128 u = fade(x);
+    const __m128 v = fade(y);
+
+    const __m128i A = _mm_add_epi32(gather(p, X), Y);
+    const __m128i B = _mm_add_epi32(gather(p, _mm_add_epi32(X, one)), Y);
+
+    const __m128 x1 = _mm_sub_ps(x, oneF);
+    const __m128 y1 = _mm_sub_ps(y, oneF);
+
+    const __m128 noise = lerp(v,
+      lerp(u, grad2d(gather(p, A), x, y), grad2d(gather(p, B), x1, y)),
+      lerp(u, grad2d(gather(p, _mm_add_epi32(A, one)), x,  y1),
+              grad2d(gather(p, _mm_add_epi32(B, one)), x1, y1))
+    );
+
+    _mm_storeu_ps(out + i, _mm_mul_ps(scale, noise));
+  }
+
+  gradient2dScalarBatch(xs + i, ys + i, out + i, count - i, p);
+}
+
+APP_TARGET_AVX2
+__m256i gather(const uint8_t* p, const __m256i index)
+{
+  // Gathers 4 bytes at each index and keeps the first, which is why the
+  // permutation table is padded
+  return _mm256_and_si256(
+    _mm256_i32gather_epi32(reinterpret_cast<const int*>(p), index, 1),
+    _mm256_set1_epi32(255)
+  );
+}
+
+APP_TARGET_AVX2
+__m256 fade(const __m256 t)
+{
+  const __m256 inner = _mm256_add_ps(
+    _mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))),
+    _mm256_set1_ps(10.0f)
+  );
+
+  return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+}
+
+APP_TARGET_AVX2
+__m256 lerp(const __m256 t, const __m256 a, const __m256 b)
+{
+  return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+APP_TARGET_AVX2
+__m256 grad(__m256i hash, const __m256 x, const __m256 y, const __m256 z)
+{
+  hash = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+
+  const __m256 below8   = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), hash));
+  const __m256 below4   = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), hash));
+  const __m256 is12or14 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+    _mm256_or_si256(hash, _mm256_set1_epi32(2)), _mm256_set1_epi32(14)
+  ));
+
+  __m256 u = _mm256_blendv_ps(y, x, below8);
+  __m256 v = _mm256_blendv_ps(_mm256_blendv_ps(z, x, is12or14), y, below4);
+
+  u = _mm256_xor_ps(u, _mm256_castsi256_ps(_mm256_slli_epi32(hash, 31)));
+  v = _mm256_xor_ps(v, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_srli_epi32(hash, 1), 31)));
+
+  return _mm256_add_ps(u, v);
+}
+
+APP_TARGET_AVX2
+void perlinAvx2(
+  const float*   xs,
+  const float*   ys,
+  float*         out,
+  const size_t   count,
+  const uint8_t* p
+) {
+  const __m256i mask255 = _mm256_set1_epi32(255);
+  const __m256i one     = _mm256_set1_epi32(1);
+  const __m256  oneF    = _mm256_set1_ps(1.0f);
+  const __m256  z0      = _mm256_set1_ps(sliceZ);
+  const __m256  z1      = _mm256_set1_ps(sliceZ - 1.0f);
+
+  size_t i = 0;
+
+  for (; i + 8 <= count; i += 8) {
+    __m256 x = _mm256_loadu_ps(xs + i);
+    __m256 y = _mm256_loadu_ps(ys + i);
+
+    const __m256 xFloor = _mm256_floor_ps(x);
+    const __m256 yFloor = _mm256_floor_ps(y);
+
+    const __m256i X = _mm256_and_si256(_mm256_cvttps_epi32(xFloor), mask255);
+    const __m256i Y = _mm256_and_si256(_mm256_cvttps_epi32(yFloor), mask255);
+
+    x = _mm256_sub_ps(x, xFloor);
+    y = _mm256_sub_ps(y, yFloor);
+
+    const __m256 u = fade(x);
+    const __m256 v = fade(y);
+
+    const __m256i A  = _mm256_add_epi32(gather(p, X), Y);
+    const __m256i B  = _mm256_add_epi32(gather(p, _mm256_add_epi32(X, one)), Y);
+    const __m256i AA = gather(p, A);
+    const __m256i AB = gather(p, _mm256_add_epi32(A, one));
+    const __m256i BA = gather(p, B);
+    const __m256i BB = gather(p, _mm256_add_epi32(B, one));
+
+    const __m256 x1 = _mm256_sub_ps(x, oneF);
+    const __m256 y1 = _mm256_sub_ps(y, oneF);
+
+    const __m256 near = lerp(v,
+      lerp(u, grad(gather(p, AA), x, y,  z0), grad(gather(p, BA), x1, y,  z0)),
+      lerp(u, grad(gather(p, AB), x, y1, z0), grad(gather(p, BB), x1, y1, z0))
+    );
+    const __m256 far = lerp(v,
+      lerp(u, grad(gather(p, _mm256_add_epi32(AA, one)), x, y,  z1),
+              grad(gather(p, _mm256_add_epi32(BA, one)), x1, y,  z1)),
+      lerp(u, grad(gather(p, _mm256_add_epi32(AB, one)), x, y1, z1),
+              grad(gather(p, _mm256_add_epi32(BB, one)), x1, y1, z1))
+    );
+
+    _mm256_storeu_ps(out + i, lerp(_mm256_set1_ps(sliceFade), near, far));
+  }
+
+  perlinScalarBatch(xs + i, ys + i, out + i, count - i, p);
+}
+
+APP_TARGET_AVX2
+__m256 grad2d(__m256i hash, const __m256 x, const __m256 y)
+{
+  hash = _mm256_and_si256(hash, _mm256_set1_epi32(7));
+
+  const __m256 below4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), hash));
+
+  __m256 u = _mm256_blendv_ps(y, x, below4);
+  __m256 v = _mm256_blendv_ps(x, y, below4);
+  v = _mm256_add_ps(v, v);
+
+  u = _mm256_xor_ps(u, _mm256_castsi256_ps(_mm256_slli_epi32(hash, 31)));
+  v = _mm256_xor_ps(v, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_srli_epi32(hash, 1), 31)));
+
+  return _mm256_add_ps(u, v);
+}
+
+APP_TARGET_AVX2
+void gradient2dAvx2(
+  const float*   xs,
+  const float*   ys,
+  float*         out,
+  const size_t   count,
+  const uint8_t* p
+) {
+  const __m256i mask255 = _mm256_set1_epi32(255);
+  const __m256i one     = _mm256_set1_epi32(1);
+  const __m256  oneF    = _mm256_set1_ps(1.0f);
+  const __m256  scale   = _mm256_set1_ps(gradient2dScale);
+
+  size_t i = 0;
+
+  for (; i + 8 <= count; i += 8) {
+    __m256 x = _mm256_loadu_ps(xs + i);
+    __m256 y = _mm256_loadu_ps(ys + i);
+
+    const __m256 xFloor = _mm256_floor_ps(x);
+    const __m256 yFloor = _mm256_floor_ps(y);
+
+    const __m256i X = _mm256_and_si256(_mm256_cvttps_epi32(xFloor), mask255);
+    const __m256i Y = _mm256_and_si256(_mm256_cvttps_epi32(yFloor), mask255);
+
+    x = _mm256_sub_ps(x, xFloor);
+    y = _mm256_sub_ps(y, yFloor);
+
+    const __m256 u = fade(x);
+    const __m256 v = fade(y);
+
+    const __m256i A = _mm256_add_epi32(gather(p, X), Y);
+    const __m256i B = _mm256_add_epi32(gather(p, _mm256_add_epi32(X, one)), Y);
+
+    const __m256 x1 = _mm256_sub_ps(x, oneF);
+    const __m256 y1 = _mm256_sub_ps(y, oneF);
+
+    const __m256 noise = lerp(v,
+      lerp(u, grad2d(gather(p, A), x, y), grad2d(gather(p, B), x1, y)),
+      lerp(u, grad2d(gather(p, _mm256_add_epi32(A, one)), x,  y1),
+              grad2d(gather(p, _mm256_add_epi32(B, one)), x1, y1))
+    );
+
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(scale, noise));
+  }
+
+  gradient2dScalarBatch(xs + i, ys + i, out + i, count - i, p);
+}
+#else
+bool cpuSupports(const Kernel kernel)
+{
+  return kernel == Kernel::eScalar || kernel == Kernel::eAuto;
+}
+#endif
+}
+
+Kernel getBestKernel()
+{
+  static const Kernel best = cpuSupports(Kernel::eAvx2)  ? Kernel::eAvx2
+                           : cpuSupports(Kernel::eSse41) ? Kernel::eSse41
+                                                         : Kernel::eScalar;
+  return best;
+}
+
+const char* getKernelName(const Kernel kernel)
+{
+  switch (kernel) {
+    case Kernel::eAuto:   return getKernelName(getBestKernel());
+    case Kernel::eScalar: return "scalar";
+    case Kernel::eSse41:  return "SSE4.1";
+    case Kernel::eAvx2:   return "AVX2";
+  }
+
+  return "unknown";
+}
+
+NoiseGenerator::NoiseGenerator(
+  const uint32_t        seed,
+  const FractalOptions& options
+) : options(options) {
+  uint8_t permutation[256];
+
+  if (seed == perlinReferenceSeed) {
+    const auto reference = Perlin::get_permutation_vector();
+
+    for (int i=0; i < 256; i++) {
+      permutation[i] = reference[i];
+    }
+  } else {
+    for (int i=0; i < 256; i++) {
+      permutation[i] = i;
+    }
+
+    // Fisher-Yates shuffle with xorshift32, so a seed gives the same table
+    // with every standard library
+    uint32_t state = seed;
+
+    for (int i=255; i > 0; i--) {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+
+      std::swap(permutation[i], permutation[state % (i + 1)]);
+    }
+  }
+
+  // Doubled so lookups of hash + 1 don't need wrapping
+  for (int i=0; i < 512; i++) {
+    perm[i] = permutation[i & 255];
+  }
+  for (size_t i=512; i < sizeof(perm); i++) {
+    perm[i] = 0;
+  }
+
+  float amplitude = 1;
+  float frequency = 1;
+
+  octaves.resize(std::max(0, options.octaves));
+
+  for (auto& octave : octaves) {
+    octave.amplitude = amplitude;
+    octave.frequency = frequency / options.noiseScale;
+
+    maxHeight += amplitude;
+
+    // Lacunarity  --> Increase in frequency of octaves
+    // Persistence --> Decrease in amplitude of octaves
+    amplitude *= options.persistence;
+    frequency *= options.lacunarity;
+  }
+}
+
+void NoiseGenerator::perlinNoise(
+  const float* x,
+  const float* y,
+  float*       out,
+  const size_t count,
+  Kernel       kernel
+) const {
+  if (kernel == Kernel::eAuto || !cpuSupports(kernel)) {
+    kernel = getBestKernel();
+  }
+
+#ifdef APP_NOISE_SIMD
+  if (kernel == Kernel::eAvx2) {
+    perlinAvx2(x, y, out, count, perm);
+    return;
+  }
+  if (kernel == Kernel::eSse41) {
+    perlinSse41(x, y, out, count, perm);
+    return;
+  }
+#endif
+
+  perlinScalarBatch(x, y, out, count, perm);
+}
+
+void NoiseGenerator::gradientNoise2d(
+  const float* x,
+  const float* y,
+  float*       out,
+  const size_t count,
+  Kernel       kernel
+) const {
+  if (kernel == Kernel::eAuto || !cpuSupports(kernel)) {
+    kernel = getBestKernel();
+  }
+
+#ifdef APP_NOISE_SIMD
+  if (kernel == Kernel::eAvx2) {
+    gradient2dAvx2(x, y, out, count, perm);
+    return;
+  }
+  if (kernel == Kernel::eSse41) {
+    gradient2dSse41(x, y, out, count, perm);
+    return;
+  }
+#endif
+
+  gradient2dScalarBatch(x, y, out, count, perm);
+}
+
+void NoiseGenerator::noise(
+  const Basis  basis,
+  const float* x,
+  const float* y,
+  float*       out,
+  const size_t count,
+  const Kernel kernel
+) const {
+  if (basis == Basis::eGradient2d) {
+    gradientNoise2d(x, y, out, count, kernel);
+  } else {
+    perlinNoise(x, y, out, count, kernel);
+  }
+}
+
+void NoiseGenerator::fractalNoiseRow(
+  const int    x,
+  const int    y,
+  const size_t count,
+  float*       out,
+  const Kernel kernel
+) const {
+  // Samples are evaluated in blocks that stay in L1, on the stack so
+  // concurrent calls don't share any state
+  const size_t blockSize = 256;
+
+  float xSamples[blockSize];
+  float ySamples[blockSize];
+  float noiseSamples[blockSize];
+
+  for (size_t begin = 0; begin < count; begin += blockSize) {
+    const size_t n   = std::min(blockSize, count - begin);
+    float*       dst = out + begin;
+
+    std::fill(dst, dst + n, 0.0f);
+
+    for (const auto& octave : octaves) {
+      for (size_t i=0; i < n; i++) {
+        xSamples[i] = float(x + int(begin + i)) * octave.frequency;
+        ySamples[i] = float(y) * octave.frequency;
+      }
+
+      noise(options.basis, xSamples, ySamples, noiseSamples, n, kernel);
+
+      for (size_t i=0; i < n; i++) {
+        dst[i] += noiseSamples[i] * octave.amplitude;
+      }
+    }
+
+    for (size_t i=0; i < n; i++) {
+      // Inverse lerp and scale values to range from 0 to 1
+      dst[i] = (dst[i] + 1) / maxHeight;
+    }
+  }
+}
+
+const char* getBasisName(const Basis basis)
+{
+  return basis == Basis::eGradient2d ? "2D gradient" : "3D Perlin slice";
+}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Batched noise kernels for terrain generation
+// Kernels evaluate 4 or 8 samples at a time with SIMD, and are picked at
+// runtime from what the CPU supports
+namespace App::Noise
+{
+enum class Kernel { eAuto, eScalar, eSse41, eAvx2 };
+
+// ePerlin3dSlice matches Perlin::perlin_noise, the z = 0.5 slice of 3D
+// Perlin noise, which blends 8 cube corners per sample
+// eGradient2d is 2D gradient noise, which blends 4 square corners per
+// sample, and is scaled to the same standard deviation as the 3D slice
+enum class Basis { ePerlin3dSlice, eGradient2d };
+
+// Widest kernel the CPU supports, which eAuto resolves to
+Kernel getBestKernel();
+
+const char* getKernelName(const Kernel kernel);
+
+const char* getBasisName(const Basis basis);
+
+// Largest absolute difference between NoiseGenerator::perlinNoise with
+// perlinReferenceSeed and Perlin::perlin_noise
+// Kernels compute in float instead of double precision, and every kernel
+// returns the same result for the same sample
+const float perlinNoiseTolerance = 1e-5f;
+
+// Seed that uses Ken Perlin's reference permutation, as Perlin::perlin_noise does
+const uint32_t perlinReferenceSeed = 0;
+
+// Fractal noise is the sum of octaves of noise, each at lacunarity times
+// the frequency and persistence times the amplitude of the one before it
+struct FractalOptions {
+  Basis basis       = Basis::ePerlin3dSlice;
+  int   octaves     = 5;
+  float noiseScale  = 64;  // Horizontal scaling, in samples per noise lattice cell
+  float persistence = 0.5;
+  float lacunarity  = 2;
+};
+
+// Noise with a permutation table shuffled from a seed
+// Tables and per octave parameters are built once, and never modified
+// after construction, so one generator can be shared by any number of
+// threads. Results only depend on the seed, options, and sample position
+class NoiseGenerator
+{
+public:
+  NoiseGenerator(
+    const uint32_t        seed,
+    const FractalOptions& options = {}
+  );
+
+  // out[i] = Perlin::perlin_noise(x[i], y[i], p), within perlinNoiseTolerance
+  // when the seed is perlinReferenceSeed
+  // Using a kernel the CPU doesn't support falls back to the best one it does
+  void perlinNoise(
+    const float* x,
+    const float* y,
+    float*       out,
+    const size_t count,
+    Kernel       kernel = Kernel::eAuto
+  ) const;
+
+  // 2D gradient noise, with 8 gradient directions per lattice point
+  void gradientNoise2d(
+    const float* x,
+    const float* y,
+    float*       out,
+    const size_t count,
+    Kernel       kernel = Kernel::eAuto
+  ) const;
+
+  // Evaluates perlinNoise or gradientNoise2d depending on basis
+  void noise(
+    const Basis  basis,
+    const float* x,
+    const float* y,
+    float*       out,
+    const size_t count,
+    const Kernel kernel = Kernel::eAuto
+  ) const;
+
+  // Fractal noise at samples (x + i, y) for i in [0, count), scaled by
+  // noiseScale and normalized to roughly [0, 1]
+  void fractalNoiseRow(
+    const int    x,
+    const int    y,
+    const size_t count,
+    float*       out,
+    const Kernel kernel = Kernel::eAuto
+  ) const;
+
+  const FractalOptions& getOptions() const { return options; }
+
+private:
+  struct Octave {
+    float frequency; // Includes 1 / noiseScale
+    float amplitude;
+  };
+
+  // Permutation doubled to 512 entries, plus padding so SIMD kernels can
+  // gather 4 bytes at the last entry
+  alignas(64) uint8_t perm[512 + 4];
+
+  FractalOptions      options;
+  std::vector<Octave> octaves;
+  float               maxHeight = 0;
+};
+}
@@ -1,19 +1,22 @@
 #pragma once
 
+#include <cmath>
+#include <vector>
+
 namespace Perlin
 {
-double fade(double t) { return t * t * t * (t * (t * 6 - 15) + 10); };
+inline double fade(double t) { return t * t * t * (t * (t * 6 - 15) + 10); };
     
-double lerp(double t, double a, double b) { return a + t * (b - a); }
+inline double lerp(double t, double a, double b) { return a + t * (b - a); }
     
-double grad(int hash, double x, double y, double z) {
+inline double grad(int hash, double x, double y, double z) {
  int h = hash & 15;                      // CONVERT LO 4 BITS OF HASH CODE
  double u = h<8 ? x : y,                 // INTO 12 GRADIENT DIRECTIONS.
         v = h<4 ? y : h==12||h==14 ? x : z;
  return ((h&1) == 0 ? u : -u) + ((h&2) == 0 ? v : -v);
 }
     
-double perlin_noise(float x, float y, std::vector<int> &p) {
+inline double perlin_noise(float x, float y, std::vector<int> &p) {
   float z = 0.5;
   
   int X = (int)floor(x) & 255,                  // FIND UNIT CUBE THAT
@@ -38,7 +41,7 @@ double perlin_noise(float x, float y, std::vector<int> &p) {
                                  grad(p[BB+1], x-1, y-1, z-1 ))));
 }
 
-std::vector<int> get_permutation_vector () {
+inline std::vector<int> get_permutation_vector () {
   std::vector<int> p;
 
   std::vector<int> permutation = { 151,160,137,91,90,15,
@@ -1,6 +1,15 @@
 #include "terrainGenerator.h"
 
-#include "perlin.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "meshOptimizer.h"
+#include "noise.h"
+#include "terrainStreamer.h"
+#include "threadPool.h"
 #include "structs.h"
 #include "engine.h"
 
@@ -12,42 +21,93 @@ void run(
   config.appName        = "vkTerrainGenerator";
   config.windowWidth    = 1440*0.7;
   config.windowHeight   = 900 *0.7;
-  config.vertShaderPath = "../shaders/terrainShader.vert.spv";
+  config.vertShaderPath = "../shaders/terrainShaderHeight.vert.spv";
   config.fragShaderPath = "../shaders/terrainShader.frag.spv";
+  config.vertexFormat   = "height"; // 4 bytes per vertex, colored by height
   config.frontFace      = "clockwise";
   config.clearColor     = glm::vec4(0.53, 0.81, 0.92, 1.0);
   config.farClipPlane   = 512.0;
   config.camera.pos     = glm::vec3(192, 70, 320);
+  // A chunk's LOD error is its largest height difference from full
+  // detail, which overstates most of the chunk on rough terrain
+  config.lodPixelError  = 8.0;
 
   // App params
-  const int xMapChunks    = 3;
-  const int yMapChunks    = 3;
-  const int chunkWidth    = 128;
-  const int chunkHeight   = 128;
-  const float waterHeight = 0.1;
-  const float meshHeight  = 32;  // Vertical scaling
+  App::TerrainGenerator::StreamingOptions streamingOptions;
+  streamingOptions.chunkWidth   = 129; // 128 cells, which halve for every LOD
+  streamingOptions.chunkHeight  = 129;
+  streamingOptions.waterHeight  = 0.1;
+  streamingOptions.meshHeight   = 32;  // Vertical scaling
+  streamingOptions.loadRadius   = config.farClipPlane;
+  streamingOptions.memoryBudget = 32 << 20;
 
   // Noise params
-  int octaves       = 5;
-  float noiseScale  = 64;  // Horizontal scaling
-  float persistence = 0.5;
-  float lacunarity  = 2;
-
-  // Generate map chunks
-  for (int yPos = 0; yPos < yMapChunks; yPos++) {
-    for (int xPos = 0; xPos < xMapChunks; xPos++) {
-      config.models.push_back(
-        generateMapChunk(
-          xPos,        yPos,
-          xMapChunks,  yMapChunks,
-          chunkWidth,  chunkHeight,
-          waterHeight, meshHeight,
-          octaves,     noiseScale,
-          persistence, lacunarity
-        )
-      );
-    }
-  }
+  App::Noise::FractalOptions noiseOptions;
+  noiseOptions.octaves     = 5;
+  noiseOptions.noiseScale  = 64;  // Horizontal scaling
+  noiseOptions.persistence = 0.5;
+  noiseOptions.lacunarity  = 2;
+  // 2D gradient noise blends half as many corners as the 3D Perlin slice
+  noiseOptions.basis       = App::Noise::Basis::eGradient2d;
+  // Any other seed shuffles a new permutation table
+  uint32_t noiseSeed       = App::Noise::perlinReferenceSeed;
+
+  // Chunks share the same grid topology, so indices are optimized once
+  // for all of them. LODs are geomipmaps of the grid instead of being
+  // simplified, so every chunk shares their indices too
+  // Height vertices are placed by their index, so they stay in grid order
+  Excal::Model::ModelOptions modelOptions;
+  modelOptions.optimizeVertexCache = true;
+  modelOptions.optimizeVertexFetch = config.vertexFormat != "height";
+  modelOptions.printStats          = false; // Runs each pass' analysis, for tuning
+  modelOptions.buildMeshlets       = true;
+  modelOptions.lodCount            = 6;
+
+  // Chunks are generated around the camera while the app runs, instead
+  // of as a fixed map before it starts
+  auto streamer = std::make_shared<TerrainStreamer>(
+    noiseSeed, noiseOptions, streamingOptions, modelOptions
+  );
+
+  streamer->addChunkSlots(config);
+
+  config.frameCallback = [streamer](Excal::Engine& engine) {
+    streamer->update(engine);
+  };
+}
+
+std::vector<Excal::Model::Model> generateMap(
+  const int   xMapChunks,
+  const int   yMapChunks,
+  const int   chunkWidth,
+  const int   chunkHeight,
+  const float waterHeight,
+  const float meshHeight,
+  const App::Noise::NoiseGenerator& noise,
+  const Excal::Model::ModelOptions& modelOptions
+) {
+  std::vector<Excal::Model::Model> mapChunks(xMapChunks * yMapChunks);
+
+  // Every chunk draws from the same indices
+  const auto topology = generateChunkTopology(chunkWidth, chunkHeight, modelOptions);
+
+  // Chunks are independent, so they're generated in parallel, each into
+  // its own slot so the order doesn't depend on which finishes first
+  Excal::getThreadPool().parallelFor(mapChunks.size(), [&](size_t i) {
+    const int xPos = i % xMapChunks;
+    const int yPos = i / xMapChunks;
+
+    mapChunks[i] = generateMapChunk(
+      xPos,        yPos,
+      xMapChunks,  yMapChunks,
+      chunkWidth,  chunkHeight,
+      waterHeight, meshHeight,
+      noise,       topology,
+      modelOptions
+    );
+  });
+
+  return mapChunks;
 }
 
 glm::vec3 getColor(
@@ -59,82 +119,78 @@ glm::vec3 getColor(
 }
 
 std::vector<float> generateNoiseMap(
-  const int   xOffset,
-  const int   yOffset,
-  const int   chunkWidth,
-  const int   chunkHeight,
-  const int   octaves,
-  const float noiseScale,
-  const float persistence,
-  const float lacunarity
+  const int xOffset,
+  const int yOffset,
+  const int chunkWidth,
+  const int chunkHeight,
+  const App::Noise::NoiseGenerator& noise,
+  const int apron
 ) {
-  std::vector<float> noiseValues;
-  std::vector<float> normalizedNoiseValues;
-  std::vector<int> p = Perlin::get_permutation_vector();
-
-  float amp  = 1;
-  float freq = 1;
-  float maxPossibleHeight = 0;
-
-  for (int i = 0; i < octaves; i++) {
-    maxPossibleHeight += amp;
-    amp *= persistence;
-  }
-
-  for (int y = 0; y < chunkHeight; y++) {
-    for (int x = 0; x < chunkWidth; x++) {
-      amp  = 1;
-      freq = 1;
-      float noiseHeight = 0;
-      for (int i = 0; i < octaves; i++) {
-        float xSample = (x + xOffset * (chunkWidth-1))  / noiseScale * freq;
-        float ySample = (y + yOffset * (chunkHeight-1)) / noiseScale * freq;
-
-        float perlinValue = Perlin::perlin_noise(xSample, ySample, p);
-        noiseHeight += perlinValue * amp;
-
-        // Lacunarity  --> Increase in frequency of octaves
-        // Persistence --> Decrease in amplitude of octaves
-        amp  *= persistence;
-        freq *= lacunarity;
-      }
-
-      noiseValues.push_back(noiseHeight);
-    }
-  }
-
-  for (int y = 0; y < chunkHeight; y++) {
-    for (int x = 0; x < chunkWidth; x++) {
-      // Inverse lerp and scale values to range from 0 to 1
-      normalizedNoiseValues.push_back(
-        (noiseValues[x + y*chunkWidth] + 1) / maxPossibleHeight
+  const int mapWidth  = chunkWidth  + 2*apron;
+  const int mapHeight = chunkHeight + 2*apron;
+
+  std::vector<float> noiseValues(mapWidth * mapHeight);
+
+  // Large chunks are split into bands of rows, generated on the thread
+  // pool. Chunks up to minBandSamples are a single band, since the chunks
+  // themselves are already generated in parallel
+  const int minBandSamples = 128 * 128;
+  const int rowsPerBand    = std::max(1, minBandSamples / std::max(1, mapWidth));
+  const int nBands         = (mapHeight + rowsPerBand - 1) / rowsPerBand;
+
+  Excal::getThreadPool().parallelFor(nBands, [&](size_t band) {
+    const int yBegin = band * rowsPerBand;
+    const int yEnd   = std::min(mapHeight, yBegin + rowsPerBand);
+
+    // Rows are generated whole, so the noise kernel can evaluate several
+    // samples at once
+    for (int y = yBegin; y < yEnd; y++) {
+      noise.fractalNoiseRow(
+        xOffset * (chunkWidth-1) - apron, y + yOffset * (chunkHeight-1) - apron,
+        mapWidth, noiseValues.data() + y*mapWidth
       );
     }
+  });
+
+  return noiseValues;
+}
+
+std::vector<float> generateHeightMap(
+  const std::vector<float>& noiseMap,
+  const float               waterHeight,
+  const float               meshHeight
+) {
+  std::vector<float> heights(noiseMap.size());
+
+  for (size_t i = 0; i < noiseMap.size(); i++) {
+    // Apply cubic easing to the noise
+    float easedNoise = std::pow(noiseMap[i] * 1.1, 3);
+    // Scale noise to match meshHeight
+    // Pervent vertex height from being below waterHeight
+    heights[i] = std::fmax(easedNoise * meshHeight, waterHeight * 0.5 * meshHeight);
   }
 
-  return normalizedNoiseValues;
+  return heights;
 }
 
 std::vector<float> generateVertices(
-  const std::vector<float>& noise_map,
-  const float               waterHeight,
+  const std::vector<float>& heightMap,
   const int                 xOffset,
   const int                 yOffset,
   const int                 chunkWidth,
-  const int                 chunkHeight,
-  const float               meshHeight
+  const int                 chunkHeight
 ) {
+  const int mapWidth = chunkWidth + 2*heightMapApron;
+
   std::vector<float> vertices;
+  vertices.reserve(chunkWidth * chunkHeight * 3);
 
   for (int z = 0; z < chunkHeight; z++) {
+    const float* heights = heightMap.data() + (z + heightMapApron)*mapWidth + heightMapApron;
+
     for (int x = 0; x < chunkWidth; x++) {
-      // Apply cubic easing to the noise
-      float easedNoise = std::pow(noise_map[x + z*chunkWidth] * 1.1, 3);
-      // Scale noise to match meshHeight
-      // Pervent vertex height from being below waterHeight
-      float y = std::fmax(easedNoise * meshHeight, waterHeight * 0.5 * meshHeight);
       vertices.push_back(x + xOffset * (chunkWidth - 1));
-      vertices.push_back(y);
+      vertices.push_back(heights[x]);
       vertices.push_back(z + yOffset * (chunkHeight - 1));
     }
   }
@@ -144,12 +200,16 @@ std::vector<float> generateVertices(
 
 std::vector<uint32_t> generateIndices(
   const int chunkWidth,
-  const int chunkHeight
+  const int chunkHeight,
+  const int stride
 ) {
   std::vector<uint32_t> indices;
 
-  for (int y = 0; y < chunkHeight; y++) {
-    for (int x = 0; x < chunkWidth; x++) {
+  const uint32_t right = stride;
+  const uint32_t up    = stride * chunkWidth;
+
+  for (int y = 0; y < chunkHeight; y += stride) {
+    for (int x = 0; x < chunkWidth; x += stride) {
       uint32_t pos = x + y*chunkWidth;
 
       if (x == chunkWidth - 1 || y == chunkHeight - 1) {
@@ -157,12 +217,12 @@ std::vector<uint32_t> generateIndices(
         continue;
       } else {
         // Top left triangle of square
-        indices.push_back(pos + chunkWidth);
+        indices.push_back(pos + up);
         indices.push_back(pos);
-        indices.push_back(pos + chunkWidth + 1);
+        indices.push_back(pos + up + right);
         // Bottom right triangle of square
-        indices.push_back(pos + 1);
-        indices.push_back(pos + 1 + chunkWidth);
+        indices.push_back(pos + right);
+        indices.push_back(pos + right + up);
         indices.push_back(pos);
       }
     }
@@ -171,31 +231,144 @@ std::vector<uint32_t> generateIndices(
   return indices;
 }
 
-std::vector<float> generateNormals(
-  const std::vector<uint32_t>& indices,
-  const std::vector<float>&    vertices
+std::vector<uint32_t> generateSkirtVertices(
+  const int chunkWidth,
+  const int chunkHeight
+) {
+  std::vector<uint32_t> skirtVertices;
+
+  for (int x = 0; x < chunkWidth; x++) {
+    skirtVertices.push_back(x);
+  }
+  for (int y = 0; y < chunkHeight; y++) {
+    skirtVertices.push_back(chunkWidth - 1 + y*chunkWidth);
+  }
+  for (int x = chunkWidth - 1; x >= 0; x--) {
+    skirtVertices.push_back(x + (chunkHeight - 1)*chunkWidth);
+  }
+  for (int y = chunkHeight - 1; y >= 0; y--) {
+    skirtVertices.push_back(y*chunkWidth);
+  }
+
+  return skirtVertices;
+}
+
+std::vector<uint32_t> generateSkirtIndices(
+  const int chunkWidth,
+  const int chunkHeight,
+  const int stride
+) {
+  const auto skirtVertices = generateSkirtVertices(chunkWidth, chunkHeight);
+  const int  edgeLengths[] = { chunkWidth, chunkHeight, chunkWidth, chunkHeight };
+
+  const uint32_t firstSkirtVertex = chunkWidth * chunkHeight;
+
+  std::vector<uint32_t> indices;
+  uint32_t edgeStart = 0;
+
+  // Edges go around the chunk, so each quad faces outwards with the same
+  // winding as the grid's triangles
+  for (const int edgeLength : edgeLengths) {
+    for (int i = 0; i + stride < edgeLength; i += stride) {
+      const uint32_t a = edgeStart + i;
+      const uint32_t b = edgeStart + i + stride;
+
+      indices.push_back(skirtVertices[a]);
+      indices.push_back(firstSkirtVertex + a);
+      indices.push_back(skirtVertices[b]);
+
+      indices.push_back(skirtVertices[b]);
+      indices.push_back(firstSkirtVertex + a);
+      indices.push_back(firstSkirtVertex + b);
+    }
+
+    edgeStart += edgeLength;
+  }
+
+  return indices;
+}
+
+std::vector<float> generateLodErrors(
+  const std::vector<float>& heightMap,
+  const int                 chunkWidth,
+  const int                 chunkHeight,
+  const int                 lodCount
 ) {
-  std::vector<float>     normals;
-  std::vector<glm::vec3> verts;
-
-  // Get the vertices of each triangle in mesh
-  // For each group of indices
-  for (uint32_t i = 0; i < indices.size(); i += 3) {
-    // Get the vertices (point) for each index
-    for (uint32_t j = 0; j < 3; j++) {
-      uint32_t pos = indices[i+j]*3;
-      verts.push_back(glm::vec3(vertices[pos], vertices[pos+1], vertices[pos+2]));
+  const int mapWidth = chunkWidth + 2*heightMapApron;
+
+  auto getHeight = [&](const int x, const int y) {
+    return heightMap[(y + heightMapApron)*mapWidth + x + heightMapApron];
+  };
+
+  std::vector<float> errors(lodCount, 0.0f);
+
+  for (int lod = 1; lod < lodCount; lod++) {
+    const int stride = 1 << lod;
+
+    for (int y0 = 0; y0 + stride < chunkHeight; y0 += stride) {
+      for (int x0 = 0; x0 + stride < chunkWidth; x0 += stride) {
+        const float h00 = getHeight(x0,          y0);
+        const float h10 = getHeight(x0 + stride, y0);
+        const float h01 = getHeight(x0,          y0 + stride);
+        const float h11 = getHeight(x0 + stride, y0 + stride);
+
+        // Cells are split along the diagonal from (x0, y0), as in
+        // generateIndices, and each half is a plane through its corners
+        for (int y = 0; y <= stride; y++) {
+          for (int x = 0; x <= stride; x++) {
+            const float u = x / float(stride);
+            const float v = y / float(stride);
+
+            const float lodHeight = u >= v
+                                    ? h00 + u*(h10 - h00) + v*(h11 - h10)
+                                    : h00 + v*(h01 - h00) + u*(h11 - h01);
+
+            errors[lod] = std::max(
+              errors[lod], std::fabs(getHeight(x0 + x, y0 + y) - lodHeight)
+            );
+          }
+        }
+      }
     }
+  }
+
+  return errors;
+}
+
+std::vector<float> generateNormals(
+  const std::vector<float>& heightMap,
+  const int                 chunkWidth,
+  const int                 chunkHeight
+) {
+  const int mapWidth = chunkWidth + 2*heightMapApron;
+
+  std::vector<float> normals(chunkWidth * chunkHeight * 3);
+  std::vector<float> invLengths(chunkWidth);
+
+  // The surface is y = h(x, z) with 1 unit between samples, so its normal
+  // is (-dh/dx, 1, -dh/dz), scaled by 2 to drop the central differences'
+  // division. Edge vertices read the apron, which holds the neighboring
+  // chunks' heights, so normals match across chunk borders
+  for (int z = 0; z < chunkHeight; z++) {
+    const float* row  = heightMap.data() + (z + heightMapApron)*mapWidth + heightMapApron;
+    const float* down = row - mapWidth;
+    const float* up   = row + mapWidth;
+    float*       dst  = normals.data() + z*chunkWidth*3;
+
+    // Lengths are computed separately from the interleaved stores, so the
+    // compiler can vectorize the loop (sqrt needs -fno-math-errno)
+    for (int x = 0; x < chunkWidth; x++) {
+      const float nx = row[x-1] - row[x+1];
+      const float nz = down[x]  - up[x];
 
-    // Get vectors of two edges of triangle
-    glm::vec3 U = verts[i+1] - verts[i];
-    glm::vec3 V = verts[i+2] - verts[i];
+      invLengths[x] = 1.0f / std::sqrt(nx*nx + 4.0f + nz*nz);
+    }
 
-    // Calculate normal
-    glm::vec3 normal = glm::normalize(-glm::cross(U, V));
-    normals.push_back(normal.x);
-    normals.push_back(normal.y);
-    normals.push_back(normal.z);
+    for (int x = 0; x < chunkWidth; x++) {
+      dst[x*3 + 0] = (row[x-1] - row[x+1]) * invLengths[x];
+      dst[x*3 + 1] = 2.0f                  * invLengths[x];
+      dst[x*3 + 2] = (down[x]  - up[x])    * invLengths[x];
+    }
   }
 
   return normals;
@@ -241,6 +414,146 @@ std::vector<float> generateBiome(
   return colors;
 }
 
+float generateSkirtDepth(
+  const std::vector<float>& heightMap,
+  const int                 chunkWidth,
+  const int                 chunkHeight,
+  const int                 lodCount
+) {
+  const int mapWidth = chunkWidth + 2*heightMapApron;
+
+  auto getHeight = [&](const int x, const int y) {
+    return heightMap[(y + heightMapApron)*mapWidth + x + heightMapApron];
+  };
+
+  float edgeError = 0.0f;
+
+  // Each edge at LOD i is a line between every 2^i-th vertex
+  auto addEdgeErrors = [&](const int x0, const int y0, const int dx, const int dy, const int length) {
+    for (int lod = 1; lod < lodCount; lod++) {
+      const int stride = 1 << lod;
+
+      for (int i = 0; i + stride < length; i += stride) {
+        const float h0 = getHeight(x0 + i*dx,            y0 + i*dy);
+        const float h1 = getHeight(x0 + (i + stride)*dx, y0 + (i + stride)*dy);
+
+        for (int j = 1; j < stride; j++) {
+          const float lodHeight = h0 + (h1 - h0) * (j / float(stride));
+          const float height    = getHeight(x0 + (i + j)*dx, y0 + (i + j)*dy);
+
+          edgeError = std::max(edgeError, std::fabs(height - lodHeight));
+        }
+      }
+    }
+  };
+
+  addEdgeErrors(0,              0,               1, 0, chunkWidth);
+  addEdgeErrors(0,              chunkHeight - 1, 1, 0, chunkWidth);
+  addEdgeErrors(0,              0,               0, 1, chunkHeight);
+  addEdgeErrors(chunkWidth - 1, 0,               0, 1, chunkHeight);
+
+  return 2.0f * edgeError + skirtMargin;
+}
+
+ChunkTopology generateChunkTopology(
+  const int chunkWidth,
+  const int chunkHeight,
+  const Excal::Model::ModelOptions& modelOptions
+) {
+  ChunkTopology topology;
+
+  // LOD i skips 2^i - 1 of every 2^i rows and columns, so LODs are only
+  // added while the grid's cells divide evenly
+  int lodCount = 1;
+
+  while (   lodCount < modelOptions.lodCount
+         && (chunkWidth  - 1) % (2 << (lodCount - 1)) == 0
+         && (chunkHeight - 1) % (2 << (lodCount - 1)) == 0
+  ) {
+    lodCount++;
+  }
+
+  if (lodCount > 1) {
+    topology.skirtVertices = generateSkirtVertices(chunkWidth, chunkHeight);
+  }
+
+  const size_t vertexCount = chunkWidth * chunkHeight + topology.skirtVertices.size();
+
+  std::vector<uint32_t> indices;
+
+  for (int lod = 0; lod < lodCount; lod++) {
+    const int stride = 1 << lod;
+    const auto lodName = lod == 0 ? std::string("terrain chunk")
+                                  : "terrain chunk LOD " + std::to_string(lod);
+
+    auto lodIndices = generateIndices(chunkWidth, chunkHeight, stride);
+
+    // Neighbors are only at different LODs if there's more than one
+    if (lodCount > 1) {
+      const auto skirtIndices = generateSkirtIndices(chunkWidth, chunkHeight, stride);
+      lodIndices.insert(lodIndices.end(), skirtIndices.begin(), skirtIndices.end());
+    }
+
+    // Both passes only depend on the indices, so they give the same result
+    // for every chunk and run once here instead of once per chunk
+    if (modelOptions.optimizeVertexCache) {
+      Excal::MeshOptimizer::VertexCacheStats before;
+      if (modelOptions.printStats) {
+        before = Excal::MeshOptimizer::analyzeVertexCache(lodIndices, vertexCount);
+      }
+
+      Excal::MeshOptimizer::optimizeVertexCache(lodIndices, vertexCount);
+
+      if (modelOptions.printStats) {
+        const auto after = Excal::MeshOptimizer::analyzeVertexCache(lodIndices, vertexCount);
+
+        std::cout << lodName << ": vertex cache ACMR "
+                  << before.acmr << " -> " << after.acmr << ", ATVR "
+                  << before.atvr << " -> " << after.atvr << std::endl;
+      }
+    }
+
+    // LODs are stored one after another, from most to least detailed
+    if (lodCount > 1) {
+      Excal::Model::Lod lodRange;
+
+      lodRange.firstIndex = indices.size();
+      lodRange.indexCount = lodIndices.size();
+
+      topology.lods.push_back(lodRange);
+    }
+
+    indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+  }
+
+  if (modelOptions.printStats && lodCount > 1) {
+    std::cout << "terrain chunk: LOD triangles";
+    for (const auto& lod : topology.lods) {
+      std::cout << " " << lod.indexCount / 3;
+    }
+    std::cout << std::endl;
+  }
+
+  // LOD 0 comes first in the index buffer, so it decides the vertex order
+  if (modelOptions.optimizeVertexFetch) {
+    const auto remap = Excal::MeshOptimizer::getVertexFetchRemap(indices, vertexCount);
+
+    // Every vertex is referenced by LOD 0, so remap is a permutation
+    topology.vertexOrder.resize(vertexCount);
+    for (size_t i=0; i < vertexCount; i++) {
+      topology.vertexOrder[remap[i]] = i;
+    }
+
+    for (auto& index : indices) {
+      index = remap[index];
+    }
+  }
+
+  topology.indices = std::make_shared<const std::vector<uint32_t>>(std::move(indices));
+
+  return topology;
+}
+
 Excal::Model::Model generateMapChunk(
   const int   xOffset,
   const int   yOffset,
@@ -250,27 +563,42 @@ Excal::Model::Model generateMapChunk(
   const int   chunkHeight,
   const float waterHeight,
   const float meshHeight,
-  const int   octaves,
-  const float noiseScale,
-  const float persistence,
-  const float lacunarity
+  const App::Noise::NoiseGenerator& noise,
+  const ChunkTopology&              topology,
+  const Excal::Model::ModelOptions& modelOptions
 ) {
   // Generate map chunk data
   auto noiseMap = generateNoiseMap(
-    xOffset,     yOffset,
-    chunkWidth,  chunkHeight,
-    octaves,     noiseScale,
-    persistence, lacunarity
+    xOffset,    yOffset,
+    chunkWidth, chunkHeight,
+    noise,      heightMapApron
   );
-  auto indices   = generateIndices(chunkWidth, chunkHeight);
-  auto positions = generateVertices(noiseMap, waterHeight, xOffset, yOffset, chunkWidth, chunkHeight, meshHeight);
-  auto normals   = generateNormals(indices, positions);
+  auto heightMap = generateHeightMap(noiseMap, waterHeight, meshHeight);
+  auto positions = generateVertices(heightMap, xOffset, yOffset, chunkWidth, chunkHeight);
+  auto normals   = generateNormals(heightMap, chunkWidth, chunkHeight);
   auto colors    = generateBiome(positions, waterHeight, xOffset, yOffset, meshHeight);
 
-  // Assemble vertices
+  const auto lodErrors = generateLodErrors(
+    heightMap, chunkWidth, chunkHeight, topology.lods.size()
+  );
+
+  const float skirtDepth = generateSkirtDepth(
+    heightMap, chunkWidth, chunkHeight, topology.lods.size()
+  );
+
+  // Assemble vertices, in the order the shared indices expect
+  // Skirt vertices copy their edge vertex, lowered by skirtDepth
+  const size_t gridVertexCount = positions.size() / 3;
+  const size_t vertexCount     = gridVertexCount + topology.skirtVertices.size();
+
   std::vector<Vertex> vertices;
-  
-  for (int i=0; i < positions.size() / 3; i++) {
+  vertices.reserve(vertexCount);
+
+  for (size_t j=0; j < vertexCount; j++) {
+    const size_t k = topology.vertexOrder.empty() ? j : topology.vertexOrder[j];
+    const bool   isSkirt = k >= gridVertexCount;
+    const size_t i = isSkirt ? topology.skirtVertices[k - gridVertexCount] : k;
+
     Vertex vertex = {
       glm::vec3(positions[i*3 + 0], positions[i*3 + 1], positions[i*3 + 2]),
       glm::vec3(colors[i*3 + 0],    colors[i*3 + 1],    colors[i*3 + 2]),
@@ -278,15 +606,74 @@ Excal::Model::Model generateMapChunk(
       glm::vec3(0) // TexCoord isn't used
     };
 
+    if (isSkirt) {
+      vertex.pos.y -= skirtDepth;
+    }
+
     vertices.push_back(vertex);
   }
 
+  auto mesh = std::make_shared<Excal::Model::Mesh>();
+
+  mesh->sharedIndices = topology.indices;
+  mesh->vertices      = std::move(vertices);
+
+  // Vertices in grid order can be drawn as height vertices
+  if (topology.vertexOrder.empty()) {
+    mesh->gridWidth  = chunkWidth;
+    mesh->gridHeight = chunkHeight;
+  }
+
+  // Index ranges are shared, but errors depend on the chunk's heights
+  mesh->lods = topology.lods;
+
+  for (size_t lod=0; lod < mesh->lods.size(); lod++) {
+    mesh->lods[lod].error = lodErrors[lod];
+  }
+
+  // Meshlets are split from the shared indices the same way for every
+  // chunk, but their bounds and cones depend on the chunk's heights
+  if (modelOptions.buildMeshlets) {
+    if (mesh->lods.empty()) {
+      mesh->meshlets = Excal::MeshOptimizer::buildMeshlets(
+        *mesh->sharedIndices, mesh->vertices, 0, mesh->sharedIndices->size()
+      );
+    }
+
+    for (auto& lod : mesh->lods) {
+      const auto meshlets = Excal::MeshOptimizer::buildMeshlets(
+        *mesh->sharedIndices, mesh->vertices, lod.firstIndex, lod.indexCount
+      );
+
+      lod.firstMeshlet = mesh->meshlets.size();
+      lod.meshletCount = meshlets.size();
+      mesh->meshlets.insert(mesh->meshlets.end(), meshlets.begin(), meshlets.end());
+    }
+  }
+
+  // LODs are picked by the distance to the chunk's bounding sphere, which
+  // leaves out the skirts
+  if (!mesh->lods.empty()) {
+    glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+    for (size_t i=0; i < gridVertexCount; i++) {
+      const glm::vec3 position(positions[i*3 + 0], positions[i*3 + 1], positions[i*3 + 2]);
+
+      boundsMin = glm::min(boundsMin, position);
+      boundsMax = glm::max(boundsMax, position);
+    }
+
+    mesh->boundsCenter   = (boundsMin + boundsMax) * 0.5f;
+    mesh->boundingRadius = glm::length(boundsMax - boundsMin) * 0.5f;
+  }
+
   Excal::Model::Model mapChunk;
 
-  mapChunk.indices  = indices;
-  mapChunk.vertices = vertices;
+  mapChunk.mesh     = mesh;
   mapChunk.position = glm::vec3(0.0);
 
+  // terrainShaderHeight.vert colors chunks with the same biomes as generateBiome
+  mapChunk.shaderParameters = glm::vec4(meshHeight, waterHeight, 0.0, 0.0);
+
   return mapChunk;
 }
 }
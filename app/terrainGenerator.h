@@ -1,8 +1,10 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <memory>
 #include <vector>
 
+#include "noise.h"
 #include "structs.h"
 #include "engine.h"
 
@@ -12,41 +14,110 @@ void run(
   Excal::Engine::EngineConfig& config
 );
 
+// Generates xMapChunks x yMapChunks chunks on the thread pool
+// Chunks are returned row by row, in the same order as they'd be
+// generated serially
+std::vector<Excal::Model::Model> generateMap(
+  const int   xMapChunks,
+  const int   yMapChunks,
+  const int   chunkWidth,
+  const int   chunkHeight,
+  const float waterHeight,
+  const float meshHeight,
+  const App::Noise::NoiseGenerator& noise,
+  const Excal::Model::ModelOptions& modelOptions = {}
+);
+
 glm::vec3 getColor(
   const int r,
   const int g,
   const int b
 );
 
+// Samples around a chunk's edges in a height map, so normals at the edges
+// can use the neighboring chunks' heights
+const int heightMapApron = 1;
+
+// (chunkWidth + 2*apron) x (chunkHeight + 2*apron) noise samples, with
+// the chunk's first sample at (apron, apron)
 std::vector<float> generateNoiseMap(
-  const int   xOffset,
-  const int   yOffset,
-  const int   chunkWidth,
-  const int   chunkHeight,
-  const int   octaves,
-  const float noiseScale,
-  const float persistence,
-  const float lacunarity
+  const int xOffset,
+  const int yOffset,
+  const int chunkWidth,
+  const int chunkHeight,
+  const App::Noise::NoiseGenerator& noise,
+  const int apron = 0
 );
 
-std::vector<float> generateVertices(
-  const std::vector<float>& noise_map,
+// Vertex heights of a noise map's samples
+std::vector<float> generateHeightMap(
+  const std::vector<float>& noiseMap,
   const float               waterHeight,
+  const float               meshHeight
+);
+
+// heightMap has a heightMapApron sample apron
+std::vector<float> generateVertices(
+  const std::vector<float>& heightMap,
   const int                 xOffset,
   const int                 yOffset,
   const int                 chunkWidth,
-  const int                 chunkHeight,
-  const float               meshHeight
+  const int                 chunkHeight
 );
 
+// Triangles of every stride-th row and column of the grid
+// chunkWidth - 1 and chunkHeight - 1 must be multiples of stride
 std::vector<uint32_t> generateIndices(
+  const int chunkWidth,
+  const int chunkHeight,
+  const int stride = 1
+);
+
+// Grid vertex that each skirt vertex copies, going around the chunk's
+// edges (+x along z = 0, then +z, -x and -z)
+std::vector<uint32_t> generateSkirtVertices(
   const int chunkWidth,
   const int chunkHeight
 );
 
+// Triangles hanging from every stride-th edge vertex down to its skirt
+// vertex, which hide cracks against neighbors drawn at another LOD
+// Skirt vertex i is vertex chunkWidth * chunkHeight + i
+std::vector<uint32_t> generateSkirtIndices(
+  const int chunkWidth,
+  const int chunkHeight,
+  const int stride
+);
+
+// Largest height difference between the grid and each LOD of it, where
+// LOD i draws every 2^i-th row and column. heightMap has a heightMapApron
+// sample apron
+std::vector<float> generateLodErrors(
+  const std::vector<float>& heightMap,
+  const int                 chunkWidth,
+  const int                 chunkHeight,
+  const int                 lodCount
+);
+
+// Depth of a chunk's skirts below its edges. Neighbors share their edge
+// heights, so the gap between two neighbors at any LODs is at most twice
+// the largest difference between an edge and its LODs
+// skirtMargin covers gaps from rasterizing T-junctions
+const float skirtMargin = 1.0f;
+
+float generateSkirtDepth(
+  const std::vector<float>& heightMap,
+  const int                 chunkWidth,
+  const int                 chunkHeight,
+  const int                 lodCount
+);
+
+// Per vertex normals from central differences of the heights
+// heightMap has a heightMapApron sample apron
 std::vector<float> generateNormals(
-  const std::vector<uint32_t>& indices,
-  const std::vector<float>&    vertices
+  const std::vector<float>& heightMap,
+  const int                 chunkWidth,
+  const int                 chunkHeight
 );
 
 struct terrainColor {
@@ -66,6 +137,35 @@ std::vector<float> generateBiome(
   const float               meshHeight
 );
 
+// Indices shared by every chunk of the same size, optimized with the
+// index only passes of ModelOptions (vertex cache and vertex fetch)
+// With modelOptions.lodCount above 1, indices hold a geomipmap of the
+// grid, so chunks of every LOD share the same indices too
+struct ChunkTopology {
+  std::shared_ptr<const std::vector<uint32_t>> indices;
+
+  // Grid or skirt vertex stored at each position of a chunk's vertex
+  // array, to match the indices. Empty if vertices are in grid order
+  std::vector<uint32_t> vertexOrder;
+
+  // Index range of each LOD, with skirts. Errors are set per chunk
+  // Empty if chunks have a single LOD
+  std::vector<Excal::Model::Lod> lods;
+
+  // See generateSkirtVertices, empty if chunks have a single LOD
+  std::vector<uint32_t> skirtVertices;
+};
+
+ChunkTopology generateChunkTopology(
+  const int chunkWidth,
+  const int chunkHeight,
+  const Excal::Model::ModelOptions& modelOptions = {}
+);
+
+// Chunk mesh drawing from topology's indices, with meshlets if
+// modelOptions.buildMeshlets is set, and LOD errors and bounds if the
+// topology has LODs. Unless the topology reorders vertices, the mesh is
+// a grid (see Excal::Model::Mesh::gridWidth) that can use height vertices
 Excal::Model::Model generateMapChunk(
   const int   xOffset,
   const int   yOffset,
@@ -75,9 +175,8 @@ Excal::Model::Model generateMapChunk(
   const int   chunkHeight,
   const float waterHeight,
   const float meshHeight,
-  const int   octaves,
-  const float noiseScale,
-  const float persistence,
-  const float lacunarity
+  const App::Noise::NoiseGenerator& noise,
+  const ChunkTopology&              topology,
+  const Excal::Model::ModelOptions& modelOptions = {}
 );
 }
@@ -0,0 +1,280 @@
+#include "terrainStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "threadPool.h"
+
+namespace App::TerrainGenerator
+{
+namespace
+{
+int64_t getChunkKey(const int x, const int z)
+{
+  return (int64_t) ((uint64_t) (uint32_t) x << 32 | (uint32_t) z);
+}
+}
+
+TerrainStreamer::TerrainStreamer(
+  const uint32_t                    seed,
+  const App::Noise::FractalOptions& noiseOptions,
+  const StreamingOptions&           options,
+  const Excal::Model::ModelOptions& modelOptions
+) {
+  generator = std::make_shared<Generator>(seed, noiseOptions);
+
+  generator->options      = options;
+  generator->modelOptions = modelOptions;
+
+  // Every chunk draws from the same indices
+  generator->topology = generateChunkTopology(
+    options.chunkWidth, options.chunkHeight, modelOptions
+  );
+}
+
+TerrainStreamer::~TerrainStreamer()
+{
+  generator->cancelled = true;
+}
+
+void TerrainStreamer::addChunkSlots(Excal::Engine::EngineConfig& config)
+{
+  const auto& options = generator->options;
+
+  // Slots are created with a placeholder chunk, which sizes their vertex
+  // range and draws, and stay hidden until a chunk is streamed in
+  const auto placeholder = generateMapChunk(
+    0,                   0,
+    1,                   1,
+    options.chunkWidth,  options.chunkHeight,
+    options.waterHeight, options.meshHeight,
+    generator->noise,    generator->topology,
+    generator->modelOptions
+  );
+
+  const size_t vertexSize = Excal::Model::getVertexSize(config.vertexFormat);
+  const size_t chunkSize  = Excal::Model::getVertexCount(*placeholder.mesh) * vertexSize;
+
+  if (options.memoryBudget < chunkSize) {
+    throw std::runtime_error("terrain memory budget is smaller than one chunk");
+  }
+
+  // Only chunks within loadRadius are kept, so the pool isn't larger than
+  // they need. A chunk whose center is within loadRadius lies within
+  // loadRadius plus half its diagonal, which bounds how many fit, and leaves
+  // some slots for chunks that just left loadRadius
+  const float  chunkSizeX  = options.chunkWidth  - 1;
+  const float  chunkSizeZ  = options.chunkHeight - 1;
+  const float  coverRadius = options.loadRadius
+                           + std::sqrt(chunkSizeX*chunkSizeX + chunkSizeZ*chunkSizeZ) / 2;
+  const float  pi          = 3.14159265f;
+  const size_t radiusSlots = std::ceil(
+    pi * coverRadius * coverRadius / (chunkSizeX * chunkSizeZ)
+  );
+
+  const size_t slotCount = std::min(radiusSlots, options.memoryBudget / chunkSize);
+
+  firstSlot = config.models.size();
+
+  for (size_t i=0; i < slotCount; i++) {
+    auto slot = placeholder;
+
+    slot.visible  = false;
+    slot.streamed = true;
+
+    config.models.push_back(slot);
+  }
+
+  slotChunks.assign(slotCount, 0);
+
+  // Lowest slots are used first
+  for (int i = slotCount - 1; i >= 0; i--) {
+    freeSlots.push_back(i);
+  }
+
+  config.streamingUploadSize = options.maxUploadsPerFrame * chunkSize;
+}
+
+void TerrainStreamer::update(Excal::Engine& engine)
+{
+  const auto& options   = generator->options;
+  const auto& cameraPos = engine.config.camera.pos;
+
+  frame++;
+
+  // Neighboring chunks share their edge vertices
+  const float chunkSizeX = options.chunkWidth  - 1;
+  const float chunkSizeZ = options.chunkHeight - 1;
+
+  const int cameraX = std::floor(cameraPos.x / chunkSizeX);
+  const int cameraZ = std::floor(cameraPos.z / chunkSizeZ);
+  const int rangeX  = std::ceil(options.loadRadius / chunkSizeX) + 1;
+  const int rangeZ  = std::ceil(options.loadRadius / chunkSizeZ) + 1;
+
+  struct WantedChunk {
+    int   x;
+    int   z;
+    float distance;
+  };
+
+  std::vector<WantedChunk> wanted;
+
+  for (int z = cameraZ - rangeZ; z <= cameraZ + rangeZ; z++) {
+    for (int x = cameraX - rangeX; x <= cameraX + rangeX; x++) {
+      const float dx = (x + 0.5f) * chunkSizeX - cameraPos.x;
+      const float dz = (z + 0.5f) * chunkSizeZ - cameraPos.z;
+
+      const float distance = std::sqrt(dx*dx + dz*dz);
+
+      if (distance <= options.loadRadius) {
+        wanted.push_back({x, z, distance});
+      }
+    }
+  }
+
+  std::sort(wanted.begin(), wanted.end(), [](const auto& a, const auto& b) {
+    return a.distance < b.distance;
+  });
+
+  // Only the nearest chunks that fit in the slots are loaded, so chunks
+  // never evict each other while the camera stands still
+  if (wanted.size() > slotChunks.size()) {
+    wanted.resize(slotChunks.size());
+  }
+
+  std::unordered_set<int64_t> wantedKeys;
+
+  for (const auto& chunk : wanted) {
+    const int64_t key = getChunkKey(chunk.x, chunk.z);
+
+    wantedKeys.insert(key);
+
+    auto found = chunks.find(key);
+    if (found != chunks.end()) {
+      found->second.lastUsedFrame = frame;
+    }
+  }
+
+  // Collect generated chunks, without waiting on the ones still running
+  std::vector<FinishedChunk> finished;
+  {
+    std::lock_guard<std::mutex> lock(generator->finishedMutex);
+    std::swap(finished, generator->finished);
+  }
+
+  for (auto& chunk : finished) {
+    pendingCount--;
+
+    // The camera moved away while it was generating
+    if (!wantedKeys.count(chunk.key)) {
+      chunks.erase(chunk.key);
+      continue;
+    }
+
+    auto& readyChunk = chunks.at(chunk.key);
+
+    readyChunk.state         = ChunkState::eReady;
+    readyChunk.mesh          = std::move(chunk.mesh);
+    readyChunk.lastUsedFrame = frame;
+  }
+
+  // Ready chunks that left the load radius before they were uploaded
+  for (auto it = chunks.begin(); it != chunks.end();) {
+    if (it->second.state == ChunkState::eReady && it->second.lastUsedFrame < frame) {
+      it = chunks.erase(it);
+    } else {
+      it++;
+    }
+  }
+
+  // Queue missing chunks and upload ready ones, nearest first
+  for (const auto& chunk : wanted) {
+    const int64_t key   = getChunkKey(chunk.x, chunk.z);
+    auto          found = chunks.find(key);
+
+    if (found == chunks.end()) {
+      if (pendingCount < (size_t) options.maxPendingChunks) {
+        queueChunk(chunk.x, chunk.z);
+      }
+      continue;
+    }
+
+    auto& readyChunk = found->second;
+
+    if (   readyChunk.state != ChunkState::eReady
+        || engine.getPendingMeshUploads() >= (size_t) options.maxUploadsPerFrame
+    ) {
+      continue;
+    }
+
+    const int slot = acquireSlot();
+    if (slot < 0) {
+      continue;
+    }
+
+    engine.updateModelMesh(firstSlot + slot, std::move(readyChunk.mesh));
+
+    readyChunk.state = ChunkState::eResident;
+    readyChunk.slot  = slot;
+    slotChunks[slot] = key;
+  }
+}
+
+void TerrainStreamer::queueChunk(const int x, const int z)
+{
+  const int64_t key = getChunkKey(x, z);
+
+  chunks[key] = Chunk{ChunkState::eGenerating, nullptr, -1, 0};
+  pendingCount++;
+
+  Excal::getThreadPool().submit([generator = generator, x, z, key] {
+    if (generator->cancelled) {
+      return;
+    }
+
+    const auto& options = generator->options;
+
+    auto chunk = generateMapChunk(
+      x,                   z,
+      1,                   1,
+      options.chunkWidth,  options.chunkHeight,
+      options.waterHeight, options.meshHeight,
+      generator->noise,    generator->topology,
+      generator->modelOptions
+    );
+
+    std::lock_guard<std::mutex> lock(generator->finishedMutex);
+    generator->finished.push_back({key, std::move(chunk.mesh)});
+  });
+}
+
+int TerrainStreamer::acquireSlot()
+{
+  if (!freeSlots.empty()) {
+    const int slot = freeSlots.back();
+    freeSlots.pop_back();
+    return slot;
+  }
+
+  int      lruSlot  = -1;
+  uint64_t lruFrame = frame;
+
+  for (size_t i=0; i < slotChunks.size(); i++) {
+    const auto& chunk = chunks.at(slotChunks[i]);
+
+    if (chunk.lastUsedFrame < lruFrame) {
+      lruSlot  = i;
+      lruFrame = chunk.lastUsedFrame;
+    }
+  }
+
+  // The evicted chunk's vertices are overwritten by the next upload
+  if (lruSlot >= 0) {
+    chunks.erase(slotChunks[lruSlot]);
+  }
+
+  return lruSlot;
+}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "noise.h"
+#include "engine.h"
+#include "terrainGenerator.h"
+
+namespace App::TerrainGenerator
+{
+struct StreamingOptions {
+  int    chunkWidth   = 129;
+  int    chunkHeight  = 129;
+  float  waterHeight  = 0.1;
+  float  meshHeight   = 32;       // Vertical scaling
+  float  loadRadius   = 512;      // Chunks with centers this close to the camera are loaded
+  size_t memoryBudget = 32 << 20; // Most bytes of vertex buffer reserved for chunks
+
+  int maxPendingChunks   = 8; // Chunks queued or generating at once
+  int maxUploadsPerFrame = 2;
+};
+
+// Streams terrain chunks around the camera into a fixed pool of streamed
+// models (see Excal::Model::Model::streamed), enough to cover loadRadius
+// unless memoryBudget fits fewer
+// Chunks are generated on the thread pool, and update only hands finished
+// chunks to the engine, so the frame loop never waits on generation
+// When every slot is used, the chunk that left the load radius the
+// longest ago is replaced
+class TerrainStreamer
+{
+public:
+  TerrainStreamer(
+    const uint32_t                    seed,
+    const App::Noise::FractalOptions& noiseOptions,
+    const StreamingOptions&           options,
+    const Excal::Model::ModelOptions& modelOptions = {}
+  );
+
+  // Queued chunks that haven't started generating are skipped
+  ~TerrainStreamer();
+
+  TerrainStreamer(const TerrainStreamer&)            = delete;
+  TerrainStreamer& operator=(const TerrainStreamer&) = delete;
+
+  // Adds the hidden models chunks are streamed into, and sets the engine's
+  // upload size. Must be called before Engine::init, after vertexFormat is set
+  void addChunkSlots(Excal::Engine::EngineConfig& config);
+
+  // Queues chunks within loadRadius of the camera, nearest first, and
+  // uploads chunks that finished generating. Call once per frame
+  void update(Excal::Engine& engine);
+
+  size_t getSlotCount()          const { return slotChunks.size(); }
+  size_t getResidentChunkCount() const { return slotChunks.size() - freeSlots.size(); }
+
+private:
+  struct FinishedChunk {
+    int64_t                                   key;
+    std::shared_ptr<const Excal::Model::Mesh> mesh;
+  };
+
+  // Shared with queued generation tasks, which may outlive the streamer
+  struct Generator {
+    Generator(
+      const uint32_t                    seed,
+      const App::Noise::FractalOptions& noiseOptions
+    ) : noise(seed, noiseOptions) {}
+
+    const App::Noise::NoiseGenerator noise;
+    ChunkTopology                    topology;
+    StreamingOptions                 options;
+    Excal::Model::ModelOptions       modelOptions;
+    std::atomic<bool>                cancelled{false};
+
+    std::mutex                 finishedMutex;
+    std::vector<FinishedChunk> finished;
+  };
+
+  enum class ChunkState { eGenerating, eReady, eResident };
+
+  struct Chunk {
+    ChunkState state;
+    std::shared_ptr<const Excal::Model::Mesh> mesh; // Set while eReady
+    int        slot          = -1;
+    uint64_t   lastUsedFrame = 0; // Last frame it was within loadRadius
+  };
+
+  std::shared_ptr<Generator>         generator;
+  std::unordered_map<int64_t, Chunk> chunks;
+
+  std::vector<int64_t> slotChunks; // Chunk in each slot, if it isn't free
+  std::vector<int>     freeSlots;
+  size_t               firstSlot    = 0; // Model of the first slot
+  size_t               pendingCount = 0;
+  uint64_t             frame        = 0;
+
+  void queueChunk(const int x, const int z);
+
+  // Free slot, or else the least recently used slot outside loadRadius
+  // -1 if every slot holds a chunk used this frame
+  int acquireSlot();
+};
+}
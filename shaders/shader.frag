@@ -13,6 +13,7 @@ layout(location = 1) in vec2 fragTexCoord;
 layout(location = 2) in vec3 camPos;
 layout(location = 3) in vec3 lightPos;
 layout(location = 4) in vec3 lightColor;
+layout(location = 5) in mat3 TBN;
 
 layout(location = 0) out vec4 outColor;
 
@@ -66,14 +67,12 @@ void main() {
   ));
 
   // Map from 0 to 1 (RGB) to -1 to 1 (XYZ normal vectors)
-  normal = normalize(2.0 * normal - 1.0);
+  // then from tangent space to world space
+  normal = normalize(TBN * normalize(2.0 * normal - 1.0));
 
   // TESTING Don't apply normal map to the first model
   if (pc.imgIdx == 0) {
-    normal = vec3(0.0, 0.0, -1.0);
-  }
-  if (pc.imgIdx == 1) {
-    normal.z *= -1.0; // TODO Correct normal with TBN Matrix
+    normal = normalize(TBN[2]);
   }
 
   vec3 lighting = calculateLighting(normal, vec3(fragPos));
@@ -9,25 +9,46 @@ layout(binding = 0) uniform UboView {
   vec3 lightColor;
 } uboView;
 
+// Offsets and scales dequantize packed vertices
+// They're identity transforms for float vertices
 layout(binding = 1) uniform UboInstance {
   mat4 model;
+  vec4 positionOffset;
+  vec4 positionScale;
+  vec4 texCoordTransform;
 } uboInstance;
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec2 inTexCoord;
+layout(location = 4) in vec4 inTangent;
 
 layout(location = 0) out vec4 fragPos;
 layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out vec3 camPos;
 layout(location = 3) out vec3 lightPos;
 layout(location = 4) out vec3 lightColor;
+layout(location = 5) out mat3 TBN; // Tangent to world space
 
 void main() {
-  fragTexCoord = inTexCoord;
-  fragPos      = uboInstance.model * vec4(inPosition.xyz, 1.0);
+  vec3 position = uboInstance.positionOffset.xyz
+                + uboInstance.positionScale.xyz * inPosition;
+
+  fragTexCoord = uboInstance.texCoordTransform.xy
+               + uboInstance.texCoordTransform.zw * inTexCoord;
+  fragPos      = uboInstance.model * vec4(position, 1.0);
   camPos       = uboView.camPos;
   lightPos     = uboView.lightPos;
   lightColor   = uboView.lightColor;
   gl_Position  = uboView.proj * uboView.view * fragPos;
+
+  // Models are only scaled uniformly, so the model matrix can transform normals
+  mat3 normalMatrix = mat3(uboInstance.model);
+
+  vec3 N = normalize(normalMatrix * inNormal);
+  vec3 T = normalize(normalMatrix * inTangent.xyz);
+  vec3 B = cross(N, T) * inTangent.w;
+
+  TBN = mat3(T, B, N);
 }
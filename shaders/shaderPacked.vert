@@ -0,0 +1,63 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 0) uniform UboView {
+  mat4 view;
+  mat4 proj;
+  vec3 camPos;
+  vec3 lightPos;
+  vec3 lightColor;
+} uboView;
+
+// Offsets and scales dequantize packed vertices
+layout(binding = 1) uniform UboInstance {
+  mat4 model;
+  vec4 positionOffset;
+  vec4 positionScale;
+  vec4 texCoordTransform;
+} uboInstance;
+
+// Positions, colors, and texture coordinates are unorm, and are read as floats
+// Normals and tangents are octahedral encoded
+layout(location = 0) in vec4 inPosition; // w is the tangent's handedness
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inNormal;
+layout(location = 3) in vec2 inTexCoord;
+layout(location = 4) in vec2 inTangent;
+
+layout(location = 0) out vec4 fragPos;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 camPos;
+layout(location = 3) out vec3 lightPos;
+layout(location = 4) out vec3 lightColor;
+layout(location = 5) out mat3 TBN; // Tangent to world space
+
+vec3 decodeOctahedral(vec2 e) {
+  vec3 n  = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
+void main() {
+  vec3 position = uboInstance.positionOffset.xyz
+                + uboInstance.positionScale.xyz * inPosition.xyz;
+
+  fragTexCoord = uboInstance.texCoordTransform.xy
+               + uboInstance.texCoordTransform.zw * inTexCoord;
+  fragPos      = uboInstance.model * vec4(position, 1.0);
+  camPos       = uboView.camPos;
+  lightPos     = uboView.lightPos;
+  lightColor   = uboView.lightColor;
+  gl_Position  = uboView.proj * uboView.view * fragPos;
+
+  // Models are only scaled uniformly, so the model matrix can transform normals
+  mat3 normalMatrix = mat3(uboInstance.model);
+
+  vec3 N = normalize(normalMatrix * decodeOctahedral(inNormal));
+  vec3 T = normalize(normalMatrix * decodeOctahedral(inTangent));
+  vec3 B = cross(N, T) * (inPosition.w * 2.0 - 1.0);
+
+  TBN = mat3(T, B, N);
+}
@@ -56,7 +56,6 @@ void main() {
   vec4 fragPos = uboInstance.model * vec4(inPosition.xyz, 1.0);
   gl_Position  = uboView.proj * uboView.view * fragPos;
 
-  // TODO Normals are 'streaky' try inverting them
   //vec3 transformedNormal = transpose(inverse(mat3(uboInstance.model))) * inNormal;
   //vec3 lighting = calculateLighting(transformedNormal, vec3(fragPos));
 
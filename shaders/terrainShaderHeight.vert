@@ -0,0 +1,135 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout (binding = 0) uniform UboView {
+  mat4 view;
+  mat4 proj;
+} uboView;
+
+// Dequantizes HeightVertex heights, and places them on their grid
+layout (binding = 1) uniform UboInstance {
+  mat4  model;
+  vec4  positionOffset;
+  vec4  positionScale;
+  vec4  texCoordTransform;
+  ivec4 heightGrid;       // Grid width, grid height, first vertex
+  vec4  shaderParameters; // Terrain meshHeight, waterHeight
+} uboInstance;
+
+// Only heights are stored, x and z come from gl_VertexIndex
+layout (location = 0) in float inHeight; // Unorm
+layout (location = 1) in vec2  inNormal; // Octahedral encoded
+
+layout (location = 0) out vec3 fragColor;
+
+struct Light {
+  vec3 ambient;
+  vec3 diffuse;
+  vec3 specular;
+  vec3 direction;
+};
+
+// Biomes of App::TerrainGenerator::generateBiome
+const int biomeCount = 8;
+
+const vec3 biomeColors[biomeCount] = vec3[](
+  vec3( 60,  95, 190) / 255.0, // Deep water
+  vec3( 60, 100, 190) / 255.0, // Shallow water
+  vec3(210, 215, 130) / 255.0, // Sand
+  vec3( 95, 165,  30) / 255.0, // Grass 1
+  vec3( 65, 115,  20) / 255.0, // Grass 2
+  vec3( 90,  65,  60) / 255.0, // Rock 1
+  vec3( 75,  60,  55) / 255.0, // Rock 2
+  vec3(255, 255, 255) / 255.0  // Snow
+);
+
+vec3 getBiomeColor(float height) {
+  float meshHeight  = uboInstance.shaderParameters.x;
+  float waterHeight = uboInstance.shaderParameters.y;
+
+  // Fractions of meshHeight
+  float biomeHeights[biomeCount] = float[](
+    waterHeight * 0.5, waterHeight, 0.15, 0.30, 0.40, 0.50, 0.80, 1.0
+  );
+
+  for (int i=0; i < biomeCount - 1; i++) {
+    if (height <= biomeHeights[i] * meshHeight) {
+      return biomeColors[i];
+    }
+  }
+  return biomeColors[biomeCount - 1];
+}
+
+// Column and row of a vertex in its grid (see Excal::Model::Mesh::gridWidth)
+// Skirt vertices after the grid go around its edges
+vec2 getGridPosition(int vertex) {
+  int width  = uboInstance.heightGrid.x;
+  int height = uboInstance.heightGrid.y;
+
+  if (vertex < width * height) {
+    return vec2(vertex % width, vertex / width);
+  }
+
+  int skirt = vertex - width * height;
+
+  if (skirt < width) {
+    return vec2(skirt, 0);
+  }
+  skirt -= width;
+
+  if (skirt < height) {
+    return vec2(width - 1, skirt);
+  }
+  skirt -= height;
+
+  if (skirt < width) {
+    return vec2(width - 1 - skirt, height - 1);
+  }
+  skirt -= width;
+
+  return vec2(0, height - 1 - skirt);
+}
+
+vec3 decodeOctahedral(vec2 e) {
+  vec3 n  = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
+vec3 calculateLighting(vec3 Normal, vec3 FragPos) {
+  // TODO Define this in engine config
+  Light light;
+  light.ambient   = vec3(0.2, 0.2, 0.2);
+  light.diffuse   = vec3(0.5, 0.5, 0.5);
+  light.specular  = vec3(1.0, 1.0, 1.0);
+  light.direction = vec3(-0.2f, -1.0f, -0.3);
+
+  // Ambient lighting
+  vec3 ambient = light.ambient;
+
+  // Diffuse lighting
+  vec3 norm     = normalize(Normal);
+  vec3 lightDir = normalize(-light.direction);
+  float diff    = max(dot(lightDir, norm), 0.0);
+  vec3 diffuse  = light.diffuse * diff;
+
+  return (ambient + diffuse);
+}
+
+void main() {
+  // gl_VertexIndex includes the model's offset in the vertex buffer
+  vec2 gridPosition = getGridPosition(gl_VertexIndex - uboInstance.heightGrid.z);
+
+  vec3 position = uboInstance.positionOffset.xyz
+                + uboInstance.positionScale.xyz
+                  * vec3(gridPosition.x, inHeight, gridPosition.y);
+
+  vec4 fragPos = uboInstance.model * vec4(position, 1.0);
+  gl_Position  = uboView.proj * uboView.view * fragPos;
+
+  vec3 lighting = calculateLighting(decodeOctahedral(inNormal), vec3(fragPos));
+
+  fragColor = getBiomeColor(position.y) * lighting;
+}
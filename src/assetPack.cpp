@@ -0,0 +1,384 @@
+#include "assetPack.h"
+
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "meshCodec.h"
+
+namespace Excal::AssetPack
+{
+namespace
+{
+const char assetPackMagic[8] = { 'E', 'X', 'C', 'A', 'L', 'P', 'A', 'K' };
+
+struct MountedPack {
+  std::shared_ptr<const Excal::Utils::MappedFile> file;
+  std::unordered_map<std::string, const PackEntry*> meshes;
+  std::unordered_map<std::string, const PackEntry*> textures;
+};
+
+// Later mounts take precedence over earlier ones
+std::mutex               packsMutex;
+std::vector<MountedPack> packs;
+
+uint64_t align(const uint64_t offset)
+{
+  return (offset + packAlignment - 1) & ~(packAlignment - 1);
+}
+
+// Appends blobs at aligned offsets, and records where they were written
+class BlobWriter
+{
+public:
+  BlobWriter(std::ofstream& file, const uint64_t offset)
+    : file(file), offset(offset) {}
+
+  Range write(const void* data, const uint64_t size)
+  {
+    pad();
+
+    Range range = { offset, size };
+    file.write(static_cast<const char*>(data), size);
+    offset += size;
+
+    return range;
+  }
+
+  void pad()
+  {
+    static const char zeros[packAlignment] = {};
+
+    const uint64_t aligned = align(offset);
+    file.write(zeros, aligned - offset);
+    offset = aligned;
+  }
+
+  uint64_t getOffset() const { return offset; }
+
+private:
+  std::ofstream& file;
+  uint64_t       offset;
+};
+
+template <typename T>
+const T* getBlob(
+  const Excal::Utils::MappedFile& file,
+  const Range&                    range
+) {
+  return reinterpret_cast<const T*>(file.data() + range.offset);
+}
+
+bool isInFile(const Range& range, const size_t fileSize)
+{
+  return range.offset <= fileSize && range.size <= fileSize - range.offset;
+}
+}
+
+void writePack(
+  const std::string&               packPath,
+  const std::vector<MeshAsset>&    meshes,
+  const std::vector<TextureAsset>& textures,
+  const bool                       compress
+) {
+  // Write to a temporary file first and rename it into place, so a
+  // running app never mounts a partially written pack
+  const auto tmpPath = packPath + ".tmp";
+
+  std::ofstream file(tmpPath, std::ios::out | std::ios::binary);
+
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open " + tmpPath + " for writing");
+  }
+
+  PackHeader header{};
+
+  memcpy(header.magic, assetPackMagic, sizeof(assetPackMagic));
+  header.version       = assetPackVersion;
+  header.vertexStride  = sizeof(Vertex);
+  header.lodStride     = sizeof(Excal::Model::Lod);
+  header.meshletStride = sizeof(Excal::MeshOptimizer::Meshlet);
+  header.entryCount    = meshes.size() + textures.size();
+
+  // Header is written again once the table of contents' offset is known
+  file.write((const char*) &header, sizeof(header));
+
+  BlobWriter blobs(file, sizeof(header));
+
+  std::vector<PackEntry> entries;
+  std::string            names;
+
+  auto addName = [&](PackEntry& entry, const std::string& name) {
+    entry.name = { names.size(), name.size() };
+    names += name;
+  };
+
+  for (const auto& asset : meshes) {
+    const auto& mesh    = *asset.mesh;
+    const auto& indices = Excal::Model::getIndices(mesh);
+
+    PackEntry entry{};
+    entry.type           = EntryType::eMesh;
+    entry.boundingRadius = mesh.boundingRadius;
+    entry.vertexCount    = Excal::Model::getVertexCount(mesh);
+    entry.indexCount     = indices.size();
+
+    const auto quantization = Excal::Model::getVertexQuantization(mesh);
+
+    for (int i=0; i < 3; i++) {
+      entry.boundsCenter[i]   = mesh.boundsCenter[i];
+      entry.positionOffset[i] = quantization.positionOffset[i];
+      entry.positionScale[i]  = quantization.positionScale[i];
+    }
+
+    for (int i=0; i < 2; i++) {
+      entry.texCoordOffset[i] = quantization.texCoordOffset[i];
+      entry.texCoordScale[i]  = quantization.texCoordScale[i];
+    }
+
+    addName(entry, asset.key);
+
+    // GLB meshes are read from their file, so they're gathered first
+    std::vector<Vertex> vertices(entry.vertexCount);
+    Excal::Model::writeVertices(mesh, vertices.data());
+
+    if (compress) {
+      const auto encodedVertices = Excal::MeshCodec::encodeVertices(
+        vertices.data(), vertices.size(), sizeof(Vertex)
+      );
+      const auto encodedIndices = Excal::MeshCodec::encodeIndices(
+        indices.data(), indices.size()
+      );
+
+      entry.flags   |= entryFlagCompressed;
+      entry.vertices = blobs.write(encodedVertices.data(), encodedVertices.size());
+      entry.indices  = blobs.write(encodedIndices.data(),  encodedIndices.size());
+    } else {
+      entry.vertices = blobs.write(vertices.data(), vertices.size() * sizeof(Vertex));
+      entry.indices  = blobs.write(indices.data(),  indices.size()  * sizeof(uint32_t));
+    }
+
+    entry.lods     = blobs.write(mesh.lods.data(), mesh.lods.size() * sizeof(Excal::Model::Lod));
+    entry.meshlets = blobs.write(
+      mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Excal::MeshOptimizer::Meshlet)
+    );
+
+    entries.push_back(entry);
+  }
+
+  for (const auto& asset : textures) {
+    if (asset.pixels.size() != size_t(asset.width) * asset.height * 4) {
+      throw std::runtime_error(asset.path + " doesn't have width * height RGBA pixels");
+    }
+
+    PackEntry entry{};
+    entry.type   = EntryType::eTexture;
+    entry.width  = asset.width;
+    entry.height = asset.height;
+    entry.pixels = blobs.write(asset.pixels.data(), asset.pixels.size());
+
+    addName(entry, asset.path);
+
+    entries.push_back(entry);
+  }
+
+  // Names are stored after the table of contents, relative to its end
+  blobs.pad();
+  header.tocOffset = blobs.getOffset();
+
+  file.write((const char*) entries.data(), entries.size() * sizeof(PackEntry));
+  file.write(names.data(), names.size());
+
+  file.seekp(0);
+  file.write((const char*) &header, sizeof(header));
+  file.close();
+
+  if (!file) {
+    throw std::runtime_error("failed to write " + tmpPath);
+  }
+
+  if (std::rename(tmpPath.c_str(), packPath.c_str()) != 0) {
+    std::remove(tmpPath.c_str());
+    throw std::runtime_error("failed to move " + tmpPath + " to " + packPath);
+  }
+}
+
+bool mount(const std::string& packPath)
+{
+  uint64_t fileSize;
+  int64_t  fileMtime;
+
+  if (!Excal::Utils::getFileInfo(packPath, fileSize, fileMtime)) {
+    return false;
+  }
+
+  MountedPack pack;
+  pack.file = std::make_shared<const Excal::Utils::MappedFile>(packPath);
+
+  const auto& file = *pack.file;
+
+  if (file.size() < sizeof(PackHeader)) {
+    throw std::runtime_error(packPath + " is too small to be an asset pack");
+  }
+
+  PackHeader header;
+  memcpy(&header, file.data(), sizeof(header));
+
+  if (memcmp(header.magic, assetPackMagic, sizeof(assetPackMagic)) != 0) {
+    throw std::runtime_error(packPath + " isn't an asset pack");
+  }
+
+  if (   header.version       != assetPackVersion
+      || header.vertexStride  != sizeof(Vertex)
+      || header.lodStride     != sizeof(Excal::Model::Lod)
+      || header.meshletStride != sizeof(Excal::MeshOptimizer::Meshlet)
+  ) {
+    throw std::runtime_error(
+      packPath + " was baked by a different version of excal-bake, bake it again"
+    );
+  }
+
+  const Range toc = { header.tocOffset, header.entryCount * sizeof(PackEntry) };
+
+  if (!isInFile(toc, file.size()) || header.entryCount > file.size()) {
+    throw std::runtime_error(packPath + " has a truncated table of contents");
+  }
+
+  const auto*    entries     = getBlob<PackEntry>(file, toc);
+  const uint64_t namesOffset = toc.offset + toc.size;
+
+  for (uint64_t i=0; i < header.entryCount; i++) {
+    const auto& entry = entries[i];
+
+    const Range name = { namesOffset + entry.name.offset, entry.name.size };
+
+    bool valid = entry.name.offset <= file.size() && isInFile(name, file.size());
+
+    for (const auto* range : {
+      &entry.vertices, &entry.indices, &entry.lods, &entry.meshlets, &entry.pixels
+    }) {
+      valid = valid && isInFile(*range, file.size()) && range->offset % packAlignment == 0;
+    }
+
+    const bool compressed = entry.flags & entryFlagCompressed;
+
+    if (entry.type == EntryType::eTexture) {
+      valid = valid && entry.pixels.size == uint64_t(entry.width) * entry.height * 4;
+    } else if (entry.type == EntryType::eMesh && !compressed) {
+      valid = valid && entry.vertices.size == entry.vertexCount * sizeof(Vertex)
+                    && entry.indices.size  == entry.indexCount  * sizeof(uint32_t);
+    } else if (entry.type != EntryType::eMesh) {
+      valid = false;
+    }
+
+    if (!valid) {
+      throw std::runtime_error(packPath + " has an invalid entry " + std::to_string(i));
+    }
+
+    auto& names = entry.type == EntryType::eMesh ? pack.meshes : pack.textures;
+    names[std::string(file.data() + name.offset, name.size)] = &entry;
+  }
+
+  std::lock_guard<std::mutex> lock(packsMutex);
+  packs.push_back(std::move(pack));
+
+  return true;
+}
+
+void unmountAll()
+{
+  std::lock_guard<std::mutex> lock(packsMutex);
+
+  packs.clear();
+}
+
+std::shared_ptr<const Excal::Model::Mesh> findMesh(const std::string& meshKey)
+{
+  std::lock_guard<std::mutex> lock(packsMutex);
+
+  for (auto pack = packs.rbegin(); pack != packs.rend(); pack++) {
+    auto it = pack->meshes.find(meshKey);
+    if (it == pack->meshes.end()) {
+      continue;
+    }
+
+    const auto& entry = *it->second;
+    const auto& file  = *pack->file;
+
+    auto mesh = std::make_shared<Excal::Model::Mesh>();
+
+    // Vertices stay in the pack until they're uploaded, the other blobs
+    // are small and read on the CPU, so they're copied
+    mesh->mappedVertices.file  = pack->file;
+    mesh->mappedVertices.count = entry.vertexCount;
+
+    auto& quantization = mesh->mappedVertices.quantization;
+
+    quantization.positionOffset = glm::vec3(
+      entry.positionOffset[0], entry.positionOffset[1], entry.positionOffset[2]
+    );
+    quantization.positionScale = glm::vec3(
+      entry.positionScale[0], entry.positionScale[1], entry.positionScale[2]
+    );
+    quantization.texCoordOffset = glm::vec2(entry.texCoordOffset[0], entry.texCoordOffset[1]);
+    quantization.texCoordScale  = glm::vec2(entry.texCoordScale[0],  entry.texCoordScale[1]);
+
+    const auto* lods     = getBlob<Excal::Model::Lod>(file, entry.lods);
+    const auto* meshlets = getBlob<Excal::MeshOptimizer::Meshlet>(file, entry.meshlets);
+
+    if (entry.flags & entryFlagCompressed) {
+      mesh->mappedVertices.encodedData = getBlob<uint8_t>(file, entry.vertices);
+      mesh->mappedVertices.encodedSize = entry.vertices.size;
+
+      mesh->indices.resize(entry.indexCount);
+      Excal::MeshCodec::decodeIndices(
+        getBlob<uint8_t>(file, entry.indices), entry.indices.size,
+        entry.indexCount, mesh->indices.data()
+      );
+    } else {
+      const auto* indices = getBlob<uint32_t>(file, entry.indices);
+
+      mesh->mappedVertices.data = getBlob<Vertex>(file, entry.vertices);
+      mesh->indices.assign(indices, indices + entry.indexCount);
+    }
+    mesh->lods.assign(lods, lods + entry.lods.size / sizeof(Excal::Model::Lod));
+    mesh->meshlets.assign(
+      meshlets, meshlets + entry.meshlets.size / sizeof(Excal::MeshOptimizer::Meshlet)
+    );
+
+    mesh->boundsCenter = glm::vec3(
+      entry.boundsCenter[0], entry.boundsCenter[1], entry.boundsCenter[2]
+    );
+    mesh->boundingRadius = entry.boundingRadius;
+
+    return mesh;
+  }
+
+  return nullptr;
+}
+
+bool findTexture(const std::string& texturePath, TextureView& texture)
+{
+  std::lock_guard<std::mutex> lock(packsMutex);
+
+  for (auto pack = packs.rbegin(); pack != packs.rend(); pack++) {
+    auto it = pack->textures.find(texturePath);
+    if (it == pack->textures.end()) {
+      continue;
+    }
+
+    const auto& entry = *it->second;
+
+    texture.file   = pack->file;
+    texture.pixels = getBlob<uint8_t>(*pack->file, entry.pixels);
+    texture.width  = entry.width;
+    texture.height = entry.height;
+
+    return true;
+  }
+
+  return false;
+}
+}
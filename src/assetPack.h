@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "model.h"
+#include "utils.h"
+
+// Asset packs, written offline by excal-bake (tools/bake.cpp)
+// A pack holds welded and optimized meshes and decoded textures, in the
+// layout they're uploaded in, so the engine can memory map the pack and
+// copy ranges of it straight to staging buffers
+// Layout: PackHeader | blobs | PackEntry table of contents | names
+// Blobs start at multiples of packAlignment
+namespace Excal::AssetPack
+{
+// Bump whenever the layout of the header, entries, or blobs changes
+const uint32_t assetPackVersion = 3;
+const uint64_t packAlignment    = 64;
+
+enum class EntryType : uint32_t { eMesh = 0, eTexture = 1 };
+
+// Mesh vertices and indices are encoded with Excal::MeshCodec
+const uint32_t entryFlagCompressed = 1;
+
+// Byte range of the pack
+struct Range {
+  uint64_t offset = 0;
+  uint64_t size   = 0;
+};
+
+struct PackHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t vertexStride;
+  uint32_t lodStride;
+  uint32_t meshletStride;
+  uint64_t entryCount;
+  uint64_t tocOffset;
+};
+
+struct PackEntry {
+  EntryType type;
+  uint32_t  width;  // Texture size in pixels
+  uint32_t  height;
+  float     boundsCenter[3]; // Mesh bounding sphere
+  float     boundingRadius;
+
+  // Mesh vertex quantization (see Excal::Model::getVertexQuantization),
+  // so packing compressed vertices doesn't decode them to find it
+  float     positionOffset[3];
+  float     positionScale[3];
+  float     texCoordOffset[2];
+  float     texCoordScale[2];
+  uint32_t  flags;
+  uint64_t  vertexCount; // Mesh element counts, since blobs may be compressed
+  uint64_t  indexCount;
+  Range     name;     // Mesh key (see MeshRegistry::getMeshKey) or texture path
+  Range     vertices; // Mesh blobs, arrays of Vertex, uint32_t, Lod, and Meshlet
+                      // Vertices and indices are encoded if compressed
+  Range     indices;
+  Range     lods;
+  Range     meshlets;
+  Range     pixels;   // Texture blob, R8G8B8A8 sRGB rows
+};
+
+struct MeshAsset {
+  std::string                               key;
+  std::shared_ptr<const Excal::Model::Mesh> mesh;
+};
+
+struct TextureAsset {
+  std::string          path;
+  uint32_t             width  = 0;
+  uint32_t             height = 0;
+  std::vector<uint8_t> pixels;
+};
+
+// compress encodes mesh vertices and indices with Excal::MeshCodec, which
+// makes packs smaller to read from disk, at the cost of decoding them
+// when they're uploaded
+// Throws if the pack can't be written
+void writePack(
+  const std::string&               packPath,
+  const std::vector<MeshAsset>&    meshes,
+  const std::vector<TextureAsset>& textures,
+  const bool                       compress = false
+);
+
+// Mounts a pack, after which the meshes and textures in it are read from
+// the mapped pack instead of being loaded from their source files
+// Returns false if there is no file at packPath, and throws if the file
+// isn't a valid pack or was baked by a different version of the engine
+bool mount(const std::string& packPath);
+
+void unmountAll();
+
+// Mesh in a mounted pack, with vertices read from the mapped pack
+// Compressed indices are decoded, compressed vertices stay encoded until
+// they're written to a staging buffer
+// nullptr if no mounted pack has a mesh with meshKey
+std::shared_ptr<const Excal::Model::Mesh> findMesh(const std::string& meshKey);
+
+// Pixels of a texture in the mapped pack, kept alive by file
+struct TextureView {
+  std::shared_ptr<const Excal::Utils::MappedFile> file;
+  const uint8_t* pixels = nullptr;
+  uint32_t       width  = 0;
+  uint32_t       height = 0;
+};
+
+// Returns false if no mounted pack has a texture with texturePath
+bool findTexture(const std::string& texturePath, TextureView& texture);
+}
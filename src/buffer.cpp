@@ -12,6 +12,7 @@
 
 #include <vector>
 #include <chrono>
+#include <optional>
 #include <math.h>
 #include <iostream>
 
@@ -20,10 +21,30 @@
 #include "model.h"
 #include "utils.h"
 #include "camera.h"
+#include "culling.h"
 #include "light.h"
 
 namespace Excal::Buffer
 {
+namespace
+{
+glm::mat4 getProjection(
+  const vk::Extent2D& swapchainExtent,
+  const float         farClipPlane
+) {
+  auto proj = glm::perspective(
+    glm::radians(45.0f),
+    swapchainExtent.width / (float) swapchainExtent.height,
+    0.1f, farClipPlane
+  );
+
+  // Invert Y axis to acccount for difference between OpenGL and Vulkan
+  proj[1][1] *= -1;
+
+  return proj;
+}
+}
+
 vk::Buffer createBuffer(
   VmaAllocator&                  allocator,
   VmaAllocation&                 bufferAllocation,
@@ -50,101 +71,129 @@ vk::Buffer createBuffer(
 }
 
 std::vector<vk::CommandBuffer> createCommandBuffers(
-  const vk::Device&                     device,
-  const vk::CommandPool&                commandPool,
-  const std::vector<VkFramebuffer>&     swapchainFramebuffers,
-  const vk::Extent2D                    swapchainExtent,
-  const vk::Pipeline&                   graphicsPipeline,
-  const vk::PipelineLayout&             pipelineLayout,
-  const std::vector<uint32_t>&          indexCounts,
-  const std::vector<uint32_t>&          vertexCounts,
-  const vk::Buffer&                     indexBuffer,
-  const vk::Buffer&                     vertexBuffer,
-  const vk::RenderPass&                 renderPass,
-  const std::vector<vk::DescriptorSet>& descriptorSets,
-  const size_t                          dynamicAlignment,
-  const glm::vec4&                      clearColor
+  const vk::Device&                 device,
+  const vk::CommandPool&            commandPool,
+  const std::vector<VkFramebuffer>& swapchainFramebuffers
 ) {
-  std::vector<vk::CommandBuffer> commandBuffers(swapchainFramebuffers.size());
-
-  commandBuffers = device.allocateCommandBuffers(
+  return device.allocateCommandBuffers(
     vk::CommandBufferAllocateInfo(
       commandPool,
       vk::CommandBufferLevel::ePrimary,
-      commandBuffers.size()
+      swapchainFramebuffers.size()
     )
   );
+}
 
-  for (size_t nCmdBuffer=0; nCmdBuffer < commandBuffers.size(); nCmdBuffer++) {
-    vk::CommandBuffer& cmd = commandBuffers[nCmdBuffer];
+void recordCommandBuffer(
+  const vk::CommandBuffer&          cmd,
+  const VkFramebuffer&              swapchainFramebuffer,
+  const vk::Extent2D                swapchainExtent,
+  const vk::Pipeline&               graphicsPipeline,
+  const vk::PipelineLayout&         pipelineLayout,
+  const vk::Buffer&                 indirectBuffer,
+  const std::vector<uint32_t>&      firstDraws,
+  const std::vector<uint32_t>&      drawCounts,
+  const std::vector<int>&           textureIndices,
+  const bool                        multiDrawIndirect,
+  const vk::Buffer&                 indexBuffer,
+  const vk::Buffer&                 shortIndexBuffer,
+  const std::vector<vk::IndexType>& indexTypes,
+  const vk::Buffer&                 vertexBuffer,
+  const vk::RenderPass&             renderPass,
+  const vk::DescriptorSet&          descriptorSet,
+  const size_t                      dynamicAlignment,
+  const glm::vec4&                  clearColor
+) {
+  std::array<vk::ClearValue, 2> clearValues{
+    vk::ClearColorValue(std::array<float, 4>{
+      clearColor.r, clearColor.g, clearColor.b, clearColor.a,
+    }),
+    vk::ClearDepthStencilValue(1.0f, 0)
+  };
+
+  cmd.reset({});
+  cmd.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+
+  cmd.beginRenderPass(
+    vk::RenderPassBeginInfo(
+      renderPass,
+      swapchainFramebuffer,
+      vk::Rect2D({0, 0}, swapchainExtent),
+      clearValues.size(), clearValues.data()
+    ),
+    vk::SubpassContents::eInline
+  );
 
-    std::array<vk::ClearValue, 2> clearValues{
-      vk::ClearColorValue(std::array<float, 4>{
-        clearColor.r, clearColor.g, clearColor.b, clearColor.a,
-      }),
-      vk::ClearDepthStencilValue(1.0f, 0)
-    };
+  vk::Viewport viewport(
+    0.0f, 0.0f,
+    (float) swapchainExtent.width,
+    (float) swapchainExtent.height,
+    0.0f, 1.0f
+  );
+  vk::Rect2D scissor({0, 0}, swapchainExtent);
 
-    cmd.begin(vk::CommandBufferBeginInfo());
+  cmd.setViewport(0, 1, &viewport);
+  cmd.setScissor(0, 1, &scissor);
 
-    cmd.beginRenderPass(
-      vk::RenderPassBeginInfo(
-        renderPass,
-        swapchainFramebuffers[nCmdBuffer],
-        vk::Rect2D({0, 0}, swapchainExtent),
-        clearValues.size(), clearValues.data()
-      ),
-      vk::SubpassContents::eInline
-    );
+  cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline);
 
-    vk::Viewport viewport(
-      0.0f, 0.0f,
-      (float) swapchainExtent.width,
-      (float) swapchainExtent.height,
-      0.0f, 1.0f
-    );
-    vk::Rect2D scissor({0, 0}, swapchainExtent);
+  vk::DeviceSize offsets[] = {0};
 
-    cmd.setViewport(0, 1, &viewport);
-    cmd.setScissor(0, 1, &scissor);
+  cmd.bindVertexBuffers(0, 1, &vertexBuffer, offsets);
 
-    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline);
+  // Only rebound when the index type changes between models
+  std::optional<vk::IndexType> boundIndexType;
 
-    vk::DeviceSize offsets[] = {0};
+  for (size_t i=0; i < drawCounts.size(); i++) {
+    // Hidden, or every meshlet was culled
+    if (drawCounts[i] == 0) {
+      continue;
+    }
 
-    cmd.bindVertexBuffers(0, 1, &vertexBuffer, offsets);
-    cmd.bindIndexBuffer(indexBuffer, 0, vk::IndexType::eUint32);
+    if (boundIndexType != indexTypes[i]) {
+      cmd.bindIndexBuffer(
+        indexTypes[i] == vk::IndexType::eUint16 ? shortIndexBuffer : indexBuffer,
+        0, indexTypes[i]
+      );
+      boundIndexType = indexTypes[i];
+    }
 
-    uint32_t firstIndex   = 0;
-    uint32_t vertexOffset = 0;
+    // Dynamic descriptor
+    uint32_t dynamicOffset = i * static_cast<uint32_t>(dynamicAlignment);
 
-    for (int i=0; i < indexCounts.size(); i++) {
-      // Dynamic descriptor
-      uint32_t dynamicOffset = i * static_cast<uint32_t>(dynamicAlignment);
+    cmd.bindDescriptorSets(
+      vk::PipelineBindPoint::eGraphics,
+      pipelineLayout, 0, 1,
+      &descriptorSet,
+      1, &dynamicOffset
+    );
 
-      cmd.bindDescriptorSets(
-        vk::PipelineBindPoint::eGraphics,
-        pipelineLayout, 0, 1,
-        &descriptorSets[nCmdBuffer],
-        1, &dynamicOffset
-      );
+    // Push constant corresponds to index of texture array for current model
+    cmd.pushConstants(
+      pipelineLayout, vk::ShaderStageFlagBits::eFragment,
+      0, sizeof(int), &textureIndices[i]
+    );
 
-      // Push constant corresponds to index of texture array for current model
-      cmd.pushConstants(
-        pipelineLayout, vk::ShaderStageFlagBits::eFragment,
-        0, sizeof(int), &i
-      );
+    // Index ranges and vertex offsets are written by updateIndirectBuffer
+    const vk::DeviceSize stride = sizeof(vk::DrawIndexedIndirectCommand);
 
-      cmd.drawIndexed(indexCounts[i], 1, firstIndex, vertexOffset, 0);
-      firstIndex   += indexCounts[i];
-      vertexOffset += vertexCounts[i];
+    if (multiDrawIndirect) {
+      cmd.drawIndexedIndirect(
+        indirectBuffer, firstDraws[i] * stride,
+        drawCounts[i], stride
+      );
+    } else {
+      for (uint32_t j=0; j < drawCounts[i]; j++) {
+        cmd.drawIndexedIndirect(
+          indirectBuffer, (firstDraws[i] + j) * stride,
+          1, stride
+        );
+      }
     }
-
-    cmd.endRenderPass();
-    cmd.end();
   }
 
-  return commandBuffers;
+  cmd.endRenderPass();
+  cmd.end();
 }
 
 std::vector<VkFramebuffer> createFramebuffers(
@@ -245,6 +294,33 @@ std::vector<vk::Buffer> createDynamicUniformBuffers(
   return dynamicUniformBuffers;
 }
 
+std::vector<vk::Buffer> createIndirectBuffers(
+  const vk::PhysicalDevice&   physicalDevice,
+  const vk::Device&           device,
+  VmaAllocator&               allocator,
+  std::vector<VmaAllocation>& bufferAllocations,
+  const int                   nDraws
+) {
+  vk::DeviceSize bufferSize = nDraws * sizeof(vk::DrawIndexedIndirectCommand);
+
+  std::vector<vk::Buffer> indirectBuffers(bufferAllocations.size());
+
+  VmaAllocationCreateInfo allocInfo = {};
+  allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+
+  for (size_t i=0; i < bufferAllocations.size(); i++) {
+    indirectBuffers[i] = Excal::Buffer::createBuffer(
+      allocator,      bufferAllocations[i], allocInfo,
+      physicalDevice, device,               bufferSize,
+      vk::BufferUsageFlagBits::eIndirectBuffer,
+        vk::MemoryPropertyFlagBits::eHostVisible
+      | vk::MemoryPropertyFlagBits::eHostCoherent
+    );
+  }
+
+  return indirectBuffers;
+}
+
 void updateUniformBuffer(
   VmaAllocator&               allocator,
   std::vector<VmaAllocation>& bufferAllocations,
@@ -258,11 +334,7 @@ void updateUniformBuffer(
   UniformBufferObject ubo{};
 
   ubo.view = camera.getView();
-  ubo.proj = glm::perspective(
-    glm::radians(45.0f),
-    swapchainExtent.width / (float) swapchainExtent.height,
-    0.1f, farClipPlane
-  );
+  ubo.proj = getProjection(swapchainExtent, farClipPlane);
 
   light.patrol();
 
@@ -270,9 +342,6 @@ void updateUniformBuffer(
   ubo.lightPos   = light.getPos();
   ubo.lightColor = light.color;
 
-  // Invert Y axis to acccount for difference between OpenGL and Vulkan
-  ubo.proj[1][1] *= -1;
-
   // TODO Don't map and unmap data every frame.
   // Refer to other TODO in this file
   void* mappedData;
@@ -289,7 +358,8 @@ void updateDynamicUniformBuffer(
   const vk::Device&                  device,
   const vk::Extent2D&                swapchainExtent,
   const uint32_t                     currentImage,
-  const std::vector<Excal::Model::Model>& models
+  const std::vector<Excal::Model::Model>& models,
+  const std::vector<int32_t>&        vertexOffsets
 ) {
   static auto startTime = std::chrono::high_resolution_clock::now();
   auto currentTime      = std::chrono::high_resolution_clock::now();
@@ -299,20 +369,36 @@ void updateDynamicUniformBuffer(
   ).count();
 
   for (uint32_t i=0; i < models.size(); i++) {
-    glm::mat4* modelMat = (glm::mat4*)(
+    auto* ubo = (DynamicUniformBufferObject*)(
       ((uint64_t) uboDynamicData.model + (i * dynamicAlignment))
     );
 
     auto pos = models[i].position;
 
-    *modelMat = glm::translate(glm::mat4(1.0f), pos);
-    *modelMat = glm::scale(*modelMat, glm::vec3(models[i].scale));
+    ubo->model = glm::translate(glm::mat4(1.0f), pos);
+    ubo->model = glm::scale(ubo->model, glm::vec3(models[i].scale));
 
-    *modelMat = glm::rotate(
-      *modelMat,
+    ubo->model = glm::rotate(
+      ubo->model,
       (models[i].rotationsPerSecond * time) * glm::radians(360.0f),
       glm::vec3(0.0f, 1.0f, 0.0f) // Rotation axis
     );
+
+    // Kept out of the model matrix, which culling expects in model space
+    const auto& quantization = models[i].quantization;
+
+    ubo->positionOffset    = glm::vec4(quantization.positionOffset, 0.0);
+    ubo->positionScale     = glm::vec4(quantization.positionScale,  1.0);
+    ubo->texCoordTransform = glm::vec4(
+      quantization.texCoordOffset, quantization.texCoordScale
+    );
+
+    const auto& mesh = *models[i].mesh;
+
+    ubo->heightGrid = glm::ivec4(
+      mesh.gridWidth, mesh.gridHeight, vertexOffsets[i], 0
+    );
+    ubo->shaderParameters = models[i].shaderParameters;
   }
 
   // TODO Mapping and unmapping data every frame just to change a matrix is inefficient
@@ -325,6 +411,156 @@ void updateDynamicUniformBuffer(
   vmaUnmapMemory(allocator, bufferAllocations[currentImage]);
 }
 
+void updateIndirectBuffer(
+  VmaAllocator&                           allocator,
+  std::vector<VmaAllocation>&             bufferAllocations,
+  const vk::Extent2D&                     swapchainExtent,
+  const uint32_t                          currentImage,
+  const float                             farClipPlane,
+  const Excal::Camera&                    camera,
+  const std::vector<Excal::Model::Model>& models,
+  const UboDynamicData&                   uboDynamicData,
+  const size_t                            dynamicAlignment,
+  const std::vector<uint32_t>&            firstIndices,
+  const std::vector<int32_t>&             vertexOffsets,
+  const float                             maxPixelError,
+  const bool                              clockwise,
+  std::vector<uint32_t>&                  firstDraws,
+  std::vector<uint32_t>&                  drawCounts
+) {
+  const auto  proj     = getProjection(swapchainExtent, farClipPlane);
+  const auto  viewProj = proj * camera.getView();
+
+  // Height in pixels of 1 unit at a distance of 1
+  const float pixelsPerUnit = fabs(proj[1][1]) * swapchainExtent.height / 2.0f;
+
+  void* mappedData;
+  vmaMapMemory(allocator, bufferAllocations[currentImage], &mappedData);
+
+  auto commands = static_cast<vk::DrawIndexedIndirectCommand*>(mappedData);
+
+  firstDraws.assign(models.size(), 0);
+  drawCounts.assign(models.size(), 0);
+
+  // Draws of every model are packed together, so only draws that are
+  // issued are written
+  uint32_t totalDrawCount = 0;
+
+  for (size_t i=0; i < models.size(); i++) {
+    const auto& model = models[i];
+    auto modelCommands = commands + totalDrawCount;
+
+    if (!model.visible) {
+      continue;
+    }
+
+    const auto lod = Excal::Model::selectLod(
+      model, camera.pos, pixelsPerUnit, maxPixelError
+    );
+
+    uint32_t drawCount = 0;
+
+    if (lod.meshletCount == 0) {
+      modelCommands[drawCount++] = vk::DrawIndexedIndirectCommand(
+        lod.indexCount, 1,
+        firstIndices[i] + lod.firstIndex,
+        vertexOffsets[i], 0
+      );
+    } else {
+      const glm::mat4& modelMat = *(const glm::mat4*)(
+        ((uint64_t) uboDynamicData.model + (i * dynamicAlignment))
+      );
+
+      // Meshlets are tested in model space
+      const auto frustum   = Excal::Culling::getFrustum(viewProj * modelMat);
+      const auto cameraPos = glm::vec3(glm::inverse(modelMat) * glm::vec4(camera.pos, 1.0f));
+
+      for (uint32_t j = lod.firstMeshlet; j < lod.firstMeshlet + lod.meshletCount; j++) {
+        const auto& meshlet = model.mesh->meshlets[j];
+
+        if (!Excal::Culling::isMeshletVisible(meshlet, frustum, cameraPos, clockwise)) {
+          continue;
+        }
+
+        const uint32_t firstIndex = firstIndices[i] + meshlet.firstIndex;
+
+        // Meshlets cover consecutive index ranges, so visible neighbours
+        // are merged into one draw
+        if (   drawCount > 0
+            &&   modelCommands[drawCount - 1].firstIndex
+               + modelCommands[drawCount - 1].indexCount == firstIndex
+        ) {
+          modelCommands[drawCount - 1].indexCount += meshlet.indexCount;
+        } else {
+          modelCommands[drawCount++] = vk::DrawIndexedIndirectCommand(
+            meshlet.indexCount, 1, firstIndex, vertexOffsets[i], 0
+          );
+        }
+      }
+    }
+
+    firstDraws[i]   = totalDrawCount;
+    drawCounts[i]   = drawCount;
+    totalDrawCount += drawCount;
+  }
+
+  vmaUnmapMemory(allocator, bufferAllocations[currentImage]);
+}
+
+vk::Buffer createVkBuffer(
+  VmaAllocator&                     allocator,
+  VmaAllocation&                    bufferAllocation,
+  const vk::PhysicalDevice&         physicalDevice,
+  const vk::Device&                 device,
+  const vk::DeviceSize              bufferSize,
+  const std::function<void(void*)>& writeData,
+  const vk::CommandPool&            commandPool,
+  const vk::Queue&                  cmdQueue,
+  const vk::BufferUsageFlagBits&    usage
+) {
+  // Staging buffer is on the CPU
+  VmaAllocationCreateInfo stagingAllocInfo = {};
+  stagingAllocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+
+  VmaAllocation stagingBufferAllocation;
+
+  auto stagingBuffer = Excal::Buffer::createBuffer(
+    allocator,      stagingBufferAllocation, stagingAllocInfo,
+    physicalDevice, device,                  bufferSize,
+    vk::BufferUsageFlagBits::eTransferSrc,
+      vk::MemoryPropertyFlagBits::eHostVisible
+    | vk::MemoryPropertyFlagBits::eHostCoherent
+  );
+
+  void* mappedData;
+  vmaMapMemory(allocator, stagingBufferAllocation, &mappedData);
+  writeData(mappedData);
+  vmaUnmapMemory(allocator, stagingBufferAllocation);
+
+  // Create buffer on the GPU (device visible)
+  VmaAllocationCreateInfo allocInfo = {};
+  allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+  auto buffer = createBuffer(
+    allocator,      bufferAllocation, allocInfo,
+    physicalDevice, device,           bufferSize,
+    vk::BufferUsageFlagBits::eTransferDst | usage,
+    vk::MemoryPropertyFlagBits::eDeviceLocal
+  );
+
+  // Copy host visible staging buffer to device visible buffer
+  auto cmd = beginSingleTimeCommands(device, commandPool);
+
+  auto copyRegion = vk::BufferCopy(0, 0, bufferSize);
+  cmd.copyBuffer(stagingBuffer, buffer, 1, &copyRegion);
+
+  endSingleTimeCommands(device, cmd, commandPool, cmdQueue);
+
+  vmaDestroyBuffer(allocator, stagingBuffer, stagingBufferAllocation);
+
+  return buffer;
+}
+
 vk::CommandBuffer beginSingleTimeCommands(
   const vk::Device&      device,
   const vk::CommandPool& commandPool
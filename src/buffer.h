@@ -4,6 +4,7 @@
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.hpp>
 
+#include <functional>
 #include <vector>
 
 #include "structs.h"
@@ -24,21 +25,36 @@ vk::Buffer createBuffer(
   const vk::MemoryPropertyFlags& properties
 );
 
+// One per swapchain image, recorded by recordCommandBuffer every frame
 std::vector<vk::CommandBuffer> createCommandBuffers(
-  const vk::Device&                     device,
-  const vk::CommandPool&                commandPool,
-  const std::vector<VkFramebuffer>&     swapchainFramebuffers,
-  const vk::Extent2D                    swapchainExtent,
-  const vk::Pipeline&                   graphicsPipeline,
-  const vk::PipelineLayout&             pipelineLayout,
-  const std::vector<uint32_t>&          indexCounts,
-  const std::vector<uint32_t>&          vertexCounts,
-  const vk::Buffer&                     indexBuffer,
-  const vk::Buffer&                     vertexBuffer,
-  const vk::RenderPass&                 renderPass,
-  const std::vector<vk::DescriptorSet>& descriptorSets,
-  const size_t                          dynamicAlignment,
-  const glm::vec4&                      clearColor
+  const vk::Device&                 device,
+  const vk::CommandPool&            commandPool,
+  const std::vector<VkFramebuffer>& swapchainFramebuffers
+);
+
+// Records the draws updateIndirectBuffer wrote for this frame. Models
+// without draws are skipped. Each model's indices are read from indexBuffer
+// or shortIndexBuffer, depending on its index type, and textureIndices[i]
+// is pushed as model i's texture pair
+void recordCommandBuffer(
+  const vk::CommandBuffer&          cmd,
+  const VkFramebuffer&              swapchainFramebuffer,
+  const vk::Extent2D                swapchainExtent,
+  const vk::Pipeline&               graphicsPipeline,
+  const vk::PipelineLayout&         pipelineLayout,
+  const vk::Buffer&                 indirectBuffer,
+  const std::vector<uint32_t>&      firstDraws,
+  const std::vector<uint32_t>&      drawCounts,
+  const std::vector<int>&           textureIndices,
+  const bool                        multiDrawIndirect,
+  const vk::Buffer&                 indexBuffer,
+  const vk::Buffer&                 shortIndexBuffer,
+  const std::vector<vk::IndexType>& indexTypes,
+  const vk::Buffer&                 vertexBuffer,
+  const vk::RenderPass&             renderPass,
+  const vk::DescriptorSet&          descriptorSet,
+  const size_t                      dynamicAlignment,
+  const glm::vec4&                  clearColor
 );
 
 std::vector<VkFramebuffer> createFramebuffers(
@@ -67,6 +83,17 @@ std::vector<vk::Buffer> createDynamicUniformBuffers(
   const int                   nObjects
 );
 
+// Host visible buffers of indexed indirect draws, rewritten every frame
+// to pick each model's LOD and cull its meshlets. nDraws is the most
+// draws a frame can issue
+std::vector<vk::Buffer> createIndirectBuffers(
+  const vk::PhysicalDevice&   physicalDevice,
+  const vk::Device&           device,
+  VmaAllocator&               allocator,
+  std::vector<VmaAllocation>& bufferAllocations,
+  const int                   nDraws
+);
+
 void updateUniformBuffer(
   VmaAllocator&               allocator,
   std::vector<VmaAllocation>& bufferAllocations,
@@ -78,6 +105,8 @@ void updateUniformBuffer(
   Excal::Light::Point&        light
 );
 
+// vertexOffsets are where each model starts in the engine's vertex
+// buffer, which shaders of HeightVertex subtract from gl_VertexIndex
 void updateDynamicUniformBuffer(
   UboDynamicData&              uboDynamicData,
   const size_t                 dynamicAlignment,
@@ -86,7 +115,31 @@ void updateDynamicUniformBuffer(
   const vk::Device&            device,
   const vk::Extent2D&          swapchainExtent,
   const uint32_t               currentImage,
-  const std::vector<Excal::Model::Model>& models
+  const std::vector<Excal::Model::Model>& models,
+  const std::vector<int32_t>&  vertexOffsets
+);
+
+// firstIndices and vertexOffsets are where each model starts in the
+// engine's shared index and vertex buffers. Draws are packed, one per
+// visible run of meshlets, and model i's are the drawCounts[i] starting at
+// firstDraws[i], which are 0 for hidden models. Model matrices are read
+// from uboDynamicData, so it must be updated first
+void updateIndirectBuffer(
+  VmaAllocator&                           allocator,
+  std::vector<VmaAllocation>&             bufferAllocations,
+  const vk::Extent2D&                     swapchainExtent,
+  const uint32_t                          currentImage,
+  const float                             farClipPlane,
+  const Excal::Camera&                    camera,
+  const std::vector<Excal::Model::Model>& models,
+  const UboDynamicData&                   uboDynamicData,
+  const size_t                            dynamicAlignment,
+  const std::vector<uint32_t>&            firstIndices,
+  const std::vector<int32_t>&             vertexOffsets,
+  const float                             maxPixelError,
+  const bool                              clockwise,
+  std::vector<uint32_t>&                  firstDraws,
+  std::vector<uint32_t>&                  drawCounts
 );
 
 vk::CommandBuffer beginSingleTimeCommands(
@@ -101,6 +154,21 @@ void endSingleTimeCommands(
   const vk::Queue&         cmdQueue
 );
 
+// Creates a device local buffer of bufferSize bytes, filled through a
+// staging buffer that writeData writes to while it's mapped, so data can
+// be written straight to it without first being collected in a vector
+vk::Buffer createVkBuffer(
+  VmaAllocator&                     allocator,
+  VmaAllocation&                    bufferAllocation,
+  const vk::PhysicalDevice&         physicalDevice,
+  const vk::Device&                 device,
+  const vk::DeviceSize              bufferSize,
+  const std::function<void(void*)>& writeData,
+  const vk::CommandPool&            commandPool,
+  const vk::Queue&                  cmdQueue,
+  const vk::BufferUsageFlagBits&    usage
+);
+
 // Since template functions are turned into "real functions" at compile time
 // they must be defined in the same scope as where they are called from, therefore:
 // **Template functions in namespaces have to be defined in the header file**
@@ -115,48 +183,14 @@ vk::Buffer createVkBuffer(
   const vk::Queue&               cmdQueue,
   const vk::BufferUsageFlagBits& usage
 ) {
-  vk::DeviceSize bufferSize = sizeof(data[0]) * data.size();
-
-  // Staging buffer is on the CPU
-  VmaAllocationCreateInfo stagingAllocInfo = {};
-  stagingAllocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
-
-  VmaAllocation stagingBufferAllocation;
-
-  auto stagingBuffer = Excal::Buffer::createBuffer(
-    allocator,      stagingBufferAllocation, stagingAllocInfo,
-    physicalDevice, device,                  bufferSize,
-    vk::BufferUsageFlagBits::eTransferSrc,
-      vk::MemoryPropertyFlagBits::eHostVisible
-    | vk::MemoryPropertyFlagBits::eHostCoherent
-  );
-
-  void* mappedData;
-  vmaMapMemory(allocator, stagingBufferAllocation, &mappedData);
-  memcpy(mappedData, data.data(), (size_t) bufferSize);
-  vmaUnmapMemory(allocator, stagingBufferAllocation);
-
-  // Create buffer on the GPU (device visible)
-  VmaAllocationCreateInfo allocInfo = {};
-  allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-
-  auto buffer = createBuffer(
-    allocator,      bufferAllocation, allocInfo,
-    physicalDevice, device,           bufferSize,
-    vk::BufferUsageFlagBits::eTransferDst | usage,
-    vk::MemoryPropertyFlagBits::eDeviceLocal
+  return createVkBuffer(
+    allocator,      bufferAllocation,
+    physicalDevice, device,
+    sizeof(data[0]) * data.size(),
+    [&](void* mappedData) {
+      memcpy(mappedData, data.data(), sizeof(data[0]) * data.size());
+    },
+    commandPool, cmdQueue, usage
   );
-
-  // Copy host visible staging buffer to device visible buffer
-  auto cmd = beginSingleTimeCommands(device, commandPool);
-
-  auto copyRegion = vk::BufferCopy(0, 0, bufferSize);
-  cmd.copyBuffer(stagingBuffer, buffer, 1, &copyRegion);
-
-  endSingleTimeCommands(device, cmd, commandPool, cmdQueue);
-
-  vmaDestroyBuffer(allocator, stagingBuffer, stagingBufferAllocation);
-
-  return buffer;
 }
 }
@@ -0,0 +1,76 @@
+#include "culling.h"
+
+#include <glm/glm.hpp>
+
+#include "structs.h"
+
+namespace Excal::Culling
+{
+Frustum getFrustum(const glm::mat4& transform)
+{
+  // Rows of the transform (glm matrices are column major)
+  glm::vec4 rows[4];
+  for (int i=0; i < 4; i++) {
+    rows[i] = glm::vec4(transform[0][i], transform[1][i], transform[2][i], transform[3][i]);
+  }
+
+  Frustum frustum;
+  frustum.planes[0] = rows[3] + rows[0]; // Left
+  frustum.planes[1] = rows[3] - rows[0]; // Right
+  frustum.planes[2] = rows[3] + rows[1]; // Bottom
+  frustum.planes[3] = rows[3] - rows[1]; // Top
+  frustum.planes[4] = rows[2];           // Near
+  frustum.planes[5] = rows[3] - rows[2]; // Far
+
+  for (auto& plane : frustum.planes) {
+    plane = plane * (1.0f / glm::length(glm::vec3(plane.x, plane.y, plane.z)));
+  }
+
+  return frustum;
+}
+
+bool isSphereInFrustum(
+  const Frustum&   frustum,
+  const glm::vec3& center,
+  const float      radius
+) {
+  for (const auto& plane : frustum.planes) {
+    if (glm::dot(glm::vec3(plane.x, plane.y, plane.z), center) + plane.w < -radius) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool isMeshletBackfacing(
+  const Excal::MeshOptimizer::Meshlet& meshlet,
+  const glm::vec3&                     cameraPos,
+  const bool                           clockwise
+) {
+  const glm::vec3 center(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+  glm::vec3 axis(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]);
+
+  if (clockwise) {
+    axis = -axis;
+  }
+
+  // The view direction to every point of the bounding sphere is within 90
+  // degrees of every normal in the cone
+  const glm::vec3 view = center - cameraPos;
+
+  return glm::dot(view, axis) >= meshlet.coneCutoff * glm::length(view) + meshlet.radius;
+}
+
+bool isMeshletVisible(
+  const Excal::MeshOptimizer::Meshlet& meshlet,
+  const Frustum&                       frustum,
+  const glm::vec3&                     cameraPos,
+  const bool                           clockwise
+) {
+  const glm::vec3 center(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+
+  return isSphereInFrustum(frustum, center, meshlet.radius)
+      && !isMeshletBackfacing(meshlet, cameraPos, clockwise);
+}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "meshOptimizer.h"
+
+// CPU visibility tests for meshlets
+namespace Excal::Culling
+{
+// Inward facing planes (xyz normal, w distance) of a view frustum
+struct Frustum {
+  glm::vec4 planes[6];
+};
+
+// Extracts the planes of a projection * view * model transform with
+// a 0 to 1 depth range. Plane distances are in the model's units
+Frustum getFrustum(const glm::mat4& transform);
+
+bool isSphereInFrustum(
+  const Frustum&   frustum,
+  const glm::vec3& center,
+  const float      radius
+);
+
+// True if every triangle of the meshlet faces away from cameraPos
+// cameraPos must be in the meshlet's space. Set clockwise if front faces
+// of the mesh are wound clockwise
+bool isMeshletBackfacing(
+  const Excal::MeshOptimizer::Meshlet& meshlet,
+  const glm::vec3&                     cameraPos,
+  const bool                           clockwise = false
+);
+
+bool isMeshletVisible(
+  const Excal::MeshOptimizer::Meshlet& meshlet,
+  const Frustum&                       frustum,
+  const glm::vec3&                     cameraPos,
+  const bool                           clockwise = false
+);
+}
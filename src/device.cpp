@@ -125,6 +125,9 @@ vk::Device createLogicalDevice(
   // Specify device features application will use
   vk::PhysicalDeviceFeatures deviceFeatures{};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
+
+  // Optional, lets one indirect draw call draw every meshlet of a model
+  deviceFeatures.multiDrawIndirect = physicalDevice.getFeatures().multiDrawIndirect;
   //deviceFeatures.sampleRateShading = VK_TRUE; // Enable sample shading (interior AA)
 
   auto deviceExtensions = getDeviceExtensions();
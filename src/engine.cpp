@@ -16,6 +16,8 @@
 #include <fstream>
 #include <vector>
 #include <array>
+#include <map>
+#include <unordered_map>
 
 #include "structs.h"
 #include "device.h"
@@ -33,6 +35,24 @@
 
 namespace Excal
 {
+namespace
+{
+// Enough draws for every meshlet of the mesh's largest LOD
+uint32_t getDrawCount(const Excal::Model::Mesh& mesh)
+{
+  uint32_t drawCount = std::max<uint32_t>(1, mesh.meshlets.size());
+
+  if (!mesh.lods.empty()) {
+    drawCount = 1;
+    for (const auto& lod : mesh.lods) {
+      drawCount = std::max(drawCount, lod.meshletCount);
+    }
+  }
+
+  return drawCount;
+}
+}
+
 Engine::Engine() {}
 
 Engine::~Engine()
@@ -86,6 +106,9 @@ void Engine::initVulkan()
 
   msaaSamples = Excal::Device::getMaxUsableSampleCount(physicalDevice);
 
+  // Enabled by createLogicalDevice when supported
+  multiDrawIndirect = physicalDevice.getFeatures().multiDrawIndirect;
+
   // Initalize Vulkan Memory Allocator
   VmaAllocatorCreateInfo allocatorInfo = {};
 
@@ -99,7 +122,6 @@ void Engine::initVulkan()
   imageAvailableSemaphores.resize(config.maxFramesInFlight);
   renderFinishedSemaphores.resize(config.maxFramesInFlight);
   inFlightFences.resize(config.maxFramesInFlight);
-  imagesInFlight.resize(config.maxFramesInFlight);
 
   for (int i=0; i < config.maxFramesInFlight; i++)
   {
@@ -110,14 +132,31 @@ void Engine::initVulkan()
     );
   }
 
+  // Upload command buffers are reset and recorded again every frame
   commandPool = device.createCommandPool(
-    vk::CommandPoolCreateInfo({}, queueFamilyIndices.graphicsFamily.value())
+    vk::CommandPoolCreateInfo(
+      vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+      queueFamilyIndices.graphicsFamily.value()
+    )
   );
 
-  // Create texture resources for each model
+  // Create texture resources for each pair of textures, shared by every
+  // model that uses the same pair
+  std::map<std::pair<std::string, std::string>, int> loadedTextures;
+
   for (auto& model : config.models) {
     // TODO Texture resources must be created for each model, even if they don't
     //      have a texture. Remove this requirement
+    auto [loaded, isNewTexture] = loadedTextures.emplace(
+      std::make_pair(model.diffuseTexturePath, model.normalTexturePath),
+      textures.size() / 2
+    );
+
+    textureIndices.push_back(loaded->second);
+
+    if (!isNewTexture) {
+      continue;
+    }
 
     // Diffuse texture
     textures.push_back(
@@ -148,36 +187,180 @@ void Engine::initVulkan()
     device, textures.size()
   );
 
-  // Create vectors containing all model indices and vertices
+  // Create vectors containing all model indices
+  // Meshes with at most 65536 vertices store their indices in shortIndices
+  // Vertices are written straight to the vertex buffer's staging buffer,
+  // so they aren't collected in a vector first
   std::vector<uint32_t> indices;
-  std::vector<Vertex>   vertices;
-
-  for (auto& model : config.models) {
-    indexCounts.push_back(model.indices.size());
-    vertexCounts.push_back(model.vertices.size());
-    indices.insert( indices.end(),  model.indices.begin(),  model.indices.end());
-    vertices.insert(vertices.end(), model.vertices.begin(), model.vertices.end());
+  std::vector<uint16_t> shortIndices;
+
+  std::vector<size_t> uploadModels; // First model of each unique mesh
+  size_t              vertexCount = 0;
+
+  const bool packed = config.vertexFormat == "packed";
+  const bool height = config.vertexFormat == "height";
+
+  totalDrawCount = 0;
+
+  // Maps each mesh to the first model that uses it, since meshes shared
+  // by several models are only uploaded once
+  std::unordered_map<const Excal::Model::Mesh*, size_t> uploadedMeshes;
+
+  // First index of each index array in indices and shortIndices, since
+  // meshes can share indices (see Mesh::sharedIndices)
+  std::unordered_map<const std::vector<uint32_t>*, uint32_t> uploadedIndices;
+  std::unordered_map<const std::vector<uint32_t>*, uint32_t> uploadedShortIndices;
+
+  for (size_t i=0; i < config.models.size(); i++) {
+    auto&       model = config.models[i];
+    const auto& mesh  = *model.mesh;
+
+    // Models that share a mesh are culled separately, so each has its own draws
+    const uint32_t drawCount = getDrawCount(mesh);
+
+    maxDrawCounts.push_back(drawCount);
+    totalDrawCount += drawCount;
+
+    // Streamed models don't share vertices, since their mesh can change
+    if (!model.streamed) {
+      auto [uploaded, isNewMesh] = uploadedMeshes.emplace(&mesh, i);
+
+      if (!isNewMesh) {
+        const size_t first = uploaded->second;
+
+        firstIndices.push_back(firstIndices[first]);
+        vertexOffsets.push_back(vertexOffsets[first]);
+        indexTypes.push_back(indexTypes[first]);
+        vertexCounts.push_back(vertexCounts[first]);
+        model.quantization = config.models[first].quantization;
+        continue;
+      }
+    }
+
+    const size_t meshVertexCount = Excal::Model::getVertexCount(mesh);
+    const auto&  meshIndices     = Excal::Model::getIndices(mesh);
+
+    if (meshVertexCount <= 65536) {
+      auto [shared, isNewIndices] = uploadedShortIndices.emplace(
+        &meshIndices, shortIndices.size()
+      );
+
+      if (isNewIndices) {
+        shortIndices.insert(shortIndices.end(), meshIndices.begin(), meshIndices.end());
+      }
+
+      firstIndices.push_back(shared->second);
+      indexTypes.push_back(vk::IndexType::eUint16);
+    } else {
+      auto [shared, isNewIndices] = uploadedIndices.emplace(
+        &meshIndices, indices.size()
+      );
+
+      if (isNewIndices) {
+        indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+      }
+
+      firstIndices.push_back(shared->second);
+      indexTypes.push_back(vk::IndexType::eUint32);
+    }
+
+    if (packed) {
+      model.quantization = Excal::Model::getVertexQuantization(mesh);
+    } else if (height) {
+      model.quantization = Excal::Model::getHeightQuantization(mesh);
+    }
+
+    uploadModels.push_back(i);
+    vertexOffsets.push_back(vertexCount);
+    vertexCounts.push_back(meshVertexCount);
+    vertexCount += meshVertexCount;
   }
 
   // Create buffers with VMA
-  // Create single index buffer for all models
-  indexBuffer = Excal::Buffer::createVkBuffer(
-    allocator,      indexBufferAllocation,
-    physicalDevice, device,
-    indices,        commandPool,
-    graphicsQueue,
-    vk::BufferUsageFlagBits::eIndexBuffer
-  );
+  // Create an index buffer for each index type, if any model uses it
+  if (!indices.empty()) {
+    indexBuffer = Excal::Buffer::createVkBuffer(
+      allocator,      indexBufferAllocation,
+      physicalDevice, device,
+      indices,        commandPool,
+      graphicsQueue,
+      vk::BufferUsageFlagBits::eIndexBuffer
+    );
+  }
+
+  if (!shortIndices.empty()) {
+    shortIndexBuffer = Excal::Buffer::createVkBuffer(
+      allocator,      shortIndexBufferAllocation,
+      physicalDevice, device,
+      shortIndices,   commandPool,
+      graphicsQueue,
+      vk::BufferUsageFlagBits::eIndexBuffer
+    );
+  }
 
   // Create single vertex buffer for all models
+  vertexSize = Excal::Model::getVertexSize(config.vertexFormat);
+
+  auto writeVertices = [&](void* mappedData) {
+    for (auto i : uploadModels) {
+      const auto& model = config.models[i];
+
+      if (packed) {
+        Excal::Model::writePackedVertices(
+          *model.mesh, model.quantization,
+          static_cast<PackedVertex*>(mappedData) + vertexOffsets[i]
+        );
+      } else if (height) {
+        Excal::Model::writeHeightVertices(
+          *model.mesh, model.quantization,
+          static_cast<HeightVertex*>(mappedData) + vertexOffsets[i]
+        );
+      } else {
+        Excal::Model::writeVertices(
+          *model.mesh, static_cast<Vertex*>(mappedData) + vertexOffsets[i]
+        );
+      }
+    }
+  };
+
   vertexBuffer = Excal::Buffer::createVkBuffer(
     allocator,      vertexBufferAllocation,
     physicalDevice, device,
-    vertices,       commandPool,
-    graphicsQueue,
+    vertexCount * vertexSize,
+    writeVertices,
+    commandPool,    graphicsQueue,
     vk::BufferUsageFlagBits::eVertexBuffer
   );
 
+  // Staging buffers for updateModelMesh, one per frame in flight so a
+  // frame's uploads can be written while earlier frames are still copying
+  if (config.streamingUploadSize > 0) {
+    VmaAllocationCreateInfo stagingAllocInfo = {};
+    stagingAllocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+
+    stagingBuffers.resize(config.maxFramesInFlight);
+    stagingBufferAllocations.resize(config.maxFramesInFlight);
+    stagingBufferData.resize(config.maxFramesInFlight);
+
+    for (int i=0; i < config.maxFramesInFlight; i++) {
+      stagingBuffers[i] = Excal::Buffer::createBuffer(
+        allocator,      stagingBufferAllocations[i], stagingAllocInfo,
+        physicalDevice, device,                      config.streamingUploadSize,
+        vk::BufferUsageFlagBits::eTransferSrc,
+          vk::MemoryPropertyFlagBits::eHostVisible
+        | vk::MemoryPropertyFlagBits::eHostCoherent
+      );
+
+      vmaMapMemory(allocator, stagingBufferAllocations[i], &stagingBufferData[i]);
+    }
+
+    uploadCommandBuffers = device.allocateCommandBuffers(
+      vk::CommandBufferAllocateInfo(
+        commandPool, vk::CommandBufferLevel::ePrimary, config.maxFramesInFlight
+      )
+    );
+  }
+
   // Set alignment for dynamic uniform buffers
   auto deviceProps = physicalDevice.getProperties();
   size_t minUboAlignment = deviceProps.limits.minUniformBufferOffsetAlignment;
@@ -207,6 +390,9 @@ void Engine::createSwapchainObjects()
   swapchainExtent      = swapchainState.swapchainExtent;
   swapchainImages      = device.getSwapchainImagesKHR(swapchain);
 
+  // The swapchain can have more images than frames in flight
+  imagesInFlight.assign(swapchainImages.size(), nullptr);
+
   swapchainImageViews = Excal::Image::createImageViews(
     device, swapchainImages, swapchainImageFormat
   );
@@ -247,7 +433,7 @@ void Engine::createSwapchainObjects()
     pipelineCache,         renderPass,
     swapchainExtent,       msaaSamples,
     config.vertShaderPath, config.fragShaderPath,
-    config.frontFace
+    config.frontFace,      config.vertexFormat
   );
 
   // Create resources
@@ -285,6 +471,14 @@ void Engine::createSwapchainObjects()
     config.models.size()
   );
 
+  indirectBufferAllocations.resize(swapchainImageViews.size());
+
+  indirectBuffers = Excal::Buffer::createIndirectBuffers(
+    physicalDevice, device,
+    allocator,      indirectBufferAllocations,
+    totalDrawCount
+  );
+
   descriptorPool = Excal::Descriptor::createDescriptorPool(
     device, swapchainImages.size(), textures.size()
   );
@@ -296,14 +490,9 @@ void Engine::createSwapchainObjects()
     textureImageViews, textureSampler
   );
 
+  // Recorded every frame, once its draws are known
   commandBuffers = Excal::Buffer::createCommandBuffers(
-    device,                commandPool,
-    swapchainFramebuffers, swapchainExtent,
-    graphicsPipeline,      pipelineLayout,
-    indexCounts,           vertexCounts,
-    indexBuffer,           vertexBuffer,
-    renderPass,            descriptorSets,
-    dynamicAlignment,      config.clearColor
+    device, commandPool, swapchainFramebuffers
   );
 }
 
@@ -328,6 +517,11 @@ void Engine::mainLoop()
 
     config.camera.updateView();
     config.camera.handleInput(window, deltaTime);
+
+    if (config.frameCallback) {
+      config.frameCallback(*this);
+    }
+
     drawFrame(currentFrame);
   }
 
@@ -353,6 +547,17 @@ void Engine::drawFrame(size_t& currentFrame)
     return;
   }
 
+  // This image's buffers and command buffer are rewritten below, so the
+  // frame that last used it must be done
+  if (imagesInFlight[imageIndex]) {
+    device.waitForFences(1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+  }
+  // Mark the image as now being in use by this frame
+  imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+
+  // This frame's fence was waited on, so its staging buffer is free
+  const bool uploading = recordMeshUploads(currentFrame);
+
   Excal::Buffer::updateUniformBuffer(
     allocator,    uniformBufferAllocations,
     device,       swapchainExtent,
@@ -364,24 +569,51 @@ void Engine::drawFrame(size_t& currentFrame)
     uboDynamicData, dynamicAlignment,
     allocator,      dynamicUniformBufferAllocations,
     device,         swapchainExtent,
-    imageIndex,     config.models
+    imageIndex,     config.models,
+    vertexOffsets
   );
 
-  // Check if a previous frame is using this image
-  // (i.e. there is its fence to wait on)
-  if (imagesInFlight[imageIndex]) {
-    device.waitForFences(1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
-  }
-  // Mark the image as now being in use by this frame
-  imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+  // Pick each model's LOD and cull its meshlets for this frame
+  Excal::Buffer::updateIndirectBuffer(
+    allocator,            indirectBufferAllocations,
+    swapchainExtent,      imageIndex,
+    config.farClipPlane,  config.camera,
+    config.models,        uboDynamicData,
+    dynamicAlignment,     firstIndices,
+    vertexOffsets,        config.lodPixelError,
+    config.frontFace == "clockwise",
+    firstDraws,           drawCounts
+  );
+
+  // Only models with draws this frame are recorded
+  Excal::Buffer::recordCommandBuffer(
+    commandBuffers[imageIndex],       swapchainFramebuffers[imageIndex],
+    swapchainExtent,                  graphicsPipeline,
+    pipelineLayout,                   indirectBuffers[imageIndex],
+    firstDraws,                       drawCounts,
+    textureIndices,                   multiDrawIndirect,
+    indexBuffer,                      shortIndexBuffer,
+    indexTypes,                       vertexBuffer,
+    renderPass,                       descriptorSets[imageIndex],
+    dynamicAlignment,                 config.clearColor
+  );
 
   vk::Semaphore signalSemaphores[]    = {renderFinishedSemaphores[currentFrame]};
   vk::Semaphore waitSemaphores[]      = {imageAvailableSemaphores[currentFrame]};
   vk::PipelineStageFlags waitStages[] = {vk::PipelineStageFlagBits::eColorAttachmentOutput};
 
+  // Uploads are submitted before the frame's draws, and their barriers
+  // order them with the draws of earlier and later frames
+  std::vector<vk::CommandBuffer> submitCommandBuffers;
+
+  if (uploading) {
+    submitCommandBuffers.push_back(uploadCommandBuffers[currentFrame]);
+  }
+  submitCommandBuffers.push_back(commandBuffers[imageIndex]);
+
   vk::SubmitInfo submitInfo(
     1, waitSemaphores, waitStages,
-    1, &commandBuffers[imageIndex],
+    submitCommandBuffers.size(), submitCommandBuffers.data(),
     1, signalSemaphores
   );
 
@@ -407,6 +639,138 @@ void Engine::drawFrame(size_t& currentFrame)
   currentFrame = (currentFrame + 1) % config.maxFramesInFlight;
 }
 
+void Engine::updateModelMesh(
+  const size_t                              model,
+  std::shared_ptr<const Excal::Model::Mesh> mesh
+) {
+  if (model >= config.models.size() || !config.models[model].streamed) {
+    throw std::runtime_error("only streamed models can update their mesh");
+  }
+
+  const auto& currentMesh = *config.models[model].mesh;
+
+  // Indices, index type and the most draws are fixed by init, so only
+  // vertices can change
+  if (&Excal::Model::getIndices(*mesh) != &Excal::Model::getIndices(currentMesh)) {
+    throw std::runtime_error("streamed meshes must share their model's indices");
+  }
+
+  const size_t meshVertexCount = Excal::Model::getVertexCount(*mesh);
+
+  if (   meshVertexCount > vertexCounts[model]
+      || getDrawCount(*mesh) > maxDrawCounts[model]
+  ) {
+    throw std::runtime_error("streamed mesh doesn't fit its model's vertices or draws");
+  }
+
+  if (meshVertexCount * vertexSize > config.streamingUploadSize) {
+    throw std::runtime_error("streamed mesh is larger than streamingUploadSize");
+  }
+
+  // Only the latest mesh of a model is uploaded
+  for (auto& upload : meshUploads) {
+    if (upload.model == model) {
+      upload.mesh = std::move(mesh);
+      return;
+    }
+  }
+
+  meshUploads.push_back({model, std::move(mesh)});
+}
+
+bool Engine::recordMeshUploads(const size_t currentFrame)
+{
+  if (meshUploads.empty()) {
+    return false;
+  }
+
+  auto& cmd = uploadCommandBuffers[currentFrame];
+  auto  dst = static_cast<uint8_t*>(stagingBufferData[currentFrame]);
+
+  std::vector<vk::BufferCopy> copyRegions;
+  vk::DeviceSize              stagingOffset = 0;
+  size_t                      nUploaded     = 0;
+
+  // Uploads are copied in the order they were requested, until the
+  // staging buffer is full. The rest wait for a later frame
+  for (; nUploaded < meshUploads.size(); nUploaded++) {
+    const auto& upload = meshUploads[nUploaded];
+    auto&       model  = config.models[upload.model];
+
+    const vk::DeviceSize size = Excal::Model::getVertexCount(*upload.mesh) * vertexSize;
+
+    if (stagingOffset + size > config.streamingUploadSize) {
+      break;
+    }
+
+    if (config.vertexFormat == "packed") {
+      model.quantization = Excal::Model::getVertexQuantization(*upload.mesh);
+
+      Excal::Model::writePackedVertices(
+        *upload.mesh, model.quantization,
+        reinterpret_cast<PackedVertex*>(dst + stagingOffset)
+      );
+    } else if (config.vertexFormat == "height") {
+      model.quantization = Excal::Model::getHeightQuantization(*upload.mesh);
+
+      Excal::Model::writeHeightVertices(
+        *upload.mesh, model.quantization,
+        reinterpret_cast<HeightVertex*>(dst + stagingOffset)
+      );
+    } else {
+      Excal::Model::writeVertices(
+        *upload.mesh, reinterpret_cast<Vertex*>(dst + stagingOffset)
+      );
+    }
+
+    copyRegions.push_back(
+      vk::BufferCopy(
+        stagingOffset, vertexOffsets[upload.model] * vertexSize, size
+      )
+    );
+
+    // Culling and LOD selection read the new mesh from this frame on
+    model.mesh    = upload.mesh;
+    model.visible = true;
+
+    stagingOffset += size;
+  }
+
+  meshUploads.erase(meshUploads.begin(), meshUploads.begin() + nUploaded);
+
+  if (copyRegions.empty()) {
+    return false;
+  }
+
+  cmd.reset({});
+  cmd.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+
+  // Earlier frames may still be reading the vertices being overwritten
+  cmd.pipelineBarrier(
+    vk::PipelineStageFlagBits::eVertexInput, vk::PipelineStageFlagBits::eTransfer,
+    {}, 0, nullptr, 0, nullptr, 0, nullptr
+  );
+
+  cmd.copyBuffer(
+    stagingBuffers[currentFrame], vertexBuffer,
+    copyRegions.size(), copyRegions.data()
+  );
+
+  // Make the copies visible to this and later frames' vertex fetches
+  vk::MemoryBarrier copyBarrier(
+    vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eVertexAttributeRead
+  );
+
+  cmd.pipelineBarrier(
+    vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eVertexInput,
+    {}, 1, &copyBarrier, 0, nullptr, 0, nullptr
+  );
+
+  cmd.end();
+
+  return true;
+}
+
 void Engine::recreateSwapchain()
 {
   // Handle widow minimization
@@ -451,6 +815,7 @@ void Engine::cleanupSwapchain()
     vmaDestroyBuffer(
       allocator, dynamicUniformBuffers[i], dynamicUniformBufferAllocations[i]
     );
+    vmaDestroyBuffer(allocator, indirectBuffers[i], indirectBufferAllocations[i]);
   }
 
   device.destroySwapchainKHR(swapchain);
@@ -485,9 +850,20 @@ void Engine::cleanup()
     vmaDestroyImage(allocator, textures[i].image, textures[i].imageAllocation);
   }
 
-  vmaDestroyBuffer(allocator, indexBuffer, indexBufferAllocation);
+  // Index buffers are only created if some model uses their index type
+  if (indexBuffer) {
+    vmaDestroyBuffer(allocator, indexBuffer, indexBufferAllocation);
+  }
+  if (shortIndexBuffer) {
+    vmaDestroyBuffer(allocator, shortIndexBuffer, shortIndexBufferAllocation);
+  }
   vmaDestroyBuffer(allocator, vertexBuffer, vertexBufferAllocation);
 
+  for (size_t i=0; i < stagingBuffers.size(); i++) {
+    vmaUnmapMemory(allocator, stagingBufferAllocations[i]);
+    vmaDestroyBuffer(allocator, stagingBuffers[i], stagingBufferAllocations[i]);
+  }
+
   vmaDestroyAllocator(allocator);
 
   device.destroyCommandPool(commandPool);
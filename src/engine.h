@@ -13,6 +13,8 @@
 #include <glm/glm.hpp>
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.hpp>
+#include <functional>
+#include <memory>
 #include <vector>
 
 #include "image.h"
@@ -40,6 +42,17 @@ public:
     std::string frontFace         = "counterClockwise";
     glm::vec4   clearColor        = glm::vec4(0, 0, 0, 1);
     float       farClipPlane      = 128.0;
+    float       lodPixelError     = 1.0; // Max screen space error of a model's LOD
+    std::string vertexFormat      = "float"; // "packed" uploads 20 byte PackedVertex
+                                             // "height" uploads 4 byte HeightVertex,
+                                             // for grid meshes only
+
+    // Bytes of vertices updateModelMesh can upload per frame in flight
+    // No staging buffers are created if it's 0
+    size_t streamingUploadSize = 0;
+
+    // Called every frame before it's drawn, e.g. to stream models in
+    std::function<void(Excal::Engine&)> frameCallback;
   };
 
 private:
@@ -57,6 +70,7 @@ private:
   vk::Queue               graphicsQueue;
   vk::Queue               presentQueue;
   vk::SampleCountFlagBits msaaSamples;
+  bool                    multiDrawIndirect;
 
   // Set by Excal::Swapchain
   vk::SwapchainKHR           swapchain;
@@ -92,22 +106,48 @@ private:
   std::vector<vk::DescriptorSet> descriptorSets;
 
   // Set by Excal::Buffer
-  std::vector<uint32_t>          indexCounts;
-  std::vector<uint32_t>          vertexCounts;
+  std::vector<uint32_t>          firstIndices;
+  std::vector<int32_t>           vertexOffsets;
+  std::vector<uint32_t>          maxDrawCounts; // Draws each model can issue
+  uint32_t                       totalDrawCount;
+  std::vector<vk::IndexType>     indexTypes; // eUint16 if a model's mesh fits
+  std::vector<uint32_t>          vertexCounts; // Vertices reserved for each model
+  std::vector<int>               textureIndices; // Texture pair of each model
+  size_t                         vertexSize;
   vk::Buffer                     indexBuffer;
+  vk::Buffer                     shortIndexBuffer;
   vk::Buffer                     vertexBuffer;
   vk::CommandPool                commandPool;
   std::vector<vk::CommandBuffer> commandBuffers;
   std::vector<vk::Buffer>        uniformBuffers;
   std::vector<vk::Buffer>        dynamicUniformBuffers;
+  std::vector<vk::Buffer>        indirectBuffers;
   std::vector<VkFramebuffer>     swapchainFramebuffers;
 
   // Set by Vulkan Memory Allocator
   VmaAllocator               allocator;
   VmaAllocation              indexBufferAllocation;
+  VmaAllocation              shortIndexBufferAllocation;
   VmaAllocation              vertexBufferAllocation;
   std::vector<VmaAllocation> uniformBufferAllocations;
   std::vector<VmaAllocation> dynamicUniformBufferAllocations;
+  std::vector<VmaAllocation> indirectBufferAllocations;
+
+  // Set by Excal::Buffer::updateIndirectBuffer every frame
+  std::vector<uint32_t> firstDraws;
+  std::vector<uint32_t> drawCounts;
+
+  // Set by updateModelMesh, uploaded through each frame's staging buffer
+  struct MeshUpload {
+    size_t                                    model;
+    std::shared_ptr<const Excal::Model::Mesh> mesh;
+  };
+
+  std::vector<MeshUpload>        meshUploads;
+  std::vector<vk::Buffer>        stagingBuffers;
+  std::vector<VmaAllocation>     stagingBufferAllocations;
+  std::vector<void*>             stagingBufferData; // Mapped until cleanup
+  std::vector<vk::CommandBuffer> uploadCommandBuffers;
 
   // Large uniform buffer that contains all model matrices
   UboDynamicData uboDynamicData;
@@ -128,6 +168,7 @@ private:
   void recreateSwapchain();
   void cleanupSwapchain();
   void drawFrame(size_t& currentFrame);
+  bool recordMeshUploads(const size_t currentFrame);
 
 public:
   Engine();
@@ -152,5 +193,18 @@ public:
     config = _config;
     initVulkan();
   }
+
+  // Replaces a streamed model's mesh (see Model::streamed) without waiting
+  // on the GPU. Its vertices are copied before the next frame with room in
+  // its staging buffer is drawn, and from that frame on the model draws
+  // the new mesh and is visible
+  // The mesh must use the same indices as the model's current mesh, and
+  // fit its vertex range and draws
+  void updateModelMesh(
+    const size_t                              model,
+    std::shared_ptr<const Excal::Model::Mesh> mesh
+  );
+
+  size_t getPendingMeshUploads() const { return meshUploads.size(); }
 };
 }
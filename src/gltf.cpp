@@ -0,0 +1,404 @@
+#include "gltf.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "json.h"
+#include "utils.h"
+
+namespace Excal::Gltf
+{
+namespace
+{
+const uint32_t glbMagic      = 0x46546C67; // "glTF"
+const uint32_t jsonChunkType = 0x4E4F534A; // "JSON"
+const uint32_t binChunkType  = 0x004E4942; // "BIN\0"
+
+const uint32_t componentByte          = 5120;
+const uint32_t componentUnsignedByte  = 5121;
+const uint32_t componentShort         = 5122;
+const uint32_t componentUnsignedShort = 5123;
+const uint32_t componentUnsignedInt   = 5125;
+const uint32_t componentFloat         = 5126;
+
+const uint32_t modeTriangles = 4;
+
+uint32_t readU32(const char* data)
+{
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+size_t getComponentSize(const uint32_t componentType)
+{
+  switch (componentType) {
+    case componentByte:
+    case componentUnsignedByte:  return 1;
+    case componentShort:
+    case componentUnsignedShort: return 2;
+    case componentUnsignedInt:
+    case componentFloat:         return 4;
+  }
+
+  throw std::runtime_error(
+    "unsupported glTF component type " + std::to_string(componentType)
+  );
+}
+
+uint32_t getComponentCount(const std::string& type)
+{
+  if (type == "SCALAR") { return 1; }
+  if (type == "VEC2")   { return 2; }
+  if (type == "VEC3")   { return 3; }
+  if (type == "VEC4")   { return 4; }
+
+  throw std::runtime_error("unsupported glTF accessor type " + type);
+}
+
+// Resolves an accessor to its elements in the BIN chunk, checking that
+// every element is inside the accessor's buffer view
+Accessor getAccessor(
+  const Excal::Json::Value& json,
+  const size_t              index,
+  const char*               bin,
+  const size_t              binSize
+) {
+  const auto& accessorJson = json["accessors"][index];
+
+  if (accessorJson.find("sparse")) {
+    throw std::runtime_error("sparse glTF accessors aren't supported");
+  }
+
+  Accessor accessor;
+  accessor.componentType = accessorJson["componentType"].number;
+  accessor.components    = getComponentCount(accessorJson["type"].string);
+  accessor.count         = accessorJson["count"].number;
+
+  if (const auto* normalized = accessorJson.find("normalized")) {
+    accessor.normalized = normalized->boolean;
+  }
+
+  const size_t elementSize = getComponentSize(accessor.componentType)
+                           * accessor.components;
+
+  const auto& viewJson = json["bufferViews"][accessorJson["bufferView"].number];
+
+  if (viewJson.getNumber("buffer", 0) != 0) {
+    throw std::runtime_error("glTF buffers other than the GLB's BIN chunk aren't supported");
+  }
+
+  const size_t viewOffset = viewJson.getNumber("byteOffset", 0);
+  const size_t viewLength = viewJson["byteLength"].number;
+  const size_t offset     = accessorJson.getNumber("byteOffset", 0);
+
+  accessor.stride = viewJson.getNumber("byteStride", elementSize);
+
+  const size_t accessorLength = accessor.count == 0
+                                ? 0
+                                : accessor.stride * (accessor.count - 1) + elementSize;
+
+  if (   viewOffset + viewLength > binSize
+      || offset + accessorLength > viewLength
+  ) {
+    throw std::runtime_error(
+      "glTF accessor " + std::to_string(index) + " is out of bounds"
+    );
+  }
+
+  accessor.data = bin + viewOffset + offset;
+
+  return accessor;
+}
+
+// Reads up to 4 components of element i, normalized integers are mapped
+// to [0, 1] or [-1, 1] as the glTF spec defines
+void readElement(
+  const Accessor& accessor,
+  const size_t    i,
+  float*          out
+) {
+  const char* element = accessor.data + accessor.stride * i;
+
+  for (uint32_t c=0; c < accessor.components; c++) {
+    float value = 0.0f;
+
+    switch (accessor.componentType) {
+      case componentFloat: {
+        memcpy(&value, element + c * 4, 4);
+        break;
+      }
+      case componentUnsignedByte: {
+        uint8_t v = element[c];
+        value = accessor.normalized ? v / 255.0f : v;
+        break;
+      }
+      case componentByte: {
+        int8_t v = element[c];
+        value = accessor.normalized ? std::max(v / 127.0f, -1.0f) : v;
+        break;
+      }
+      case componentUnsignedShort: {
+        uint16_t v;
+        memcpy(&v, element + c * 2, 2);
+        value = accessor.normalized ? v / 65535.0f : v;
+        break;
+      }
+      case componentShort: {
+        int16_t v;
+        memcpy(&v, element + c * 2, 2);
+        value = accessor.normalized ? std::max(v / 32767.0f, -1.0f) : v;
+        break;
+      }
+      case componentUnsignedInt: {
+        uint32_t v;
+        memcpy(&v, element + c * 4, 4);
+        value = v;
+        break;
+      }
+    }
+
+    out[c] = value;
+  }
+}
+
+void appendIndices(
+  const Accessor&        accessor,
+  const uint32_t         firstVertex,
+  const size_t           vertexCount,
+  std::vector<uint32_t>& indices
+) {
+  if (   accessor.components != 1
+      || (   accessor.componentType != componentUnsignedByte
+          && accessor.componentType != componentUnsignedShort
+          && accessor.componentType != componentUnsignedInt)
+  ) {
+    throw std::runtime_error("glTF indices must be unsigned integer scalars");
+  }
+
+  const size_t first = indices.size();
+  indices.resize(first + accessor.count);
+
+  for (size_t i=0; i < accessor.count; i++) {
+    const char* element = accessor.data + accessor.stride * i;
+    uint32_t index = 0;
+
+    switch (accessor.componentType) {
+      case componentUnsignedByte: {
+        index = static_cast<uint8_t>(*element);
+        break;
+      }
+      case componentUnsignedShort: {
+        uint16_t v;
+        memcpy(&v, element, 2);
+        index = v;
+        break;
+      }
+      case componentUnsignedInt: {
+        memcpy(&index, element, 4);
+        break;
+      }
+    }
+
+    if (index >= vertexCount) {
+      throw std::runtime_error("glTF index is out of range");
+    }
+
+    indices[first + i] = firstVertex + index;
+  }
+}
+}
+
+GlbMesh loadGlb(const std::string& path)
+{
+  auto file = std::make_shared<const Excal::Utils::MappedFile>(path);
+
+  const char*  data = file->data();
+  const size_t size = file->size();
+
+  // 12 byte header, followed by chunks of an 8 byte header and data
+  if (size < 12 || readU32(data) != glbMagic) {
+    throw std::runtime_error(path + " isn't a GLB file");
+  }
+  if (readU32(data + 4) != 2) {
+    throw std::runtime_error(path + " isn't a glTF 2.0 file");
+  }
+
+  const char* json     = nullptr;
+  size_t      jsonSize = 0;
+  const char* bin      = nullptr;
+  size_t      binSize  = 0;
+
+  for (size_t offset = 12; offset + 8 <= size;) {
+    const size_t chunkSize = readU32(data + offset);
+    const uint32_t type    = readU32(data + offset + 4);
+
+    if (offset + 8 + chunkSize > size) {
+      throw std::runtime_error(path + " has a truncated chunk");
+    }
+
+    if (type == jsonChunkType && !json) {
+      json     = data + offset + 8;
+      jsonSize = chunkSize;
+    } else if (type == binChunkType && !bin) {
+      bin     = data + offset + 8;
+      binSize = chunkSize;
+    }
+
+    // Chunks are 4 byte aligned
+    offset += 8 + ((chunkSize + 3) & ~size_t(3));
+  }
+
+  if (!json) {
+    throw std::runtime_error(path + " has no JSON chunk");
+  }
+
+  const auto gltf = Excal::Json::parse(json, jsonSize);
+
+  GlbMesh mesh;
+  mesh.vertices.file = file;
+
+  bool hasBounds = false;
+
+  for (const auto& meshJson : gltf["meshes"].array) {
+    for (const auto& primitiveJson : meshJson["primitives"].array) {
+      if (primitiveJson.getNumber("mode", modeTriangles) != modeTriangles) {
+        throw std::runtime_error(path + " has primitives that aren't triangle lists");
+      }
+
+      const auto& attributes = primitiveJson["attributes"];
+
+      Primitive primitive;
+      primitive.firstVertex = mesh.vertices.vertexCount;
+
+      Accessor* targets[] = {
+        &primitive.position, &primitive.normal, &primitive.texCoord,
+        &primitive.color,    &primitive.tangent
+      };
+      const char* names[] = { "POSITION", "NORMAL", "TEXCOORD_0", "COLOR_0", "TANGENT" };
+
+      for (int i=0; i < 5; i++) {
+        if (const auto* index = attributes.find(names[i])) {
+          *targets[i] = getAccessor(gltf, index->number, bin, binSize);
+        }
+      }
+
+      if (   primitive.position.componentType != componentFloat
+          || primitive.position.components    != 3
+      ) {
+        throw std::runtime_error(path + " has primitives without float3 positions");
+      }
+
+      primitive.vertexCount = primitive.position.count;
+
+      for (int i=1; i < 5; i++) {
+        if (targets[i]->count != 0 && targets[i]->count != primitive.vertexCount) {
+          throw std::runtime_error(path + " has attributes of different lengths");
+        }
+      }
+
+      // Non-indexed primitives draw their vertices in order
+      if (const auto* indices = primitiveJson.find("indices")) {
+        appendIndices(
+          getAccessor(gltf, indices->number, bin, binSize),
+          primitive.firstVertex, primitive.vertexCount, mesh.indices
+        );
+      } else {
+        for (size_t i=0; i < primitive.vertexCount; i++) {
+          mesh.indices.push_back(primitive.firstVertex + i);
+        }
+      }
+
+      // Position accessors are required to have bounds
+      const auto& positionJson = gltf["accessors"][attributes["POSITION"].number];
+
+      glm::vec3 primitiveMin, primitiveMax;
+
+      for (int c=0; c < 3; c++) {
+        primitiveMin[c] = positionJson["min"][c].number;
+        primitiveMax[c] = positionJson["max"][c].number;
+      }
+
+      mesh.boundsMin = hasBounds ? glm::min(mesh.boundsMin, primitiveMin) : primitiveMin;
+      mesh.boundsMax = hasBounds ? glm::max(mesh.boundsMax, primitiveMax) : primitiveMax;
+      hasBounds      = true;
+
+      mesh.vertices.vertexCount += primitive.vertexCount;
+      mesh.vertices.primitives.push_back(primitive);
+    }
+  }
+
+  if (mesh.vertices.vertexCount > UINT32_MAX) {
+    throw std::runtime_error(path + " has too many vertices");
+  }
+
+  return mesh;
+}
+
+bool hasNormalsAndTangents(const GlbVertices& vertices)
+{
+  for (const auto& primitive : vertices.primitives) {
+    if (primitive.normal.count == 0 || primitive.tangent.count == 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+Vertex readVertex(const GlbVertices& vertices, const size_t i)
+{
+  const size_t source = vertices.vertexOrder.empty() ? i : vertices.vertexOrder[i];
+
+  // Last primitive that starts at or before source
+  auto primitive = std::upper_bound(
+    vertices.primitives.begin(), vertices.primitives.end(), source,
+    [](const size_t vertex, const Primitive& p) { return vertex < p.firstVertex; }
+  ) - 1;
+
+  const size_t local = source - primitive->firstVertex;
+
+  Vertex vertex{};
+  vertex.color = glm::vec3(1.0f);
+
+  float values[4];
+
+  readElement(primitive->position, local, values);
+  vertex.pos = glm::vec3(values[0], values[1], values[2]);
+
+  if (primitive->normal.count != 0) {
+    readElement(primitive->normal, local, values);
+    vertex.normal = glm::vec3(values[0], values[1], values[2]);
+  }
+
+  if (primitive->texCoord.count != 0) {
+    readElement(primitive->texCoord, local, values);
+    vertex.texCoord = glm::vec2(values[0], values[1]);
+  }
+
+  if (primitive->color.count != 0) {
+    readElement(primitive->color, local, values);
+    vertex.color = glm::vec3(values[0], values[1], values[2]);
+  }
+
+  if (primitive->tangent.count != 0) {
+    readElement(primitive->tangent, local, values);
+    vertex.tangent = glm::vec4(values[0], values[1], values[2], values[3]);
+  }
+
+  return vertex;
+}
+
+const float* getPositions(const GlbVertices& vertices, size_t& positionStride)
+{
+  if (vertices.primitives.size() != 1 || !vertices.vertexOrder.empty()) {
+    return nullptr;
+  }
+
+  const auto& position = vertices.primitives[0].position;
+  positionStride = position.stride;
+
+  return reinterpret_cast<const float*>(position.data);
+}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "structs.h"
+#include "utils.h"
+
+// Binary glTF 2.0 (GLB) mesh loader
+// The file is memory mapped, and vertex attributes are read from it when
+// they're needed, e.g. straight into a staging buffer, instead of being
+// copied into a std::vector<Vertex> when the file is loaded
+// The triangles of every primitive of every mesh are loaded as one mesh,
+// in mesh space. Node transforms, materials, and textures are ignored
+namespace Excal::Gltf
+{
+// Typed view of an accessor's elements in the mapped file
+struct Accessor {
+  const char* data          = nullptr;
+  size_t      stride        = 0;
+  size_t      count         = 0;
+  uint32_t    componentType = 0; // GL enum, e.g. 5126 for float
+  uint32_t    components    = 0;
+  bool        normalized    = false;
+};
+
+// Vertex attributes of one primitive, count is 0 for missing attributes
+struct Primitive {
+  size_t   firstVertex = 0;
+  size_t   vertexCount = 0;
+  Accessor position;
+  Accessor normal;
+  Accessor texCoord;
+  Accessor color;
+  Accessor tangent;
+};
+
+struct GlbVertices {
+  std::shared_ptr<const Excal::Utils::MappedFile> file;
+  std::vector<Primitive> primitives;
+  size_t                 vertexCount = 0;
+
+  // Source vertex of each vertex, empty if vertices are in file order
+  std::vector<uint32_t> vertexOrder;
+};
+
+struct GlbMesh {
+  std::vector<uint32_t> indices;
+  GlbVertices           vertices;
+  glm::vec3             boundsMin = glm::vec3(0.0);
+  glm::vec3             boundsMax = glm::vec3(0.0);
+};
+
+GlbMesh loadGlb(const std::string& path);
+
+// True if every primitive has normals and tangents, which vertices
+// loaded from other formats always have
+bool hasNormalsAndTangents(const GlbVertices& vertices);
+
+// Reads vertex i, after vertexOrder is applied
+// Missing attributes are 0, except color which is white
+Vertex readVertex(const GlbVertices& vertices, const size_t i);
+
+// Positions in the mapped file, which glTF requires to be 3 floats
+// nullptr if the mesh has several primitives, or vertices were reordered
+const float* getPositions(const GlbVertices& vertices, size_t& positionStride);
+}
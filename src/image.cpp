@@ -5,6 +5,7 @@
 #include <vulkan/vulkan.hpp>
 #include <cstring>
 
+#include "assetPack.h"
 #include "buffer.h"
 #include "device.h"
 
@@ -245,19 +246,30 @@ ImageResources createTextureResources(
   const vk::Queue&          graphicsQueue,
   const std::string&        texturePath
 ) {
+  // Textures in mounted asset packs are already decoded
+  Excal::AssetPack::TextureView packedTexture;
+  const bool isPacked = Excal::AssetPack::findTexture(texturePath, packedTexture);
+
   int texWidth, texHeight, texChannels;
-  stbi_uc* pixels = stbi_load(
-    texturePath.c_str(),
-    &texWidth, &texHeight, &texChannels,
-    STBI_rgb_alpha
-  );
+  stbi_uc* pixels = nullptr;
 
-  vk::DeviceSize imageSize = texWidth * texHeight * 4;
+  if (isPacked) {
+    texWidth  = packedTexture.width;
+    texHeight = packedTexture.height;
+  } else {
+    pixels = stbi_load(
+      texturePath.c_str(),
+      &texWidth, &texHeight, &texChannels,
+      STBI_rgb_alpha
+    );
 
-  if (!pixels) {
-    throw std::runtime_error("failed to load texture image!");
+    if (!pixels) {
+      throw std::runtime_error("failed to load texture image!");
+    }
   }
 
+  vk::DeviceSize imageSize = vk::DeviceSize(texWidth) * texHeight * 4;
+
   // Staging buffer is on the CPU
   VmaAllocationCreateInfo stagingAllocInfo = {};
   stagingAllocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
@@ -274,10 +286,12 @@ ImageResources createTextureResources(
 
   void* mappedData;
   vmaMapMemory(allocator, stagingBufferAllocation, &mappedData);
-  memcpy(mappedData, pixels, (size_t) imageSize);
+  memcpy(mappedData, isPacked ? packedTexture.pixels : pixels, (size_t) imageSize);
   vmaUnmapMemory(allocator, stagingBufferAllocation);
 
-  stbi_image_free(pixels);
+  if (pixels) {
+    stbi_image_free(pixels);
+  }
 
   ImageResources textureResources;
 
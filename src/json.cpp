@@ -0,0 +1,374 @@
+#include "json.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+namespace Excal::Json
+{
+namespace
+{
+// Nested arrays and objects are parsed recursively, so depth is limited
+// to keep malformed files from overflowing the stack
+const int maxDepth = 256;
+
+class Parser
+{
+public:
+  Parser(const char* data, const size_t size)
+    : p(data), begin(data), end(data + size) {}
+
+  Value parseDocument()
+  {
+    Value value = parseValue(0);
+
+    skipSpaces();
+    if (p != end) {
+      fail("unexpected data after the root value");
+    }
+
+    return value;
+  }
+
+private:
+  const char* p;
+  const char* begin;
+  const char* end;
+
+  [[noreturn]] void fail(const std::string& message)
+  {
+    throw std::runtime_error(
+      "invalid JSON at byte " + std::to_string(p - begin) + ": " + message
+    );
+  }
+
+  void skipSpaces()
+  {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+      p++;
+    }
+  }
+
+  void expect(const char c)
+  {
+    skipSpaces();
+    if (p == end || *p != c) {
+      fail(std::string("expected '") + c + "'");
+    }
+    p++;
+  }
+
+  bool consumeLiteral(const char* literal)
+  {
+    const char* q = p;
+
+    for (; *literal; literal++, q++) {
+      if (q == end || *q != *literal) {
+        return false;
+      }
+    }
+
+    p = q;
+    return true;
+  }
+
+  Value parseValue(const int depth)
+  {
+    if (depth > maxDepth) {
+      fail("nesting is too deep");
+    }
+
+    skipSpaces();
+    if (p == end) {
+      fail("unexpected end of data");
+    }
+
+    Value value;
+
+    switch (*p) {
+      case '{':
+        parseObject(value, depth);
+        break;
+      case '[':
+        parseArray(value, depth);
+        break;
+      case '"':
+        value.type   = Value::Type::eString;
+        value.string = parseString();
+        break;
+      case 't':
+      case 'f':
+        value.type = Value::Type::eBool;
+        if (consumeLiteral("true")) {
+          value.boolean = true;
+        } else if (!consumeLiteral("false")) {
+          fail("invalid literal");
+        }
+        break;
+      case 'n':
+        if (!consumeLiteral("null")) {
+          fail("invalid literal");
+        }
+        break;
+      default:
+        value.type   = Value::Type::eNumber;
+        value.number = parseNumber();
+        break;
+    }
+
+    return value;
+  }
+
+  void parseObject(Value& value, const int depth)
+  {
+    value.type = Value::Type::eObject;
+    p++;
+
+    skipSpaces();
+    if (p < end && *p == '}') {
+      p++;
+      return;
+    }
+
+    while (true) {
+      skipSpaces();
+      if (p == end || *p != '"') {
+        fail("expected a member name");
+      }
+
+      std::string key = parseString();
+      expect(':');
+      value.object.emplace_back(std::move(key), parseValue(depth + 1));
+
+      skipSpaces();
+      if (p < end && *p == ',') {
+        p++;
+        continue;
+      }
+
+      expect('}');
+      return;
+    }
+  }
+
+  void parseArray(Value& value, const int depth)
+  {
+    value.type = Value::Type::eArray;
+    p++;
+
+    skipSpaces();
+    if (p < end && *p == ']') {
+      p++;
+      return;
+    }
+
+    while (true) {
+      value.array.push_back(parseValue(depth + 1));
+
+      skipSpaces();
+      if (p < end && *p == ',') {
+        p++;
+        continue;
+      }
+
+      expect(']');
+      return;
+    }
+  }
+
+  uint32_t parseHex4()
+  {
+    if (end - p < 4) {
+      fail("truncated unicode escape");
+    }
+
+    uint32_t codePoint = 0;
+
+    for (int i=0; i < 4; i++, p++) {
+      codePoint <<= 4;
+
+      if      (*p >= '0' && *p <= '9') { codePoint |= *p - '0';      }
+      else if (*p >= 'a' && *p <= 'f') { codePoint |= *p - 'a' + 10; }
+      else if (*p >= 'A' && *p <= 'F') { codePoint |= *p - 'A' + 10; }
+      else { fail("invalid unicode escape"); }
+    }
+
+    return codePoint;
+  }
+
+  void appendUtf8(std::string& string, const uint32_t codePoint)
+  {
+    if (codePoint < 0x80) {
+      string += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+      string += static_cast<char>(0xC0 | (codePoint >> 6));
+      string += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+      string += static_cast<char>(0xE0 | (codePoint >> 12));
+      string += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+      string += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+      string += static_cast<char>(0xF0 | (codePoint >> 18));
+      string += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+      string += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+      string += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+  }
+
+  std::string parseString()
+  {
+    std::string string;
+    p++; // Opening quote
+
+    while (true) {
+      if (p == end) {
+        fail("unterminated string");
+      }
+
+      const char c = *p++;
+
+      if (c == '"') {
+        return string;
+      }
+
+      if (c != '\\') {
+        string += c;
+        continue;
+      }
+
+      if (p == end) {
+        fail("unterminated string");
+      }
+
+      switch (*p++) {
+        case '"':  string += '"';  break;
+        case '\\': string += '\\'; break;
+        case '/':  string += '/';  break;
+        case 'b':  string += '\b'; break;
+        case 'f':  string += '\f'; break;
+        case 'n':  string += '\n'; break;
+        case 'r':  string += '\r'; break;
+        case 't':  string += '\t'; break;
+        case 'u': {
+          uint32_t codePoint = parseHex4();
+
+          // Surrogate pair
+          if (   codePoint >= 0xD800 && codePoint < 0xDC00
+              && end - p >= 2 && p[0] == '\\' && p[1] == 'u'
+          ) {
+            p += 2;
+            const uint32_t low = parseHex4();
+            codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+          }
+
+          appendUtf8(string, codePoint);
+          break;
+        }
+        default:
+          fail("invalid escape");
+      }
+    }
+  }
+
+  // Locale independent, unlike strtod
+  double parseNumber()
+  {
+    const char* start = p;
+
+    double sign = 1.0;
+    if (p < end && *p == '-') {
+      sign = -1.0;
+      p++;
+    }
+
+    double mantissa = 0.0;
+    int    exponent = 0;
+    bool   digits   = false;
+
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+      mantissa = mantissa * 10.0 + (*p - '0');
+      digits   = true;
+    }
+
+    if (p < end && *p == '.') {
+      p++;
+      for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        mantissa = mantissa * 10.0 + (*p - '0');
+        exponent--;
+        digits = true;
+      }
+    }
+
+    if (!digits) {
+      p = start;
+      fail("invalid value");
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+      p++;
+
+      int exponentSign = 1;
+      if (p < end && (*p == '+' || *p == '-')) {
+        exponentSign = *p == '-' ? -1 : 1;
+        p++;
+      }
+
+      int explicitExponent = 0;
+      for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        explicitExponent = std::min(explicitExponent * 10 + (*p - '0'), 100000);
+      }
+
+      exponent += exponentSign * explicitExponent;
+    }
+
+    return sign * mantissa * std::pow(10.0, exponent);
+  }
+};
+}
+
+const Value* Value::find(const std::string& key) const
+{
+  for (const auto& member : object) {
+    if (member.first == key) {
+      return &member.second;
+    }
+  }
+
+  return nullptr;
+}
+
+const Value& Value::operator[](const std::string& key) const
+{
+  const Value* value = find(key);
+
+  if (!value) {
+    throw std::runtime_error("missing JSON member " + key);
+  }
+
+  return *value;
+}
+
+const Value& Value::operator[](const size_t index) const
+{
+  if (index >= array.size()) {
+    throw std::runtime_error(
+      "JSON array index " + std::to_string(index) + " is out of range"
+    );
+  }
+
+  return array[index];
+}
+
+double Value::getNumber(const std::string& key, const double fallback) const
+{
+  const Value* value = find(key);
+
+  return value && value->type == Type::eNumber ? value->number : fallback;
+}
+
+Value parse(const char* data, const size_t size)
+{
+  return Parser(data, size).parseDocument();
+}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal JSON parser, used for the JSON chunk of glTF files
+// Parses into a tree of Values, and throws std::runtime_error on invalid JSON
+namespace Excal::Json
+{
+struct Value {
+  enum class Type { eNull, eBool, eNumber, eString, eArray, eObject };
+
+  Type        type    = Type::eNull;
+  bool        boolean = false;
+  double      number  = 0.0;
+  std::string string;
+
+  std::vector<Value>                         array;
+  std::vector<std::pair<std::string, Value>> object; // In file order
+
+  // Member of an object, nullptr if it's missing or this isn't an object
+  const Value* find(const std::string& key) const;
+
+  // Member or element that must exist, throws if it doesn't
+  const Value& operator[](const std::string& key) const;
+  const Value& operator[](const size_t index) const;
+
+  // Number member, or fallback if it's missing
+  double getNumber(const std::string& key, const double fallback) const;
+};
+
+Value parse(const char* data, const size_t size);
+}
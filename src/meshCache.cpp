@@ -0,0 +1,160 @@
+#include "meshCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "model.h"
+#include "utils.h"
+
+namespace Excal::MeshCache
+{
+const char meshCacheMagic[8] = { 'E', 'X', 'C', 'A', 'L', 'M', 'S', 'H' };
+
+std::string getCachePath(const std::string& modelPath)
+{
+  return modelPath + ".excalmesh";
+}
+
+bool getSourceKey(
+  const std::string& modelPath,
+  SourceKey&         sourceKey
+) {
+  if (!Excal::Utils::getFileInfo(modelPath, sourceKey.size, sourceKey.mtime)) {
+    return false;
+  }
+
+  try {
+    Excal::Utils::MappedFile source(modelPath);
+    sourceKey.hash = Excal::Utils::hashBytes(source.data(), source.size());
+  } catch (const std::exception&) {
+    return false;
+  }
+
+  return true;
+}
+
+bool readMeshCache(
+  const std::string&       modelPath,
+  const SourceKey&         sourceKey,
+  Excal::Model::ModelData& modelData
+) {
+  const auto cachePath = getCachePath(modelPath);
+
+  std::error_code ec;
+  if (!std::filesystem::exists(cachePath, ec)) {
+    return false;
+  }
+
+  try {
+    Excal::Utils::MappedFile cache(cachePath);
+
+    if (cache.size() < sizeof(MeshCacheHeader)) {
+      return false;
+    }
+
+    MeshCacheHeader header;
+    memcpy(&header, cache.data(), sizeof(header));
+
+    if (   memcmp(header.magic, meshCacheMagic, sizeof(meshCacheMagic)) != 0
+        || header.version      != meshCacheVersion
+        || header.vertexStride != sizeof(Vertex)
+        || header.sourceSize   != sourceKey.size
+        || header.sourceMtime  != sourceKey.mtime
+        || header.sourceHash   != sourceKey.hash
+    ) {
+      return false;
+    }
+
+    const size_t verticesSize = header.vertexCount * sizeof(Vertex);
+    const size_t indicesSize  = header.indexCount  * sizeof(uint32_t);
+
+    // Guard against truncated files
+    if (cache.size() != sizeof(header) + verticesSize + indicesSize) {
+      return false;
+    }
+
+    const char* blobs = cache.data() + sizeof(header);
+
+    modelData.vertices.resize(header.vertexCount);
+    modelData.indices.resize(header.indexCount);
+
+    memcpy(modelData.vertices.data(), blobs,                verticesSize);
+    memcpy(modelData.indices.data(),  blobs + verticesSize, indicesSize);
+
+    modelData.boundsMin = glm::vec3(
+      header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]
+    );
+    modelData.boundsMax = glm::vec3(
+      header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]
+    );
+  } catch (const std::exception&) {
+    return false;
+  }
+
+  return true;
+}
+
+void writeMeshCache(
+  const std::string&             modelPath,
+  const SourceKey&               sourceKey,
+  const Excal::Model::ModelData& modelData
+) {
+  MeshCacheHeader header{};
+
+  memcpy(header.magic, meshCacheMagic, sizeof(meshCacheMagic));
+  header.version      = meshCacheVersion;
+  header.vertexStride = sizeof(Vertex);
+  header.sourceSize   = sourceKey.size;
+  header.sourceMtime  = sourceKey.mtime;
+  header.sourceHash   = sourceKey.hash;
+  header.vertexCount  = modelData.vertices.size();
+  header.indexCount   = modelData.indices.size();
+
+  for (int i=0; i < 3; i++) {
+    header.boundsMin[i] = modelData.boundsMin[i];
+    header.boundsMax[i] = modelData.boundsMax[i];
+  }
+
+  // Write to a temporary file first and rename it into place, so a
+  // reader never sees a partially written cache
+  const auto cachePath = getCachePath(modelPath);
+
+  std::stringstream tmpPath;
+  tmpPath << cachePath << ".tmp" << std::this_thread::get_id();
+
+  {
+    std::ofstream file(tmpPath.str(), std::ios::out | std::ios::binary);
+
+    if (!file.is_open()) {
+      return;
+    }
+
+    file.write((const char*) &header, sizeof(header));
+    file.write(
+      (const char*) modelData.vertices.data(),
+      modelData.vertices.size() * sizeof(Vertex)
+    );
+    file.write(
+      (const char*) modelData.indices.data(),
+      modelData.indices.size() * sizeof(uint32_t)
+    );
+
+    if (!file.good()) {
+      file.close();
+      std::error_code ec;
+      std::filesystem::remove(tmpPath.str(), ec);
+      return;
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(tmpPath.str(), cachePath, ec);
+
+  if (ec) {
+    std::filesystem::remove(tmpPath.str(), ec);
+  }
+}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+
+#include "model.h"
+
+// Binary cache of welded model data, stored next to the source model
+// Layout: MeshCacheHeader | vertices | indices
+// A cache file is only used if the source model's size, modification
+// time, and content hash all match the values recorded in its header
+namespace Excal::MeshCache
+{
+// Bump whenever the layout of the header, Vertex, or blobs changes, or
+// whenever loadModel's welding or attribute generation changes its output
+const uint32_t meshCacheVersion = 3;
+
+struct SourceKey {
+  uint64_t size  = 0;
+  int64_t  mtime = 0;
+  uint64_t hash  = 0;
+};
+
+struct MeshCacheHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t vertexStride;
+  uint64_t sourceSize;
+  int64_t  sourceMtime;
+  uint64_t sourceHash;
+  uint64_t vertexCount;
+  uint64_t indexCount;
+  float    boundsMin[3];
+  float    boundsMax[3];
+};
+
+std::string getCachePath(const std::string& modelPath);
+
+// Returns false if the source model can't be read
+bool getSourceKey(
+  const std::string& modelPath,
+  SourceKey&         sourceKey
+);
+
+// Returns false if there is no cache for modelPath that matches sourceKey
+bool readMeshCache(
+  const std::string&       modelPath,
+  const SourceKey&         sourceKey,
+  Excal::Model::ModelData& modelData
+);
+
+// Failing to write the cache isn't an error, the model will just be
+// loaded from source again next time
+void writeMeshCache(
+  const std::string&             modelPath,
+  const SourceKey&               sourceKey,
+  const Excal::Model::ModelData& modelData
+);
+}
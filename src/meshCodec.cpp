@@ -0,0 +1,484 @@
+#include "meshCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define EXCAL_CODEC_SIMD
+  #include <immintrin.h>
+
+  // SIMD functions are compiled for SSSE3 without raising the baseline of
+  // the whole build, and are only called after checking the CPU has it
+  #if defined(__GNUC__)
+    #define EXCAL_TARGET_SSSE3 __attribute__((target("ssse3")))
+  #else
+    #define EXCAL_TARGET_SSSE3
+  #endif
+#endif
+
+namespace Excal::MeshCodec
+{
+namespace
+{
+// Byte length of the four values of each control byte, and the shuffle
+// that moves their bytes to the low bytes of four 32-bit lanes
+struct Tables {
+  uint8_t lengths[256];
+  alignas(16) uint8_t shuffles[256][16];
+};
+
+const Tables& getTables()
+{
+  static const Tables tables = [] {
+    Tables t;
+
+    for (int control=0; control < 256; control++) {
+      uint8_t offset = 0;
+
+      for (int lane=0; lane < 4; lane++) {
+        const int length = ((control >> (lane * 2)) & 3) + 1;
+
+        for (int byte=0; byte < 4; byte++) {
+          // High bit set shuffles in a zero
+          t.shuffles[control][lane * 4 + byte] = byte < length ? offset + byte : 0x80;
+        }
+
+        offset += length;
+      }
+
+      t.lengths[control] = offset;
+    }
+
+    return t;
+  }();
+
+  return tables;
+}
+
+bool hasSsse3()
+{
+#if defined(EXCAL_CODEC_SIMD) && defined(__GNUC__)
+  return __builtin_cpu_supports("ssse3");
+#elif defined(EXCAL_CODEC_SIMD)
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool simdEnabled = hasSsse3();
+
+uint32_t zigzag(const uint32_t delta)
+{
+  return (delta << 1) ^ (0u - (delta >> 31));
+}
+
+uint32_t unzigzag(const uint32_t value)
+{
+  return (value >> 1) ^ (0u - (value & 1));
+}
+
+uint32_t getByteLength(const uint32_t value)
+{
+  return value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+}
+
+size_t getGroupCount(const size_t valueCount)
+{
+  return (valueCount + 3) / 4;
+}
+
+std::vector<uint8_t> encodeValues(const std::vector<uint32_t>& values)
+{
+  const size_t groupCount = getGroupCount(values.size());
+
+  std::vector<uint8_t> data(groupCount);
+  data.reserve(groupCount + values.size() * 4);
+
+  for (size_t group=0; group < groupCount; group++) {
+    uint8_t control = 0;
+
+    // The last group is padded with zeros
+    for (size_t lane=0; lane < 4; lane++) {
+      const size_t   i      = group * 4 + lane;
+      const uint32_t value  = i < values.size() ? values[i] : 0;
+      const uint32_t length = getByteLength(value);
+
+      control |= (length - 1) << (lane * 2);
+
+      for (uint32_t byte=0; byte < length; byte++) {
+        data.push_back((value >> (byte * 8)) & 0xFF);
+      }
+    }
+
+    data[group] = control;
+  }
+
+  return data;
+}
+
+// Values of one group, after the zigzag is undone
+const uint8_t* decodeGroup(
+  const uint8_t  control,
+  const uint8_t* bytes,
+  uint32_t       values[4]
+) {
+  for (int lane=0; lane < 4; lane++) {
+    const int length = ((control >> (lane * 2)) & 3) + 1;
+
+    uint32_t value = 0;
+    for (int byte=0; byte < length; byte++) {
+      value |= uint32_t(bytes[byte]) << (byte * 8);
+    }
+
+    values[lane] = unzigzag(value);
+    bytes += length;
+  }
+
+  return bytes;
+}
+
+// Throws unless data holds groupCount groups
+void checkData(
+  const uint8_t* data,
+  const size_t   dataSize,
+  const size_t   groupCount
+) {
+  if (dataSize < groupCount) {
+    throw std::runtime_error("encoded mesh data is truncated");
+  }
+
+  const auto& tables = getTables();
+
+  size_t valueBytes = 0;
+  for (size_t group=0; group < groupCount; group++) {
+    valueBytes += tables.lengths[data[group]];
+  }
+
+  if (dataSize - groupCount < valueBytes) {
+    throw std::runtime_error("encoded mesh data is truncated");
+  }
+}
+
+template <typename T>
+void decodeIndicesScalar(
+  const uint8_t* controls,
+  const uint8_t* bytes,
+  const size_t   firstGroup,
+  const size_t   indexCount,
+  uint32_t       last,
+  T*             dst
+) {
+  for (size_t group=firstGroup; group < getGroupCount(indexCount); group++) {
+    uint32_t values[4];
+    bytes = decodeGroup(controls[group], bytes, values);
+
+    for (size_t lane=0; lane < 4 && group * 4 + lane < indexCount; lane++) {
+      last += values[lane];
+      dst[group * 4 + lane] = static_cast<T>(last);
+    }
+  }
+}
+
+// Decodes vertices in blocks that fit in the L1 cache, and writes each
+// vertex to dst once, since dst may be uncached write combined memory
+const size_t blockVertexCount = 64;
+
+void addVertexDeltas(
+  const uint32_t* deltas,
+  const size_t    vertexCount,
+  const size_t    wordCount,
+  uint32_t*       last,
+  uint8_t*        dst
+) {
+  for (size_t vertex=0; vertex < vertexCount; vertex++) {
+    for (size_t word=0; word < wordCount; word++) {
+      last[word] += deltas[vertex * wordCount + word];
+    }
+
+    memcpy(dst + vertex * wordCount * 4, last, wordCount * 4);
+  }
+}
+
+#ifdef EXCAL_CODEC_SIMD
+EXCAL_TARGET_SSSE3
+__m128i decodeGroupSimd(
+  const Tables&  tables,
+  const uint8_t  control,
+  const uint8_t* bytes
+) {
+  const __m128i shuffle = _mm_load_si128(
+    reinterpret_cast<const __m128i*>(tables.shuffles[control])
+  );
+  const __m128i value = _mm_shuffle_epi8(
+    _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes)), shuffle
+  );
+
+  // (value >> 1) ^ -(value & 1)
+  const __m128i sign = _mm_sub_epi32(
+    _mm_setzero_si128(), _mm_and_si128(value, _mm_set1_epi32(1))
+  );
+
+  return _mm_xor_si128(_mm_srli_epi32(value, 1), sign);
+}
+
+EXCAL_TARGET_SSSE3
+void storeIndices(uint32_t* dst, const __m128i indices)
+{
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), indices);
+}
+
+EXCAL_TARGET_SSSE3
+void storeIndices(uint16_t* dst, const __m128i indices)
+{
+  // Low 16 bits of each lane
+  const __m128i narrow = _mm_setr_epi8(
+    0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1
+  );
+
+  _mm_storel_epi64(
+    reinterpret_cast<__m128i*>(dst), _mm_shuffle_epi8(indices, narrow)
+  );
+}
+
+// Groups are decoded with SIMD while a full 16 byte load stays inside
+// data, which leaves a few groups at the end to the scalar decoder
+template <typename T>
+EXCAL_TARGET_SSSE3
+void decodeIndicesSimd(
+  const uint8_t* controls,
+  const uint8_t* bytes,
+  const uint8_t* end,
+  const size_t   indexCount,
+  T*             dst
+) {
+  const auto& tables = getTables();
+
+  __m128i last  = _mm_setzero_si128(); // Previous index in every lane
+  size_t  group = 0;
+
+  for (; group < indexCount / 4 && end - bytes >= 16; group++) {
+    __m128i indices = decodeGroupSimd(tables, controls[group], bytes);
+    bytes += tables.lengths[controls[group]];
+
+    // Prefix sum of the deltas, plus the previous index
+    indices = _mm_add_epi32(indices, _mm_slli_si128(indices, 4));
+    indices = _mm_add_epi32(indices, _mm_slli_si128(indices, 8));
+    indices = _mm_add_epi32(indices, last);
+
+    last = _mm_shuffle_epi32(indices, _MM_SHUFFLE(3, 3, 3, 3));
+
+    storeIndices(dst + group * 4, indices);
+  }
+
+  decodeIndicesScalar(
+    controls, bytes, group, indexCount, uint32_t(_mm_cvtsi128_si32(last)), dst
+  );
+}
+
+EXCAL_TARGET_SSSE3
+void addVertexDeltasSimd(
+  const uint32_t* deltas,
+  const size_t    vertexCount,
+  const size_t    wordCount,
+  uint32_t*       last,
+  uint8_t*        dst
+) {
+  const size_t simdWords = wordCount & ~size_t(3);
+
+  for (size_t vertex=0; vertex < vertexCount; vertex++) {
+    const uint32_t* vertexDeltas = deltas + vertex * wordCount;
+
+    for (size_t word=0; word < simdWords; word += 4) {
+      __m128i* lastWords = reinterpret_cast<__m128i*>(last + word);
+
+      _mm_storeu_si128(lastWords, _mm_add_epi32(
+        _mm_loadu_si128(lastWords),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(vertexDeltas + word))
+      ));
+    }
+
+    for (size_t word=simdWords; word < wordCount; word++) {
+      last[word] += vertexDeltas[word];
+    }
+
+    memcpy(dst + vertex * wordCount * 4, last, wordCount * 4);
+  }
+}
+
+EXCAL_TARGET_SSSE3
+const uint8_t* decodeGroupsSimd(
+  const uint8_t* controls,
+  const uint8_t* bytes,
+  const uint8_t* end,
+  const size_t   groupCount,
+  uint32_t*      values
+) {
+  const auto& tables = getTables();
+
+  size_t group = 0;
+
+  for (; group < groupCount && end - bytes >= 16; group++) {
+    _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(values + group * 4),
+      decodeGroupSimd(tables, controls[group], bytes)
+    );
+    bytes += tables.lengths[controls[group]];
+  }
+
+  for (; group < groupCount; group++) {
+    bytes = decodeGroup(controls[group], bytes, values + group * 4);
+  }
+
+  return bytes;
+}
+#endif
+
+template <typename T>
+void decodeIndicesImpl(
+  const uint8_t* data,
+  const size_t   dataSize,
+  const size_t   indexCount,
+  T*             dst
+) {
+  const size_t groupCount = getGroupCount(indexCount);
+  checkData(data, dataSize, groupCount);
+
+  const uint8_t* controls = data;
+  const uint8_t* bytes    = data + groupCount;
+
+#ifdef EXCAL_CODEC_SIMD
+  if (simdEnabled) {
+    decodeIndicesSimd(controls, bytes, data + dataSize, indexCount, dst);
+    return;
+  }
+#endif
+
+  decodeIndicesScalar(controls, bytes, 0, indexCount, 0, dst);
+}
+}
+
+std::vector<uint8_t> encodeIndices(
+  const uint32_t* indices,
+  const size_t    indexCount
+) {
+  std::vector<uint32_t> values(indexCount);
+
+  uint32_t last = 0;
+  for (size_t i=0; i < indexCount; i++) {
+    values[i] = zigzag(indices[i] - last);
+    last      = indices[i];
+  }
+
+  return encodeValues(values);
+}
+
+void decodeIndices(
+  const uint8_t* data,
+  const size_t   dataSize,
+  const size_t   indexCount,
+  uint32_t*      dst
+) {
+  decodeIndicesImpl(data, dataSize, indexCount, dst);
+}
+
+void decodeIndices(
+  const uint8_t* data,
+  const size_t   dataSize,
+  const size_t   indexCount,
+  uint16_t*      dst
+) {
+  decodeIndicesImpl(data, dataSize, indexCount, dst);
+}
+
+std::vector<uint8_t> encodeVertices(
+  const void*  vertices,
+  const size_t vertexCount,
+  const size_t vertexSize
+) {
+  if (vertexSize == 0 || vertexSize % 4 != 0) {
+    throw std::runtime_error("encoded vertex sizes must be a multiple of 4 bytes");
+  }
+
+  const size_t wordCount = vertexSize / 4;
+  const auto*  bytes     = static_cast<const uint8_t*>(vertices);
+
+  std::vector<uint32_t> values(vertexCount * wordCount);
+  std::vector<uint32_t> last(wordCount, 0);
+
+  for (size_t vertex=0; vertex < vertexCount; vertex++) {
+    for (size_t word=0; word < wordCount; word++) {
+      uint32_t value;
+      memcpy(&value, bytes + vertex * vertexSize + word * 4, 4);
+
+      values[vertex * wordCount + word] = zigzag(value - last[word]);
+      last[word] = value;
+    }
+  }
+
+  return encodeValues(values);
+}
+
+void decodeVertices(
+  const uint8_t* data,
+  const size_t   dataSize,
+  const size_t   vertexCount,
+  const size_t   vertexSize,
+  void*          dst
+) {
+  if (vertexSize == 0 || vertexSize % 4 != 0) {
+    throw std::runtime_error("encoded vertex sizes must be a multiple of 4 bytes");
+  }
+
+  const size_t wordCount  = vertexSize / 4;
+  const size_t groupCount = getGroupCount(vertexCount * wordCount);
+  checkData(data, dataSize, groupCount);
+
+  const uint8_t* controls = data;
+  const uint8_t* bytes    = data + groupCount;
+  const uint8_t* end      = data + dataSize;
+
+  // Blocks hold a multiple of 4 values, so groups never span blocks
+  std::vector<uint32_t> deltas(blockVertexCount * wordCount);
+  std::vector<uint32_t> last(wordCount, 0);
+
+  auto* out = static_cast<uint8_t*>(dst);
+
+  for (size_t first=0; first < vertexCount; first += blockVertexCount) {
+    const size_t blockVertices = std::min(blockVertexCount, vertexCount - first);
+    const size_t blockGroups   = getGroupCount(blockVertices * wordCount);
+    const size_t firstGroup    = first * wordCount / 4;
+
+#ifdef EXCAL_CODEC_SIMD
+    if (simdEnabled) {
+      bytes = decodeGroupsSimd(
+        controls + firstGroup, bytes, end, blockGroups, deltas.data()
+      );
+      addVertexDeltasSimd(
+        deltas.data(), blockVertices, wordCount, last.data(), out + first * vertexSize
+      );
+      continue;
+    }
+#endif
+
+    for (size_t group=0; group < blockGroups; group++) {
+      bytes = decodeGroup(controls[firstGroup + group], bytes, &deltas[group * 4]);
+    }
+
+    addVertexDeltas(
+      deltas.data(), blockVertices, wordCount, last.data(), out + first * vertexSize
+    );
+  }
+}
+
+bool isSimdEnabled()
+{
+  return simdEnabled;
+}
+
+void setSimdEnabled(const bool enabled)
+{
+  simdEnabled = enabled && hasSsse3();
+}
+}
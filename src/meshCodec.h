@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Lossless compression of index and vertex buffers
+// Values are delta coded against the previous index, or the same 32-bit
+// word of the previous vertex, zigzag coded so that small negative deltas
+// stay small, then stored with as few bytes as they need: a control byte
+// holds the byte length of four values, followed by their bytes
+// Layout: control bytes | value bytes, for a value count padded to a
+// multiple of 4
+// Decoding uses SSSE3 byte shuffles when the CPU has them
+namespace Excal::MeshCodec
+{
+std::vector<uint8_t> encodeIndices(
+  const uint32_t* indices,
+  const size_t    indexCount
+);
+
+// Decodes indexCount indices to dst, e.g. a mapped staging buffer
+// Throws if data is too short for indexCount indices
+void decodeIndices(
+  const uint8_t* data,
+  const size_t   dataSize,
+  const size_t   indexCount,
+  uint32_t*      dst
+);
+
+// For 16-bit index buffers, indices must be below 65536
+void decodeIndices(
+  const uint8_t* data,
+  const size_t   dataSize,
+  const size_t   indexCount,
+  uint16_t*      dst
+);
+
+// vertexSize must be a multiple of 4
+// Vertices compress best after optimizeVertexFetch, which stores
+// neighbouring vertices next to each other
+std::vector<uint8_t> encodeVertices(
+  const void*  vertices,
+  const size_t vertexCount,
+  const size_t vertexSize
+);
+
+void decodeVertices(
+  const uint8_t* data,
+  const size_t   dataSize,
+  const size_t   vertexCount,
+  const size_t   vertexSize,
+  void*          dst
+);
+
+// Whether decoding uses SIMD, which can be turned off to compare against
+// the scalar decoder. Setting enabled has no effect without SSSE3
+bool isSimdEnabled();
+void setSimdEnabled(const bool enabled);
+}
@@ -0,0 +1,1080 @@
+#include "meshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+#include "structs.h"
+
+namespace Excal::MeshOptimizer
+{
+namespace
+{
+// Triangles that use each vertex, in compressed sparse row layout
+struct TriangleAdjacency {
+  std::vector<uint32_t> offsets;   // vertexCount + 1 entries
+  std::vector<uint32_t> triangles;
+};
+
+TriangleAdjacency buildTriangleAdjacency(
+  const std::vector<uint32_t>& indices,
+  const size_t                 vertexCount
+) {
+  TriangleAdjacency adjacency;
+  adjacency.offsets.assign(vertexCount + 1, 0);
+  adjacency.triangles.resize(indices.size());
+
+  for (auto index : indices) {
+    adjacency.offsets[index + 1]++;
+  }
+
+  for (size_t i=0; i < vertexCount; i++) {
+    adjacency.offsets[i + 1] += adjacency.offsets[i];
+  }
+
+  std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+
+  for (size_t i=0; i < indices.size(); i++) {
+    adjacency.triangles[fill[indices[i]]++] = i / 3;
+  }
+
+  return adjacency;
+}
+
+glm::vec3 getPosition(
+  const float* positions,
+  const size_t positionStride,
+  const size_t index
+) {
+  auto position = reinterpret_cast<const float*>(
+    reinterpret_cast<const char*>(positions) + index * positionStride
+  );
+
+  return glm::vec3(position[0], position[1], position[2]);
+}
+
+float edgeFunction(const glm::vec2& a, const glm::vec2& b, const glm::vec2& p)
+{
+  return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+// Rasterizes a counterclockwise triangle with depth testing
+// Returns the number of pixels that passed the depth test
+size_t rasterizeTriangle(
+  const glm::vec2&    a,
+  const glm::vec2&    b,
+  const glm::vec2&    c,
+  const float         za,
+  const float         zb,
+  const float         zc,
+  const int           gridSize,
+  std::vector<float>& depthBuffer
+) {
+  const float area = edgeFunction(a, b, c);
+
+  const int minX = std::max(0,            int(std::floor(std::min({a.x, b.x, c.x}))));
+  const int minY = std::max(0,            int(std::floor(std::min({a.y, b.y, c.y}))));
+  const int maxX = std::min(gridSize - 1, int(std::ceil (std::max({a.x, b.x, c.x}))));
+  const int maxY = std::min(gridSize - 1, int(std::ceil (std::max({a.y, b.y, c.y}))));
+
+  size_t pixelsShaded = 0;
+
+  for (int y = minY; y <= maxY; y++) {
+    for (int x = minX; x <= maxX; x++) {
+      const glm::vec2 p(x + 0.5f, y + 0.5f);
+
+      const float w0 = edgeFunction(b, c, p);
+      const float w1 = edgeFunction(c, a, p);
+      const float w2 = edgeFunction(a, b, p);
+
+      if (w0 < 0 || w1 < 0 || w2 < 0) {
+        continue;
+      }
+
+      const float z = (w0 * za + w1 * zb + w2 * zc) / area;
+      float& depth  = depthBuffer[x + y * gridSize];
+
+      if (z < depth) {
+        depth = z;
+        pixelsShaded++;
+      }
+    }
+  }
+
+  return pixelsShaded;
+}
+
+// Number of FIFO cache misses when drawing a triangle
+// Entries older than cacheSize misses are evicted
+int updateVertexCache(
+  const uint32_t*        triangle,
+  const uint32_t         cacheSize,
+  uint32_t&              timestamp,
+  std::vector<uint32_t>& cacheTimestamps
+) {
+  int misses = 0;
+
+  for (int i=0; i < 3; i++) {
+    if (timestamp - cacheTimestamps[triangle[i]] > cacheSize) {
+      cacheTimestamps[triangle[i]] = timestamp++;
+      misses++;
+    }
+  }
+
+  return misses;
+}
+
+// Sum of squared distances to a set of planes, weighted by triangle area
+// Accumulated in double, since terms of many planes cancel out
+struct Quadric {
+  double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+  double b0  = 0, b1  = 0, b2  = 0;
+  double c   = 0;
+  double weight = 0;
+
+  void addPlane(const glm::vec3& normal, const float distance, const float w)
+  {
+    const double x = normal.x, y = normal.y, z = normal.z, d = distance;
+
+    a00 += w * x * x;
+    a11 += w * y * y;
+    a22 += w * z * z;
+    a01 += w * x * y;
+    a02 += w * x * z;
+    a12 += w * y * z;
+    b0  += w * x * d;
+    b1  += w * y * d;
+    b2  += w * z * d;
+    c   += w * d * d;
+    weight += w;
+  }
+
+  void add(const Quadric& other)
+  {
+    a00 += other.a00; a11 += other.a11; a22 += other.a22;
+    a01 += other.a01; a02 += other.a02; a12 += other.a12;
+    b0  += other.b0;  b1  += other.b1;  b2  += other.b2;
+    c   += other.c;
+    weight += other.weight;
+  }
+
+  // Area weighted mean squared distance of p to the planes, which orders
+  // collapses, but is at most the largest distance
+  float error(const glm::vec3& p) const
+  {
+    const double x = p.x, y = p.y, z = p.z;
+    const double r = a00 * x * x + a11 * y * y + a22 * z * z
+                   + 2 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                   + 2 * (b0 * x + b1 * y + b2 * z)
+                   + c;
+
+    return weight > 0 ? static_cast<float>(std::max(r / weight, 0.0)) : 0.0f;
+  }
+};
+
+struct Plane {
+  glm::vec3 normal;
+  float     distance;
+};
+
+// Maps each vertex to the first vertex with the same position, so that
+// vertices split by texcoords are treated as one point on the surface
+std::vector<uint32_t> getPositionRemap(
+  const float* positions,
+  const size_t vertexCount,
+  const size_t positionStride
+) {
+  std::vector<uint32_t> order(vertexCount);
+  std::iota(order.begin(), order.end(), 0);
+
+  auto getBytes = [&](const uint32_t index) {
+    return reinterpret_cast<const char*>(positions) + index * positionStride;
+  };
+
+  auto less = [&](const uint32_t a, const uint32_t b) {
+    const int compare = memcmp(getBytes(a), getBytes(b), 3 * sizeof(float));
+    return compare < 0 || (compare == 0 && a < b);
+  };
+
+  std::sort(order.begin(), order.end(), less);
+
+  std::vector<uint32_t> remap(vertexCount);
+
+  for (size_t i=0; i < vertexCount; i++) {
+    const bool samePosition = i > 0
+      && memcmp(getBytes(order[i]), getBytes(order[i-1]), 3 * sizeof(float)) == 0;
+
+    remap[order[i]] = samePosition ? remap[order[i-1]] : order[i];
+  }
+
+  return remap;
+}
+
+void computeMeshletBounds(
+  Meshlet&                     meshlet,
+  const std::vector<uint32_t>& indices,
+  const float*                 positions,
+  const size_t                 positionStride
+) {
+  const uint32_t end = meshlet.firstIndex + meshlet.indexCount;
+
+  glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+  glm::vec3 normalSum(0.0f);
+
+  for (uint32_t i = meshlet.firstIndex; i < end; i += 3) {
+    const auto a = getPosition(positions, positionStride, indices[i]);
+    const auto b = getPosition(positions, positionStride, indices[i+1]);
+    const auto c = getPosition(positions, positionStride, indices[i+2]);
+
+    boundsMin = glm::min(boundsMin, glm::min(a, glm::min(b, c)));
+    boundsMax = glm::max(boundsMax, glm::max(a, glm::max(b, c)));
+
+    const glm::vec3 normal = glm::cross(b - a, c - a);
+    const float     length = glm::length(normal);
+
+    if (length > 0) {
+      normalSum += normal / length;
+    }
+  }
+
+  const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+  float radius = 0.0f;
+
+  for (uint32_t i = meshlet.firstIndex; i < end; i++) {
+    const auto position = getPosition(positions, positionStride, indices[i]);
+    radius = std::max(radius, glm::length(position - center));
+  }
+
+  meshlet.center[0] = center.x;
+  meshlet.center[1] = center.y;
+  meshlet.center[2] = center.z;
+  meshlet.radius    = radius;
+
+  const float normalSumLength = glm::length(normalSum);
+
+  if (normalSumLength == 0) {
+    return;
+  }
+
+  const glm::vec3 axis = normalSum / normalSumLength;
+
+  // Cosine of the widest angle between the axis and a triangle normal
+  float minDot = 1.0f;
+
+  for (uint32_t i = meshlet.firstIndex; i < end; i += 3) {
+    const auto a = getPosition(positions, positionStride, indices[i]);
+    const auto b = getPosition(positions, positionStride, indices[i+1]);
+    const auto c = getPosition(positions, positionStride, indices[i+2]);
+
+    const glm::vec3 normal = glm::cross(b - a, c - a);
+    const float     length = glm::length(normal);
+
+    if (length > 0) {
+      minDot = std::min(minDot, glm::dot(axis, normal / length));
+    }
+  }
+
+  meshlet.coneAxis[0] = axis.x;
+  meshlet.coneAxis[1] = axis.y;
+  meshlet.coneAxis[2] = axis.z;
+
+  // A cone of 90 degrees or more can't be backfacing from any point
+  meshlet.coneCutoff = minDot <= 0 ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+}
+}
+
+VertexCacheStats analyzeVertexCache(
+  const std::vector<uint32_t>& indices,
+  const size_t                 vertexCount,
+  const uint32_t               cacheSize
+) {
+  VertexCacheStats stats;
+
+  if (indices.empty()) {
+    return stats;
+  }
+
+  // A vertex is in the FIFO cache if it was added within the last
+  // cacheSize misses
+  std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+  std::vector<bool>     referenced(vertexCount, false);
+
+  uint32_t timestamp   = cacheSize + 1;
+  size_t   misses      = 0;
+  size_t   nReferenced = 0;
+
+  for (auto index : indices) {
+    if (timestamp - cacheTimestamps[index] > cacheSize) {
+      cacheTimestamps[index] = timestamp++;
+      misses++;
+    }
+
+    if (!referenced[index]) {
+      referenced[index] = true;
+      nReferenced++;
+    }
+  }
+
+  stats.acmr = float(misses) / (indices.size() / 3);
+  stats.atvr = float(misses) / nReferenced;
+
+  return stats;
+}
+
+VertexFetchStats analyzeVertexFetch(
+  const std::vector<uint32_t>& indices,
+  const size_t                 vertexCount,
+  const size_t                 vertexSize
+) {
+  VertexFetchStats stats;
+
+  if (indices.empty() || vertexSize == 0) {
+    return stats;
+  }
+
+  const size_t cacheLineSize = 64;
+  const size_t nCacheLines   = 256;
+
+  // Tag of the line held in each cache slot, 0 means empty
+  std::vector<size_t> cacheTags(nCacheLines, 0);
+  std::vector<bool>   referenced(vertexCount, false);
+
+  size_t bytesFetched = 0;
+  size_t nReferenced  = 0;
+
+  for (auto index : indices) {
+    if (!referenced[index]) {
+      referenced[index] = true;
+      nReferenced++;
+    }
+
+    // A vertex can straddle two cache lines
+    const size_t firstLine = index * vertexSize / cacheLineSize;
+    const size_t lastLine  = ((index + 1) * vertexSize - 1) / cacheLineSize;
+
+    for (size_t line = firstLine; line <= lastLine; line++) {
+      auto& tag = cacheTags[line % nCacheLines];
+
+      if (tag != line + 1) {
+        tag = line + 1;
+        bytesFetched += cacheLineSize;
+      }
+    }
+  }
+
+  stats.overfetch = float(bytesFetched) / (nReferenced * vertexSize);
+
+  return stats;
+}
+
+OverdrawStats analyzeOverdraw(
+  const std::vector<uint32_t>& indices,
+  const float*                 positions,
+  const size_t                 vertexCount,
+  const size_t                 positionStride
+) {
+  OverdrawStats stats;
+
+  if (indices.empty()) {
+    return stats;
+  }
+
+  const int gridSize = 256;
+
+  // Fit the mesh in a unit cube, so each view covers the grid
+  glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+
+  for (size_t i=0; i < vertexCount; i++) {
+    const auto position = getPosition(positions, positionStride, i);
+    boundsMin = glm::min(boundsMin, position);
+    boundsMax = glm::max(boundsMax, position);
+  }
+
+  const glm::vec3 extent = boundsMax - boundsMin;
+  const float     scale  = std::max({extent.x, extent.y, extent.z});
+
+  std::vector<float> frontDepth(gridSize * gridSize);
+  std::vector<float> backDepth(gridSize * gridSize);
+
+  // Each axis is viewed from both directions. A triangle that faces one
+  // view is backfacing in the other, so it's only drawn into one of them
+  for (int axis = 0; axis < 3; axis++) {
+    std::fill(frontDepth.begin(), frontDepth.end(), FLT_MAX);
+    std::fill(backDepth.begin(),  backDepth.end(),  FLT_MAX);
+
+    for (size_t i=0; i < indices.size(); i += 3) {
+      glm::vec2 corners[3];
+      float     depths[3];
+
+      for (int j=0; j < 3; j++) {
+        auto position = getPosition(positions, positionStride, indices[i+j]);
+        position = (position - boundsMin) / (scale > 0 ? scale : 1.0f);
+
+        corners[j] = glm::vec2(
+          position[(axis + 1) % 3] * gridSize,
+          position[(axis + 2) % 3] * gridSize
+        );
+        depths[j] = position[axis];
+      }
+
+      const float area = edgeFunction(corners[0], corners[1], corners[2]);
+
+      // Counterclockwise triangles face the viewer on the positive side of
+      // the axis, where larger coordinates are closer
+      if (area > 0) {
+        stats.pixelsShaded += rasterizeTriangle(
+          corners[0],       corners[1],       corners[2],
+          1.0f - depths[0], 1.0f - depths[1], 1.0f - depths[2],
+          gridSize,         frontDepth
+        );
+      } else if (area < 0) {
+        // Seen from the negative side, which also flips the winding
+        stats.pixelsShaded += rasterizeTriangle(
+          corners[0], corners[2], corners[1],
+          depths[0],  depths[2],  depths[1],
+          gridSize,   backDepth
+        );
+      }
+    }
+
+    for (size_t i=0; i < frontDepth.size(); i++) {
+      stats.pixelsCovered += (frontDepth[i] != FLT_MAX) + (backDepth[i] != FLT_MAX);
+    }
+  }
+
+  if (stats.pixelsCovered > 0) {
+    stats.overdraw = float(stats.pixelsShaded) / stats.pixelsCovered;
+  }
+
+  return stats;
+}
+
+void optimizeVertexCache(
+  std::vector<uint32_t>& indices,
+  const size_t           vertexCount,
+  const uint32_t         cacheSize
+) {
+  if (indices.size() % 3 != 0) {
+    throw std::invalid_argument("index count must be a multiple of 3");
+  }
+
+  const size_t triangleCount = indices.size() / 3;
+
+  if (triangleCount == 0) {
+    return;
+  }
+
+  const auto adjacency = buildTriangleAdjacency(indices, vertexCount);
+
+  // Number of triangles using each vertex that haven't been emitted yet
+  std::vector<uint32_t> liveTriangles(vertexCount);
+  for (size_t i=0; i < vertexCount; i++) {
+    liveTriangles[i] = adjacency.offsets[i+1] - adjacency.offsets[i];
+  }
+
+  std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+  std::vector<bool>     emitted(triangleCount, false);
+
+  std::vector<uint32_t> deadEndStack;
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+
+  uint32_t timestamp = cacheSize + 1;
+  size_t   cursor    = 0; // Next vertex to try when the dead end stack is empty
+
+  int64_t fanningVertex = indices[0];
+
+  while (fanningVertex >= 0) {
+    candidates.clear();
+
+    // Emit every remaining triangle around the fanning vertex
+    for (uint32_t i =  adjacency.offsets[fanningVertex];
+                  i <  adjacency.offsets[fanningVertex + 1]; i++
+    ) {
+      const uint32_t triangle = adjacency.triangles[i];
+
+      if (emitted[triangle]) {
+        continue;
+      }
+
+      emitted[triangle] = true;
+
+      for (int j=0; j < 3; j++) {
+        const uint32_t vertex = indices[triangle*3 + j];
+
+        result.push_back(vertex);
+        deadEndStack.push_back(vertex);
+        candidates.push_back(vertex);
+        liveTriangles[vertex]--;
+
+        if (timestamp - cacheTimestamps[vertex] > cacheSize) {
+          cacheTimestamps[vertex] = timestamp++;
+        }
+      }
+    }
+
+    // Next fanning vertex is the candidate that will stay in the cache the
+    // longest after its remaining triangles are emitted
+    int64_t bestVertex   = -1;
+    int64_t bestPriority = -1;
+
+    for (auto vertex : candidates) {
+      if (liveTriangles[vertex] == 0) {
+        continue;
+      }
+
+      int64_t priority = 0;
+      const int64_t age = timestamp - cacheTimestamps[vertex];
+
+      if (age + 2 * liveTriangles[vertex] <= cacheSize) {
+        priority = age;
+      }
+
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        bestVertex   = vertex;
+      }
+    }
+
+    // Dead end, fall back to a recently used vertex, then to any vertex
+    // that still has triangles
+    if (bestVertex == -1) {
+      while (!deadEndStack.empty()) {
+        const uint32_t vertex = deadEndStack.back();
+        deadEndStack.pop_back();
+
+        if (liveTriangles[vertex] > 0) {
+          bestVertex = vertex;
+          break;
+        }
+      }
+    }
+
+    if (bestVertex == -1) {
+      while (cursor < vertexCount && liveTriangles[cursor] == 0) {
+        cursor++;
+      }
+
+      if (cursor < vertexCount) {
+        bestVertex = cursor;
+      }
+    }
+
+    fanningVertex = bestVertex;
+  }
+
+  indices = std::move(result);
+}
+
+void optimizeOverdraw(
+  std::vector<uint32_t>& indices,
+  const float*           positions,
+  const size_t           vertexCount,
+  const size_t           positionStride,
+  const float            threshold,
+  const uint32_t         cacheSize
+) {
+  const size_t triangleCount = indices.size() / 3;
+
+  if (triangleCount == 0) {
+    return;
+  }
+
+  std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+  uint32_t timestamp = cacheSize + 1;
+
+  // Hard boundaries are where the cache order starts over, i.e. triangles
+  // that miss on all three vertices. Reordering whole runs between hard
+  // boundaries doesn't change the vertex cache efficiency
+  std::vector<uint32_t> hardClusters;
+
+  for (size_t i=0; i < triangleCount; i++) {
+    int misses = updateVertexCache(&indices[i*3], cacheSize, timestamp, cacheTimestamps);
+
+    if (i == 0 || misses == 3) {
+      hardClusters.push_back(i);
+    }
+  }
+
+  hardClusters.push_back(triangleCount);
+
+  // Soft boundaries split hard clusters further, wherever restarting the
+  // cache keeps the cluster's ACMR within threshold of its original ACMR
+  std::vector<uint32_t> clusters;
+
+  for (size_t i=0; i+1 < hardClusters.size(); i++) {
+    const uint32_t start = hardClusters[i];
+    const uint32_t end   = hardClusters[i+1];
+
+    // Advancing the timestamp by cacheSize + 1 empties the cache
+    timestamp += cacheSize + 1;
+
+    size_t clusterMisses = 0;
+    for (uint32_t j = start; j < end; j++) {
+      clusterMisses += updateVertexCache(&indices[j*3], cacheSize, timestamp, cacheTimestamps);
+    }
+
+    const float clusterThreshold = threshold * clusterMisses / (end - start);
+
+    timestamp += cacheSize + 1;
+    clusters.push_back(start);
+
+    size_t runningMisses    = 0;
+    size_t runningTriangles = 0;
+
+    for (uint32_t j = start; j < end; j++) {
+      runningMisses += updateVertexCache(&indices[j*3], cacheSize, timestamp, cacheTimestamps);
+      runningTriangles++;
+
+      if (j + 1 < end && runningMisses <= clusterThreshold * runningTriangles) {
+        clusters.push_back(j + 1);
+        timestamp += cacheSize + 1;
+
+        runningMisses    = 0;
+        runningTriangles = 0;
+      }
+    }
+  }
+
+  clusters.push_back(triangleCount);
+
+  const size_t clusterCount = clusters.size() - 1;
+
+  // Area weighted centroids and normals of each cluster
+  std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+  std::vector<glm::vec3> clusterNormals(clusterCount,   glm::vec3(0.0f));
+  std::vector<float>     clusterAreas(clusterCount,     0.0f);
+
+  glm::vec3 meshCentroid(0.0f);
+  float     meshArea = 0.0f;
+
+  for (size_t i=0; i < clusterCount; i++) {
+    for (uint32_t j = clusters[i]; j < clusters[i+1]; j++) {
+      const auto a = getPosition(positions, positionStride, indices[j*3 + 0]);
+      const auto b = getPosition(positions, positionStride, indices[j*3 + 1]);
+      const auto c = getPosition(positions, positionStride, indices[j*3 + 2]);
+
+      // Length of the cross product is twice the triangle's area
+      const glm::vec3 normal = glm::cross(b - a, c - a);
+      const float     area   = glm::length(normal);
+
+      clusterCentroids[i] += (a + b + c) * (area / 3.0f);
+      clusterNormals[i]   += normal;
+      clusterAreas[i]     += area;
+    }
+
+    meshCentroid += clusterCentroids[i];
+    meshArea     += clusterAreas[i];
+  }
+
+  if (meshArea > 0) {
+    meshCentroid /= meshArea;
+  }
+
+  // Clusters that point away from the center are drawn first
+  std::vector<float> sortKeys(clusterCount, 0.0f);
+
+  for (size_t i=0; i < clusterCount; i++) {
+    const float normalLength = glm::length(clusterNormals[i]);
+
+    if (clusterAreas[i] > 0 && normalLength > 0) {
+      const glm::vec3 centroid = clusterCentroids[i] / clusterAreas[i];
+      sortKeys[i] = glm::dot(centroid - meshCentroid, clusterNormals[i] / normalLength);
+    }
+  }
+
+  std::vector<uint32_t> clusterOrder(clusterCount);
+  std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+
+  std::stable_sort(
+    clusterOrder.begin(), clusterOrder.end(),
+    [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; }
+  );
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+
+  for (auto cluster : clusterOrder) {
+    result.insert(
+      result.end(),
+      indices.begin() + clusters[cluster]     * 3,
+      indices.begin() + clusters[cluster + 1] * 3
+    );
+  }
+
+  indices = std::move(result);
+}
+
+std::vector<uint32_t> simplify(
+  const std::vector<uint32_t>& indices,
+  const float*                 positions,
+  const size_t                 vertexCount,
+  const size_t                 positionStride,
+  const size_t                 targetIndexCount,
+  const float                  targetError,
+  float*                       resultError
+) {
+  std::vector<uint32_t> result = indices;
+  float maxError = 0.0f;
+
+  if (resultError) {
+    *resultError = 0.0f;
+  }
+
+  if (result.size() <= targetIndexCount) {
+    return result;
+  }
+
+  const auto positionRemap = getPositionRemap(positions, vertexCount, positionStride);
+
+  auto getPos = [&](const uint32_t index) {
+    return getPosition(positions, positionStride, index);
+  };
+
+  // Vertices on a texture seam share their position with another vertex
+  std::vector<uint32_t> wedgeCounts(vertexCount, 0);
+  std::vector<bool>     referenced(vertexCount, false);
+
+  for (auto index : result) {
+    if (!referenced[index]) {
+      referenced[index] = true;
+      wedgeCounts[positionRemap[index]]++;
+    }
+  }
+
+  std::vector<bool> locked(vertexCount, false);
+
+  for (size_t i=0; i < vertexCount; i++) {
+    locked[i] = wedgeCounts[positionRemap[i]] > 1;
+  }
+
+  // Border edges are only used in one direction
+  std::vector<uint64_t> edges;
+  edges.reserve(result.size());
+
+  for (size_t i=0; i < result.size(); i += 3) {
+    for (int j=0; j < 3; j++) {
+      const uint64_t a = positionRemap[result[i + j]];
+      const uint64_t b = positionRemap[result[i + (j+1) % 3]];
+      edges.push_back(a << 32 | b);
+    }
+  }
+
+  std::sort(edges.begin(), edges.end());
+
+  for (const auto edge : edges) {
+    const uint64_t reverse = edge << 32 | edge >> 32;
+
+    if (!std::binary_search(edges.begin(), edges.end(), reverse)) {
+      locked[edge >> 32]        = true;
+      locked[edge & 0xffffffff] = true;
+    }
+  }
+
+  // Planes are relative to the center of the mesh's bounds, so that
+  // meshes far from the origin don't lose precision
+  glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+
+  for (auto index : result) {
+    boundsMin = glm::min(boundsMin, getPos(index));
+    boundsMax = glm::max(boundsMax, getPos(index));
+  }
+
+  const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+
+  auto getCenteredPos = [&](const uint32_t index) {
+    return getPos(index) - center;
+  };
+
+  // Quadrics are accumulated per position, and locks apply to every
+  // vertex at a locked position. Each position also keeps the planes of
+  // the original triangles around it, and the ones around every position
+  // collapsed onto it, to measure how far a collapse moves the surface
+  std::vector<Quadric>               quadrics(vertexCount);
+  std::vector<Plane>                 planes;
+  std::vector<std::vector<uint32_t>> positionPlanes(vertexCount);
+
+  for (size_t i=0; i < result.size(); i += 3) {
+    const auto p0 = getCenteredPos(result[i]);
+    const auto p1 = getCenteredPos(result[i+1]);
+    const auto p2 = getCenteredPos(result[i+2]);
+
+    const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+    const float     length = glm::length(normal);
+
+    if (length == 0) {
+      continue;
+    }
+
+    const glm::vec3 unitNormal = normal / length;
+    const float     distance   = -glm::dot(unitNormal, p0);
+
+    for (int j=0; j < 3; j++) {
+      quadrics[positionRemap[result[i+j]]].addPlane(unitNormal, distance, length * 0.5f);
+      positionPlanes[positionRemap[result[i+j]]].push_back(planes.size());
+    }
+
+    planes.push_back({unitNormal, distance});
+  }
+
+  // Largest distance of a point to the planes around two positions
+  auto getPlaneDistance = [&](const uint32_t a, const uint32_t b, const glm::vec3& p) {
+    float maxDistance = 0.0f;
+
+    for (const uint32_t position : { a, b }) {
+      for (const uint32_t plane : positionPlanes[position]) {
+        maxDistance = std::max(
+          maxDistance,
+          std::abs(glm::dot(planes[plane].normal, p) + planes[plane].distance)
+        );
+      }
+    }
+
+    return maxDistance;
+  };
+
+  for (size_t i=0; i < vertexCount; i++) {
+    locked[i] = locked[positionRemap[i]];
+  }
+
+  struct Collapse {
+    float    error;
+    uint32_t from;
+    uint32_t to;
+  };
+
+  std::vector<Collapse> collapses;
+  std::vector<uint32_t> collapseRemap(vertexCount);
+  std::vector<bool>     touched(vertexCount);
+
+  const float maxSquaredError = targetError * targetError;
+
+  // Each pass collapses edges that don't share any triangles, cheapest first
+  while (result.size() > targetIndexCount) {
+    const auto adjacency = buildTriangleAdjacency(result, vertexCount);
+
+    collapses.clear();
+
+    // Edges between unlocked vertices have a half edge in each direction,
+    // so both directions are considered without looking at reverse edges
+    for (size_t i=0; i < result.size(); i += 3) {
+      for (int j=0; j < 3; j++) {
+        const uint32_t from = result[i + j];
+        const uint32_t to   = result[i + (j+1) % 3];
+
+        if (locked[from]) {
+          continue;
+        }
+
+        Quadric quadric = quadrics[positionRemap[from]];
+        quadric.add(quadrics[positionRemap[to]]);
+
+        collapses.push_back({ quadric.error(getCenteredPos(to)), from, to });
+      }
+    }
+
+    std::sort(
+      collapses.begin(), collapses.end(),
+      [](const Collapse& a, const Collapse& b) { return a.error < b.error; }
+    );
+
+    // Each collapse removes about two triangles
+    const size_t collapseLimit = std::max<size_t>(
+      (result.size() - targetIndexCount) / 6, 1
+    );
+    size_t collapseCount = 0;
+
+    std::iota(collapseRemap.begin(), collapseRemap.end(), 0);
+    std::fill(touched.begin(), touched.end(), false);
+
+    for (const auto& collapse : collapses) {
+      // The mean is at most the largest distance, so no later collapse
+      // can stay within targetError either
+      if (collapse.error > maxSquaredError || collapseCount >= collapseLimit) {
+        break;
+      }
+
+      const uint32_t from = collapse.from;
+      const uint32_t to   = collapse.to;
+
+      if (touched[positionRemap[from]] || touched[positionRemap[to]]) {
+        continue;
+      }
+
+      // Reject collapses that flip a remaining triangle around from
+      const glm::vec3 toPos = getPos(to);
+      bool flips = false;
+
+      for (uint32_t k = adjacency.offsets[from]; k < adjacency.offsets[from + 1]; k++) {
+        const uint32_t* triangle = &result[adjacency.triangles[k] * 3];
+
+        glm::vec3 before[3], after[3];
+        bool degenerate = false;
+
+        for (int j=0; j < 3; j++) {
+          before[j]   = getPos(triangle[j]);
+          after[j]    = triangle[j] == from ? toPos : before[j];
+          degenerate |= positionRemap[triangle[j]] == positionRemap[to];
+        }
+
+        if (degenerate) {
+          continue;
+        }
+
+        const glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+        const glm::vec3 normalAfter  = glm::cross(after[1]  - after[0],  after[2]  - after[0]);
+
+        if (glm::dot(normalBefore, normalAfter) <= 0) {
+          flips = true;
+          break;
+        }
+      }
+
+      if (flips) {
+        continue;
+      }
+
+      const float distance = getPlaneDistance(
+        positionRemap[from], positionRemap[to], getCenteredPos(to)
+      );
+
+      if (distance > targetError) {
+        continue;
+      }
+
+      auto& fromPlanes = positionPlanes[positionRemap[from]];
+      auto& toPlanes   = positionPlanes[positionRemap[to]];
+
+      collapseRemap[from] = to;
+      quadrics[positionRemap[to]].add(quadrics[positionRemap[from]]);
+      toPlanes.insert(toPlanes.end(), fromPlanes.begin(), fromPlanes.end());
+      fromPlanes = std::vector<uint32_t>();
+      maxError = std::max(maxError, distance);
+      collapseCount++;
+
+      // Triangles around from change shape, so they can't be part of
+      // another collapse until the next pass
+      for (uint32_t k = adjacency.offsets[from]; k < adjacency.offsets[from + 1]; k++) {
+        for (int j=0; j < 3; j++) {
+          touched[positionRemap[result[adjacency.triangles[k] * 3 + j]]] = true;
+        }
+      }
+    }
+
+    if (collapseCount == 0) {
+      break;
+    }
+
+    size_t newSize = 0;
+
+    for (size_t i=0; i < result.size(); i += 3) {
+      const uint32_t a = collapseRemap[result[i]];
+      const uint32_t b = collapseRemap[result[i+1]];
+      const uint32_t c = collapseRemap[result[i+2]];
+
+      if (   positionRemap[a] != positionRemap[b]
+          && positionRemap[b] != positionRemap[c]
+          && positionRemap[c] != positionRemap[a]
+      ) {
+        result[newSize++] = a;
+        result[newSize++] = b;
+        result[newSize++] = c;
+      }
+    }
+
+    result.resize(newSize);
+  }
+
+  if (resultError) {
+    *resultError = maxError;
+  }
+
+  return result;
+}
+
+std::vector<Meshlet> buildMeshlets(
+  const std::vector<uint32_t>& indices,
+  const float*                 positions,
+  const size_t                 vertexCount,
+  const size_t                 positionStride,
+  const size_t                 firstIndex,
+  const size_t                 indexCount,
+  const size_t                 maxVertices,
+  const size_t                 maxTriangles
+) {
+  if (maxVertices < 3 || maxTriangles < 1) {
+    throw std::runtime_error("meshlets need at least 3 vertices and 1 triangle");
+  }
+
+  std::vector<Meshlet> meshlets;
+
+  // Last meshlet that used each vertex
+  std::vector<uint32_t> vertexMeshlets(vertexCount, UINT32_MAX);
+
+  Meshlet current;
+  current.firstIndex = firstIndex;
+
+  for (size_t i = firstIndex; i < firstIndex + indexCount; i += 3) {
+    const uint32_t* triangle = &indices[i];
+    const uint32_t  id       = meshlets.size();
+
+    auto countNewVertices = [&](const uint32_t meshletId) {
+      size_t count = 0;
+      for (int j=0; j < 3; j++) {
+        const bool repeated = (j > 0 && triangle[j] == triangle[0])
+                           || (j > 1 && triangle[j] == triangle[1]);
+
+        count += !repeated && vertexMeshlets[triangle[j]] != meshletId;
+      }
+      return count;
+    };
+
+    if (   current.vertexCount + countNewVertices(id) > maxVertices
+        || current.indexCount / 3 >= maxTriangles
+    ) {
+      meshlets.push_back(current);
+
+      current            = Meshlet();
+      current.firstIndex = i;
+    }
+
+    const uint32_t currentId = meshlets.size();
+    current.vertexCount += countNewVertices(currentId);
+    current.indexCount  += 3;
+
+    for (int j=0; j < 3; j++) {
+      vertexMeshlets[triangle[j]] = currentId;
+    }
+  }
+
+  if (current.indexCount > 0) {
+    meshlets.push_back(current);
+  }
+
+  for (auto& meshlet : meshlets) {
+    computeMeshletBounds(meshlet, indices, positions, positionStride);
+  }
+
+  return meshlets;
+}
+
+std::vector<uint32_t> getVertexFetchRemap(
+  const std::vector<uint32_t>& indices,
+  const size_t                 vertexCount
+) {
+  std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+  uint32_t nextIndex = 0;
+
+  for (auto index : indices) {
+    if (remap[index] == UINT32_MAX) {
+      remap[index] = nextIndex++;
+    }
+  }
+
+  return remap;
+}
+}
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Load time mesh optimizations
+// All functions work on indexed triangle lists
+namespace Excal::MeshOptimizer
+{
+// Post-transform vertex cache efficiency, simulated with a FIFO cache
+struct VertexCacheStats {
+  float acmr = 0.0; // Average cache miss ratio, transformed vertices per triangle
+  float atvr = 0.0; // Average transformed vertex ratio, transformed vertices per vertex
+};
+
+VertexCacheStats analyzeVertexCache(
+  const std::vector<uint32_t>& indices,
+  const size_t                 vertexCount,
+  const uint32_t               cacheSize = 16
+);
+
+// Vertex buffer bytes fetched through a simulated 16KB direct mapped cache,
+// relative to the size of the referenced vertices
+struct VertexFetchStats {
+  float overfetch = 0.0;
+};
+
+VertexFetchStats analyzeVertexFetch(
+  const std::vector<uint32_t>& indices,
+  const size_t                 vertexCount,
+  const size_t                 vertexSize
+);
+
+// Pixels shaded relative to pixels covered, measured by rasterizing the mesh
+// on the CPU from six axis aligned views with backface culling
+struct OverdrawStats {
+  float  overdraw      = 0.0f;
+  size_t pixelsCovered = 0;
+  size_t pixelsShaded  = 0;
+};
+
+// positions points to the first vertex's position (3 floats), and
+// consecutive positions are positionStride bytes apart
+OverdrawStats analyzeOverdraw(
+  const std::vector<uint32_t>& indices,
+  const float*                 positions,
+  const size_t                 vertexCount,
+  const size_t                 positionStride
+);
+
+// Reorders triangles to improve post-transform vertex cache hit rate
+// Implements Tipsify, from "Fast Triangle Reordering for Vertex Locality
+// and Reduced Overdraw" (Sander, Nehab, Barczak 2007)
+void optimizeVertexCache(
+  std::vector<uint32_t>& indices,
+  const size_t           vertexCount,
+  const uint32_t         cacheSize = 16
+);
+
+// Reorders triangles to reduce overdraw, while keeping the vertex cache
+// efficiency of an order produced by optimizeVertexCache
+// Triangles are split into clusters where the cache order allows it, and
+// clusters facing away from the mesh's center are drawn first, since they
+// are the most likely to occlude others. threshold is the factor by which
+// a cluster's ACMR may grow (e.g. 1.05) in exchange for smaller clusters
+void optimizeOverdraw(
+  std::vector<uint32_t>& indices,
+  const float*           positions,
+  const size_t           vertexCount,
+  const size_t           positionStride,
+  const float            threshold,
+  const uint32_t         cacheSize = 16
+);
+
+// Simplifies a mesh by collapsing edges in order of quadric error, from
+// "Surface Simplification Using Quadric Error Metrics" (Garland, Heckbert 1997)
+// Vertices are collapsed onto their neighbours, so the result indexes the
+// same vertex array. Vertices on borders and texture seams are never moved
+// Stops at targetIndexCount, or before a collapse would move the surface
+// further than targetError. resultError is set to the largest distance the
+// surface moved, in the same units as positions, measured from each moved
+// vertex to the planes of the input triangles it replaced
+std::vector<uint32_t> simplify(
+  const std::vector<uint32_t>& indices,
+  const float*                 positions,
+  const size_t                 vertexCount,
+  const size_t                 positionStride,
+  const size_t                 targetIndexCount,
+  const float                  targetError,
+  float*                       resultError = nullptr
+);
+
+// Cluster of triangles that is drawn or culled as one index range
+struct Meshlet {
+  uint32_t firstIndex  = 0;
+  uint32_t indexCount  = 0;
+  uint32_t vertexCount = 0; // Unique vertices
+
+  // Bounding sphere
+  float center[3] = { 0.0f, 0.0f, 0.0f };
+  float radius    = 0.0f;
+
+  // Cone containing the normals of every triangle (counterclockwise front
+  // faces). coneCutoff is the sine of its half angle, or 1 if the cone is
+  // too wide for the meshlet to ever be backfacing
+  float coneAxis[3] = { 0.0f, 0.0f, 0.0f };
+  float coneCutoff  = 1.0f;
+};
+
+// Splits the triangles in indices[firstIndex, firstIndex + indexCount) into
+// meshlets, in order, starting a new meshlet when one would exceed
+// maxVertices or maxTriangles. Meshlets cover consecutive index ranges, so
+// triangles should already be in vertex cache order to keep them compact
+std::vector<Meshlet> buildMeshlets(
+  const std::vector<uint32_t>& indices,
+  const float*                 positions,
+  const size_t                 vertexCount,
+  const size_t                 positionStride,
+  const size_t                 firstIndex,
+  const size_t                 indexCount,
+  const size_t                 maxVertices  = 64,
+  const size_t                 maxTriangles = 124
+);
+
+// Returns the new position of each vertex when vertices are stored in the
+// order the index buffer first references them
+// Unreferenced vertices are mapped to UINT32_MAX
+std::vector<uint32_t> getVertexFetchRemap(
+  const std::vector<uint32_t>& indices,
+  const size_t                 vertexCount
+);
+
+// Rewrites vertices in the order the index buffer first references them, and
+// remaps indices to match. Should run after any triangle reordering
+// Vertices that aren't referenced by any triangle are removed
+template <typename T>
+void optimizeVertexFetch(
+  std::vector<uint32_t>& indices,
+  std::vector<T>&        vertices
+) {
+  const auto remap = getVertexFetchRemap(indices, vertices.size());
+
+  size_t newVertexCount = 0;
+  for (auto newIndex : remap) {
+    newVertexCount += newIndex != UINT32_MAX;
+  }
+
+  std::vector<T> newVertices(newVertexCount);
+
+  for (size_t i=0; i < vertices.size(); i++) {
+    if (remap[i] != UINT32_MAX) {
+      newVertices[remap[i]] = vertices[i];
+    }
+  }
+
+  for (auto& index : indices) {
+    index = remap[index];
+  }
+
+  vertices = std::move(newVertices);
+}
+
+// Vertex types with a glm::vec3 pos member
+
+template <typename T>
+OverdrawStats analyzeOverdraw(
+  const std::vector<uint32_t>& indices,
+  const std::vector<T>&        vertices
+) {
+  return analyzeOverdraw(
+    indices,
+    vertices.empty() ? nullptr : &vertices[0].pos.x,
+    vertices.size(),
+    sizeof(T)
+  );
+}
+
+template <typename T>
+std::vector<uint32_t> simplify(
+  const std::vector<uint32_t>& indices,
+  const std::vector<T>&        vertices,
+  const size_t                 targetIndexCount,
+  const float                  targetError,
+  float*                       resultError = nullptr
+) {
+  return simplify(
+    indices,
+    vertices.empty() ? nullptr : &vertices[0].pos.x,
+    vertices.size(),
+    sizeof(T),
+    targetIndexCount,
+    targetError,
+    resultError
+  );
+}
+
+template <typename T>
+void optimizeOverdraw(
+  std::vector<uint32_t>& indices,
+  const std::vector<T>&  vertices,
+  const float            threshold
+) {
+  optimizeOverdraw(
+    indices,
+    vertices.empty() ? nullptr : &vertices[0].pos.x,
+    vertices.size(),
+    sizeof(T),
+    threshold
+  );
+}
+
+template <typename T>
+std::vector<Meshlet> buildMeshlets(
+  const std::vector<uint32_t>& indices,
+  const std::vector<T>&        vertices,
+  const size_t                 firstIndex,
+  const size_t                 indexCount
+) {
+  return buildMeshlets(
+    indices,
+    vertices.empty() ? nullptr : &vertices[0].pos.x,
+    vertices.size(),
+    sizeof(T),
+    firstIndex,
+    indexCount
+  );
+}
+}
@@ -0,0 +1,132 @@
+#include "meshRegistry.h"
+
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include "assetPack.h"
+#include "model.h"
+
+namespace Excal::MeshRegistry
+{
+namespace
+{
+std::mutex registryMutex;
+std::unordered_map<std::string, std::shared_ptr<const Excal::Model::Mesh>> meshes;
+
+bool isGlb(const std::string& modelPath)
+{
+  const std::string extension = ".glb";
+
+  return modelPath.size() >= extension.size()
+         && modelPath.compare(
+              modelPath.size() - extension.size(), extension.size(), extension
+            ) == 0;
+}
+
+// GLB vertices are left in the mapped file, unless normals or tangents
+// have to be generated for them
+std::shared_ptr<Excal::Model::Mesh> loadMesh(const std::string& modelPath)
+{
+  auto mesh = std::make_shared<Excal::Model::Mesh>();
+
+  if (!isGlb(modelPath)) {
+    auto modelData = Excal::Model::loadModelCached(modelPath);
+
+    mesh->indices  = std::move(modelData.indices);
+    mesh->vertices = std::move(modelData.vertices);
+
+    return mesh;
+  }
+
+  auto glb = Excal::Gltf::loadGlb(modelPath);
+  mesh->indices = std::move(glb.indices);
+
+  if (Excal::Gltf::hasNormalsAndTangents(glb.vertices)) {
+    mesh->glbVertices = std::move(glb.vertices);
+    return mesh;
+  }
+
+  mesh->vertices.resize(glb.vertices.vertexCount);
+  for (size_t i=0; i < mesh->vertices.size(); i++) {
+    mesh->vertices[i] = Excal::Gltf::readVertex(glb.vertices, i);
+  }
+
+  bool hasNormals = true;
+  for (const auto& primitive : glb.vertices.primitives) {
+    hasNormals = hasNormals && primitive.normal.count != 0;
+  }
+
+  if (!hasNormals) {
+    Excal::Model::generateNormals(mesh->indices, mesh->vertices, true);
+  }
+  Excal::Model::generateTangents(mesh->indices, mesh->vertices);
+
+  return mesh;
+}
+}
+
+std::string getMeshKey(
+  const std::string&                modelPath,
+  const Excal::Model::ModelOptions& options
+) {
+  std::ostringstream key;
+
+  // Floats are written exactly, so keys only match for equal options
+  // printStats doesn't change the mesh, so it isn't part of the key
+  key << std::hexfloat
+      << options.optimizeVertexCache << options.optimizeOverdraw
+      << options.optimizeVertexFetch << options.buildMeshlets
+      << " " << options.overdrawThreshold
+      << " " << options.lodCount
+      << " " << options.lodReduction
+      << " " << modelPath;
+
+  return key.str();
+}
+
+std::shared_ptr<const Excal::Model::Mesh> getMesh(
+  const std::string&                modelPath,
+  const Excal::Model::ModelOptions& options
+) {
+  const auto key = getMeshKey(modelPath, options);
+
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    auto it = meshes.find(key);
+    if (it != meshes.end()) {
+      return it->second;
+    }
+  }
+
+  // Loaded without holding the lock, so other meshes can load in parallel
+  // Meshes in mounted asset packs were optimized when they were baked
+  std::shared_ptr<const Excal::Model::Mesh> mesh = Excal::AssetPack::findMesh(key);
+
+  if (!mesh) {
+    auto loadedMesh = loadMesh(modelPath);
+    Excal::Model::optimizeMesh(*loadedMesh, options, modelPath);
+
+    mesh = std::move(loadedMesh);
+  }
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+
+  return meshes.emplace(key, std::move(mesh)).first->second;
+}
+
+size_t getMeshCount()
+{
+  std::lock_guard<std::mutex> lock(registryMutex);
+
+  return meshes.size();
+}
+
+void clear()
+{
+  std::lock_guard<std::mutex> lock(registryMutex);
+
+  meshes.clear();
+}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "model.h"
+
+// Meshes loaded from model files, shared by every model created from the
+// same path and options, so repeated models are loaded and uploaded once
+// Safe to call from multiple threads
+namespace Excal::MeshRegistry
+{
+// Identifies a mesh by its path and the options it's optimized with
+std::string getMeshKey(
+  const std::string&                modelPath,
+  const Excal::Model::ModelOptions& options
+);
+
+// Returns the registered mesh for modelPath and options, reading it from
+// a mounted asset pack, or loading it with Excal::Model::loadModelCached
+// and optimizing it on first use
+// Threads that miss on the same key at the same time may both load it,
+// in which case the first registered mesh is returned to both
+std::shared_ptr<const Excal::Model::Mesh> getMesh(
+  const std::string&                modelPath,
+  const Excal::Model::ModelOptions& options
+);
+
+size_t getMeshCount();
+
+// Drops the registry's references, models keep the meshes they use
+void clear();
+}
@@ -2,15 +2,544 @@
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
 #include <unordered_map>
 #include <vector>
 
 #include "structs.h"
+#include "meshCache.h"
+#include "meshCodec.h"
+#include "objParser.h"
+#include "meshOptimizer.h"
+#include "meshRegistry.h"
+#include "threadPool.h"
 
 namespace Excal::Model
 {
+namespace
+{
+// Open addressing hash table with linear probing that maps fixed size keys
+// of uint32_t words to indices. Keys are stored inline, so lookups don't
+// chase pointers like std::unordered_map does
+template <size_t N>
+class IndexTable
+{
+public:
+  using Key = std::array<uint32_t, N>;
+
+  IndexTable(const size_t expectedKeys)
+  {
+    size_t capacity = 16;
+    while (capacity < expectedKeys * 2) {
+      capacity *= 2;
+    }
+
+    resize(capacity);
+  }
+
+  // Returns the index stored for key, first storing newIndex if key is new
+  uint32_t findOrInsert(const Key& key, const uint32_t newIndex)
+  {
+    size_t slot = hash(key) & mask;
+
+    while (values[slot] != emptySlot) {
+      if (keys[slot] == key) {
+        return values[slot];
+      }
+      slot = (slot + 1) & mask;
+    }
+
+    keys[slot]   = key;
+    values[slot] = newIndex;
+
+    // Keep the load factor at or below 1/2
+    if (++nKeys * 2 > keys.size()) {
+      resize(keys.size() * 2);
+    }
+
+    return newIndex;
+  }
+
+private:
+  static constexpr uint32_t emptySlot = UINT32_MAX;
+
+  std::vector<Key>      keys;
+  std::vector<uint32_t> values;
+  size_t                mask;
+  size_t                nKeys = 0;
+
+  static size_t hash(const Key& key)
+  {
+    uint64_t h = 0;
+    for (const uint32_t word : key) {
+      h = (h ^ word) * 0x9e3779b97f4a7c15ull;
+    }
+
+    return h ^ (h >> 32);
+  }
+
+  void resize(const size_t capacity)
+  {
+    auto oldKeys   = std::move(keys);
+    auto oldValues = std::move(values);
+
+    mask = capacity - 1;
+    keys.assign(capacity, Key{});
+    values.assign(capacity, emptySlot);
+
+    for (size_t i=0; i < oldKeys.size(); i++) {
+      if (oldValues[i] != emptySlot) {
+        size_t slot = hash(oldKeys[i]) & mask;
+        while (values[slot] != emptySlot) {
+          slot = (slot + 1) & mask;
+        }
+
+        keys[slot]   = oldKeys[i];
+        values[slot] = oldValues[i];
+      }
+    }
+  }
+};
+
+// Bit pattern of a float, with -0.0 and 0.0 mapped to the same
+// key since they compare equal
+uint32_t floatKey(const float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  return bits == 0x80000000u ? 0 : bits;
+}
+
+// Maps each element of an attribute array to the first element with the
+// same value, so that index tuples can be compared instead of values
+// Element nElements is an extra zero element, the value of missing
+// attributes. Elements with a NaN map to noCanonicalIndex, since they
+// never compare equal to anything
+const uint32_t noCanonicalIndex = UINT32_MAX;
+
+template <size_t N>
+std::vector<uint32_t> getCanonicalIndices(
+  const std::vector<float>& attributes
+) {
+  const size_t nElements = attributes.size() / N;
+
+  std::vector<uint32_t> canonicalIndices(nElements + 1);
+  IndexTable<N> uniqueElements(nElements + 1);
+
+  for (size_t i=0; i <= nElements; i++) {
+    typename IndexTable<N>::Key key;
+    bool                        isNan = false;
+
+    for (size_t j=0; j < N; j++) {
+      const float value = i < nElements ? attributes[i*N + j] : 0.0f;
+
+      isNan  = isNan || std::isnan(value);
+      key[j] = floatKey(value);
+    }
+
+    canonicalIndices[i] = isNan ? noCanonicalIndex
+                                : uniqueElements.findOrInsert(key, i);
+  }
+
+  return canonicalIndices;
+}
+
+Vertex getVertex(
+  const Excal::ObjParser::ObjData&  objData,
+  const Excal::ObjParser::ObjIndex& corner
+) {
+  Vertex vertex{};
+
+  const float* pos = &objData.positions[3 * corner.vertexIndex];
+  vertex.pos = { pos[0], pos[1], pos[2] };
+
+  if (corner.texcoordIndex >= 0) {
+    const float* texCoord = &objData.texcoords[2 * corner.texcoordIndex];
+    vertex.texCoord = {
+      texCoord[0],
+      1.0f - texCoord[1] // Flip vertical coordinate
+    };
+  }
+
+  // Left as 0 if missing, to be generated after welding
+  if (corner.normalIndex >= 0) {
+    const float* normal = &objData.normals[3 * corner.normalIndex];
+    vertex.normal = { normal[0], normal[1], normal[2] };
+  }
+
+  // Not handled by this model loader
+  vertex.color = {1.0f, 1.0f, 1.0f};
+
+  return vertex;
+}
+
+bool hasNormals(const Excal::ObjParser::ObjData& objData)
+{
+  for (const auto& corner : objData.corners) {
+    if (corner.normalIndex < 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Splits [0, count) into a few ranges per thread, and calls fn(begin, end)
+// for each range on the engine's thread pool
+template <typename F>
+void parallelForRange(const size_t count, F&& fn)
+{
+  auto& threadPool = Excal::getThreadPool();
+
+  const size_t minRangeSize = 4096;
+  const size_t nRanges      = std::max<size_t>(
+    1, std::min(threadPool.getThreadCount() * 4, count / minRangeSize)
+  );
+
+  threadPool.parallelFor(nRanges, [&](size_t i) {
+    fn(count * i / nRanges, count * (i + 1) / nRanges);
+  });
+}
+
+void addBounds(
+  const Vertex& vertex,
+  ModelData&    modelData
+) {
+  if (modelData.vertices.size() == 1) {
+    modelData.boundsMin = vertex.pos;
+    modelData.boundsMax = vertex.pos;
+  }
+
+  modelData.boundsMin = glm::min(modelData.boundsMin, vertex.pos);
+  modelData.boundsMax = glm::max(modelData.boundsMax, vertex.pos);
+}
+
+void addVertex(
+  const Vertex&                         vertex,
+  std::unordered_map<Vertex, uint32_t>& uniqueVertices,
+  ModelData&                            modelData
+) {
+  if (uniqueVertices.count(vertex) == 0) {
+    uniqueVertices[vertex] = static_cast<uint32_t>(modelData.vertices.size());
+    modelData.vertices.push_back(vertex);
+    addBounds(vertex, modelData);
+  }
+
+  modelData.indices.push_back(uniqueVertices[vertex]);
+}
+
+uint16_t quantizeUnorm16(const float value)
+{
+  return static_cast<uint16_t>(std::clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+int16_t quantizeSnorm16(const float value)
+{
+  return static_cast<int16_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+int8_t quantizeSnorm8(const float value)
+{
+  return static_cast<int8_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 127.0f));
+}
+
+// Maps a unit vector onto the faces of an octahedron, then unfolds the
+// octahedron's lower half onto the corners of a square
+glm::vec2 encodeOctahedral(const glm::vec3& normal)
+{
+  const float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+
+  if (length == 0.0f) {
+    return glm::vec2(0.0);
+  }
+
+  glm::vec2 encoded(normal.x / length, normal.y / length);
+
+  if (normal.z < 0.0f) {
+    encoded = glm::vec2(
+      (1.0f - std::abs(encoded.y)) * (encoded.x >= 0.0f ? 1.0f : -1.0f),
+      (1.0f - std::abs(encoded.x)) * (encoded.y >= 0.0f ? 1.0f : -1.0f)
+    );
+  }
+
+  return encoded;
+}
+
+// Bounds of positions and texture coordinates, to quantize vertices with
+struct VertexBounds {
+  glm::vec3 posMin;
+  glm::vec3 posMax;
+  glm::vec2 texCoordMin;
+  glm::vec2 texCoordMax;
+  bool      empty = true;
+
+  void add(const Vertex& vertex)
+  {
+    posMin      = empty ? vertex.pos      : glm::min(posMin,      vertex.pos);
+    posMax      = empty ? vertex.pos      : glm::max(posMax,      vertex.pos);
+    texCoordMin = empty ? vertex.texCoord : glm::min(texCoordMin, vertex.texCoord);
+    texCoordMax = empty ? vertex.texCoord : glm::max(texCoordMax, vertex.texCoord);
+    empty       = false;
+  }
+
+  VertexQuantization getQuantization() const
+  {
+    VertexQuantization quantization;
+
+    if (empty) {
+      return quantization;
+    }
+
+    quantization.positionOffset = posMin;
+    quantization.texCoordOffset = texCoordMin;
+
+    // Flat axes keep a scale of 1 so that they don't divide by 0
+    for (int axis=0; axis < 3; axis++) {
+      float extent = posMax[axis] - posMin[axis];
+      quantization.positionScale[axis] = extent > 0.0f ? extent : 1.0f;
+    }
+
+    for (int axis=0; axis < 2; axis++) {
+      float extent = texCoordMax[axis] - texCoordMin[axis];
+      quantization.texCoordScale[axis] = extent > 0.0f ? extent : 1.0f;
+    }
+
+    return quantization;
+  }
+};
+
+PackedVertex packVertex(
+  const Vertex&             vertex,
+  const VertexQuantization& quantization
+) {
+  PackedVertex packed;
+
+  glm::vec3 pos = (vertex.pos - quantization.positionOffset)
+                  / quantization.positionScale;
+
+  glm::vec2 texCoord = (vertex.texCoord - quantization.texCoordOffset)
+                       / quantization.texCoordScale;
+
+  glm::vec2 normal  = encodeOctahedral(vertex.normal);
+  glm::vec2 tangent = encodeOctahedral(glm::vec3(vertex.tangent));
+
+  packed.pos[0]      = quantizeUnorm16(pos.x);
+  packed.pos[1]      = quantizeUnorm16(pos.y);
+  packed.pos[2]      = quantizeUnorm16(pos.z);
+  packed.pos[3]      = vertex.tangent.w < 0.0f ? 0 : 65535;
+  packed.normal[0]   = quantizeSnorm16(normal.x);
+  packed.normal[1]   = quantizeSnorm16(normal.y);
+  packed.tangent[0]  = quantizeSnorm16(tangent.x);
+  packed.tangent[1]  = quantizeSnorm16(tangent.y);
+  packed.texCoord[0] = quantizeUnorm16(texCoord.x);
+  packed.texCoord[1] = quantizeUnorm16(texCoord.y);
+
+  for (int c=0; c < 3; c++) {
+    packed.color[c] = static_cast<uint8_t>(
+      std::clamp(vertex.color[c], 0.0f, 1.0f) * 255.0f + 0.5f
+    );
+  }
+  packed.color[3] = 255;
+
+  return packed;
+}
+
+// Vertices of a mapped mesh, decoded to scratch if they're compressed
+const Vertex* getMappedVertices(
+  const MappedVertices& mapped,
+  std::vector<Vertex>&  scratch
+) {
+  if (mapped.data) {
+    return mapped.data;
+  }
+
+  scratch.resize(mapped.count);
+  Excal::MeshCodec::decodeVertices(
+    mapped.encodedData, mapped.encodedSize, mapped.count, sizeof(Vertex), scratch.data()
+  );
+
+  return scratch.data();
+}
+
+// Calls fn(i, vertex) for every vertex of a mesh, reading the vertices of
+// GLB meshes from their mapped file one at a time
+template <typename F>
+void forEachVertex(const Mesh& mesh, F&& fn)
+{
+  if (mesh.mappedVertices.file) {
+    std::vector<Vertex> scratch;
+    const Vertex* vertices = getMappedVertices(mesh.mappedVertices, scratch);
+
+    for (size_t i=0; i < mesh.mappedVertices.count; i++) {
+      fn(i, vertices[i]);
+    }
+    return;
+  }
+
+  if (!mesh.glbVertices.file) {
+    for (size_t i=0; i < mesh.vertices.size(); i++) {
+      fn(i, mesh.vertices[i]);
+    }
+    return;
+  }
+
+  for (size_t i=0; i < mesh.glbVertices.vertexCount; i++) {
+    fn(i, Excal::Gltf::readVertex(mesh.glbVertices, i));
+  }
+}
+
+// Positions read by optimization passes. Points into the vertices of
+// OBJ meshes or the mapped file of GLB meshes, and is only copied into
+// scratch for GLB meshes with several primitives
+const float* getPositions(
+  const Mesh&         mesh,
+  std::vector<float>& scratch,
+  size_t&             positionStride
+) {
+  if (mesh.mappedVertices.file) {
+    positionStride = sizeof(Vertex);
+
+    if (mesh.mappedVertices.data) {
+      return mesh.mappedVertices.count == 0 ? nullptr : &mesh.mappedVertices.data[0].pos.x;
+    }
+
+    // Only positions are needed, so vertices are decoded and gathered
+    std::vector<Vertex> vertices;
+    getMappedVertices(mesh.mappedVertices, vertices);
+
+    scratch.resize(vertices.size() * 3);
+    positionStride = 3 * sizeof(float);
+
+    for (size_t i=0; i < vertices.size(); i++) {
+      scratch[i*3 + 0] = vertices[i].pos.x;
+      scratch[i*3 + 1] = vertices[i].pos.y;
+      scratch[i*3 + 2] = vertices[i].pos.z;
+    }
+
+    return scratch.data();
+  }
+
+  if (!mesh.glbVertices.file) {
+    positionStride = sizeof(Vertex);
+    return mesh.vertices.empty() ? nullptr : &mesh.vertices[0].pos.x;
+  }
+
+  if (const float* positions = Excal::Gltf::getPositions(mesh.glbVertices, positionStride)) {
+    return positions;
+  }
+
+  scratch.resize(mesh.glbVertices.vertexCount * 3);
+  positionStride = 3 * sizeof(float);
+
+  forEachVertex(mesh, [&](size_t i, const Vertex& vertex) {
+    scratch[i*3 + 0] = vertex.pos.x;
+    scratch[i*3 + 1] = vertex.pos.y;
+    scratch[i*3 + 2] = vertex.pos.z;
+  });
+
+  return scratch.data();
+}
+}
+
+ModelData weldVertices(
+  const Excal::ObjParser::ObjData& objData
+) {
+  // Texcoords are compared after being flipped, like in the final vertex
+  std::vector<float> flippedTexcoords(objData.texcoords);
+  for (size_t i=1; i < flippedTexcoords.size(); i += 2) {
+    flippedTexcoords[i] = 1.0f - flippedTexcoords[i];
+  }
+
+  // Two corners make the same vertex if and only if their canonical
+  // indices match, which gives the same result as comparing full vertices
+  // Missing texcoords and normals are 0 in the vertex, so they use the
+  // canonical index of a zero element
+  const auto canonicalPositions = getCanonicalIndices<3>(objData.positions);
+  const auto canonicalTexcoords = getCanonicalIndices<2>(flippedTexcoords);
+  const auto canonicalNormals   = getCanonicalIndices<3>(objData.normals);
+
+  flippedTexcoords = std::vector<float>();
+
+  ModelData modelData;
+  modelData.indices.resize(objData.corners.size());
+
+  // Most vertices are only split along texture seams, so there are
+  // usually about as many vertices as the larger attribute array
+  const size_t expectedVertices = std::max(
+    objData.positions.size() / 3, objData.texcoords.size() / 2
+  );
+
+  modelData.vertices.reserve(expectedVertices);
+  IndexTable<3> uniqueVertices(expectedVertices);
+
+  for (size_t i=0; i < objData.corners.size(); i++) {
+    const auto& corner = objData.corners[i];
+
+    const IndexTable<3>::Key key = {
+      canonicalPositions[corner.vertexIndex],
+      corner.texcoordIndex >= 0
+        ? canonicalTexcoords[corner.texcoordIndex]
+        : canonicalTexcoords.back(),
+      corner.normalIndex >= 0
+        ? canonicalNormals[corner.normalIndex]
+        : canonicalNormals.back()
+    };
+
+    // Vertices with a NaN are never welded, like with Vertex::operator==
+    const bool     hasNan   = std::find(key.begin(), key.end(), noCanonicalIndex) != key.end();
+    const uint32_t newIndex = modelData.vertices.size();
+    const uint32_t index    = hasNan ? newIndex
+                                     : uniqueVertices.findOrInsert(key, newIndex);
+
+    if (index == newIndex) {
+      modelData.vertices.push_back(getVertex(objData, corner));
+      addBounds(modelData.vertices.back(), modelData);
+    }
+
+    modelData.indices[i] = index;
+  }
+
+  return modelData;
+}
+
+ModelData weldVerticesHashed(
+  const Excal::ObjParser::ObjData& objData
+) {
+  std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+
+  ModelData modelData;
+  modelData.indices.reserve(objData.corners.size());
+
+  for (const auto& corner : objData.corners) {
+    addVertex(getVertex(objData, corner), uniqueVertices, modelData);
+  }
+
+  return modelData;
+}
+
 ModelData loadModel(
   const std::string& modelPath
+) {
+  const auto objData = Excal::ObjParser::parseObj(modelPath);
+  auto modelData     = weldVertices(objData);
+
+  if (!hasNormals(objData)) {
+    generateNormals(modelData.indices, modelData.vertices, true);
+  }
+  generateTangents(modelData.indices, modelData.vertices);
+
+  return modelData;
+}
+
+ModelData loadModelTinyObj(
+  const std::string& modelPath
 ) {
   tinyobj::attrib_t attrib;  // Holds positions, normals, and texture coordinates
   std::vector<tinyobj::shape_t> shapes;
@@ -27,6 +556,7 @@ ModelData loadModel(
   }
 
   std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+  bool normalsLoaded = true;
 
   ModelData modelData;
   // Iterate over the shapes vertices and add them to the argument `modelData`
@@ -41,24 +571,207 @@ ModelData loadModel(
         attrib.vertices[3 * index.vertex_index + 2]
       };
 
-      vertex.texCoord = {
-            attrib.texcoords[2 * index.texcoord_index + 0],
-        1.0-attrib.texcoords[2 * index.texcoord_index + 1] // Flip vertical coordinate
-      };
+      if (index.texcoord_index >= 0) {
+        vertex.texCoord = {
+               attrib.texcoords[2 * index.texcoord_index + 0],
+          1.0f-attrib.texcoords[2 * index.texcoord_index + 1] // Flip vertical coordinate
+        };
+      }
+
+      if (index.normal_index >= 0) {
+        vertex.normal = {
+          attrib.normals[3 * index.normal_index + 0],
+          attrib.normals[3 * index.normal_index + 1],
+          attrib.normals[3 * index.normal_index + 2]
+        };
+      } else {
+        normalsLoaded = false;
+      }
 
       // Not handled by this model loader
-      vertex.color  = {1.0f, 1.0f, 1.0f};
-      vertex.normal = {1.0f, 1.0f, 1.0f};
+      vertex.color = {1.0f, 1.0f, 1.0f};
+
+      addVertex(vertex, uniqueVertices, modelData);
+    }
+  }
+
+  if (!normalsLoaded) {
+    generateNormals(modelData.indices, modelData.vertices, true);
+  }
+  generateTangents(modelData.indices, modelData.vertices);
+
+  return modelData;
+}
+
+void generateNormals(
+  const std::vector<uint32_t>& indices,
+  std::vector<Vertex>&         vertices,
+  const bool                   onlyMissing
+) {
+  auto isMissing = [](const Vertex& vertex) {
+    return vertex.normal == glm::vec3(0.0f);
+  };
+
+  if (onlyMissing && std::none_of(vertices.begin(), vertices.end(), isMissing)) {
+    return;
+  }
+
+  const size_t nVertices  = vertices.size();
+  const size_t nTriangles = indices.size() / 3;
+
+  // Index of the first vertex with the same position as each vertex
+  std::vector<uint32_t> positionIndices(nVertices);
+  IndexTable<3> uniquePositions(nVertices);
+
+  for (size_t i=0; i < nVertices; i++) {
+    const auto& pos = vertices[i].pos;
+    positionIndices[i] = uniquePositions.findOrInsert(
+      { floatKey(pos.x), floatKey(pos.y), floatKey(pos.z) }, i
+    );
+  }
+
+  // Length of the cross product is twice the triangle's area
+  std::vector<glm::vec3> faceNormals(nTriangles);
+
+  parallelForRange(nTriangles, [&](size_t begin, size_t end) {
+    for (size_t i=begin; i < end; i++) {
+      const glm::vec3& p0 = vertices[indices[i*3 + 0]].pos;
+      const glm::vec3& p1 = vertices[indices[i*3 + 1]].pos;
+      const glm::vec3& p2 = vertices[indices[i*3 + 2]].pos;
+
+      faceNormals[i] = glm::cross(p1 - p0, p2 - p0);
+    }
+  });
+
+  // Triangles around each position, so that positions can be summed in
+  // parallel without sharing writes
+  std::vector<uint32_t> triangleOffsets(nVertices + 1, 0);
+
+  for (const uint32_t index : indices) {
+    triangleOffsets[positionIndices[index] + 1]++;
+  }
 
-      if (uniqueVertices.count(vertex) == 0) {
-        uniqueVertices[vertex] = static_cast<uint32_t>(modelData.vertices.size());
-        modelData.vertices.push_back(vertex);
+  for (size_t i=0; i < nVertices; i++) {
+    triangleOffsets[i + 1] += triangleOffsets[i];
+  }
+
+  std::vector<uint32_t> adjacentTriangles(nTriangles * 3);
+  std::vector<uint32_t> cursors(triangleOffsets.begin(), triangleOffsets.end() - 1);
+
+  for (size_t i=0; i < nTriangles * 3; i++) {
+    adjacentTriangles[cursors[positionIndices[indices[i]]]++] = i / 3;
+  }
+
+  // Summed per position, apart from the vertices, since authored normals
+  // at the same position may be kept
+  std::vector<glm::vec3> positionNormals(nVertices);
+
+  parallelForRange(nVertices, [&](size_t begin, size_t end) {
+    for (size_t i=begin; i < end; i++) {
+      if (positionIndices[i] != i) {
+        continue;
+      }
+
+      glm::vec3 normal(0.0f);
+
+      for (uint32_t j=triangleOffsets[i]; j < triangleOffsets[i + 1]; j++) {
+        normal += faceNormals[adjacentTriangles[j]];
       }
 
-      modelData.indices.push_back(uniqueVertices[vertex]);
+      const float length = glm::length(normal);
+      positionNormals[i] = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+  });
+
+  // Copied in a second pass, since the first vertex at a position may be
+  // summed by another range
+  parallelForRange(nVertices, [&](size_t begin, size_t end) {
+    for (size_t i=begin; i < end; i++) {
+      if (!onlyMissing || isMissing(vertices[i])) {
+        vertices[i].normal = positionNormals[positionIndices[i]];
+      }
+    }
+  });
+}
+
+void generateTangents(
+  const std::vector<uint32_t>& indices,
+  std::vector<Vertex>&         vertices
+) {
+  std::vector<glm::vec3> tangents(vertices.size(),   glm::vec3(0.0f));
+  std::vector<glm::vec3> bitangents(vertices.size(), glm::vec3(0.0f));
+
+  for (size_t i=0; i + 2 < indices.size(); i += 3) {
+    const Vertex& v0 = vertices[indices[i + 0]];
+    const Vertex& v1 = vertices[indices[i + 1]];
+    const Vertex& v2 = vertices[indices[i + 2]];
+
+    const glm::vec3 edge1 = v1.pos - v0.pos;
+    const glm::vec3 edge2 = v2.pos - v0.pos;
+
+    // Texture coordinates are stored flipped vertically, so v is negated
+    // for bitangents to point up the texture, as normal maps expect
+    const float du1 = v1.texCoord.x - v0.texCoord.x;
+    const float du2 = v2.texCoord.x - v0.texCoord.x;
+    const float dv1 = v0.texCoord.y - v1.texCoord.y;
+    const float dv2 = v0.texCoord.y - v2.texCoord.y;
+
+    const float det = du1 * dv2 - du2 * dv1;
+    if (std::abs(det) < 1e-12f) {
+      continue;
+    }
+
+    const glm::vec3 tangent   = (edge1 * dv2 - edge2 * dv1) / det;
+    const glm::vec3 bitangent = (edge2 * du1 - edge1 * du2) / det;
+
+    for (size_t j=0; j < 3; j++) {
+      tangents[indices[i + j]]   += tangent;
+      bitangents[indices[i + j]] += bitangent;
     }
   }
 
+  for (size_t i=0; i < vertices.size(); i++) {
+    const glm::vec3& normal = vertices[i].normal;
+
+    // Gram-Schmidt orthogonalize against the normal
+    glm::vec3 tangent = tangents[i] - normal * glm::dot(normal, tangents[i]);
+
+    // Any direction perpendicular to the normal if texture coordinates
+    // don't define one
+    if (glm::length(tangent) < 1e-12f) {
+      tangent = std::abs(normal.x) < 0.9f
+                ? glm::cross(normal, glm::vec3(1.0f, 0.0f, 0.0f))
+                : glm::cross(normal, glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    const float length     = glm::length(tangent);
+    const float handedness = glm::dot(glm::cross(normal, tangent), bitangents[i]) < 0.0f
+                             ? -1.0f : 1.0f;
+
+    vertices[i].tangent = length > 0.0f
+                          ? glm::vec4(tangent / length, handedness)
+                          : glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+  }
+}
+
+ModelData loadModelCached(
+  const std::string& modelPath
+) {
+  // Key the cache on the source before parsing it, so that an edit made
+  // while the model is loading results in a stale (rather than wrong) cache
+  Excal::MeshCache::SourceKey sourceKey;
+  if (!Excal::MeshCache::getSourceKey(modelPath, sourceKey)) {
+    return loadModel(modelPath);
+  }
+
+  ModelData modelData;
+  if (Excal::MeshCache::readMeshCache(modelPath, sourceKey, modelData)) {
+    return modelData;
+  }
+
+  modelData = loadModel(modelPath);
+  Excal::MeshCache::writeMeshCache(modelPath, sourceKey, modelData);
+
   return modelData;
 }
 
@@ -67,17 +780,529 @@ Model createModel(
   const glm::vec3    position,
   const float        scale,
   const std::string& diffuseTexturePath,
-  const std::string& normalTexturePath
+  const std::string& normalTexturePath,
+  const ModelOptions& options
 ) {
-  auto modelData = loadModel(modelPath);
-
   return Model {
-    modelData.indices,
-    modelData.vertices,
+    Excal::MeshRegistry::getMesh(modelPath, options),
     diffuseTexturePath,
     normalTexturePath,
     position,
     scale
   };
 }
+
+void optimizeMesh(
+  Mesh&               mesh,
+  const ModelOptions& options,
+  const std::string&  name
+) {
+  // Other meshes draw from shared indices, so they can't be reordered here
+  if (mesh.sharedIndices) {
+    throw std::runtime_error("can't optimize " + name + ", its indices are shared");
+  }
+
+  const size_t vertexCount = getVertexCount(mesh);
+
+  std::vector<float> positionScratch;
+  size_t             positionStride;
+
+  const float* positions = getPositions(mesh, positionScratch, positionStride);
+
+  // Each LOD is simplified from the previous one, and shares its vertices
+  std::vector<std::vector<uint32_t>> lodIndices;
+  std::vector<float>                 lodErrors;
+
+  lodIndices.push_back(std::move(mesh.indices));
+  lodErrors.push_back(0.0f);
+
+  for (int i=1; i < options.lodCount; i++) {
+    const auto& previous = lodIndices.back();
+    const size_t target  = size_t(previous.size() / 3 * options.lodReduction) * 3;
+
+    float error = 0.0f;
+    auto indices = Excal::MeshOptimizer::simplify(
+      previous, positions, vertexCount, positionStride, target, FLT_MAX, &error
+    );
+
+    // Stop once locked borders and seams keep the mesh from getting
+    // at least halfway to the target
+    if (indices.size() > (previous.size() + target) / 2) {
+      break;
+    }
+
+    lodIndices.push_back(std::move(indices));
+
+    // Errors are measured against the previous LOD, so they add up
+    lodErrors.push_back(lodErrors.back() + error);
+  }
+
+  for (size_t i=0; i < lodIndices.size(); i++) {
+    auto& indices = lodIndices[i];
+    const auto lodName = i == 0 ? name : name + " LOD " + std::to_string(i);
+
+    if (options.optimizeVertexCache) {
+      // Analysis passes only run for their stats
+      Excal::MeshOptimizer::VertexCacheStats before;
+      if (options.printStats) {
+        before = Excal::MeshOptimizer::analyzeVertexCache(indices, vertexCount);
+      }
+
+      Excal::MeshOptimizer::optimizeVertexCache(indices, vertexCount);
+
+      if (options.printStats) {
+        const auto after = Excal::MeshOptimizer::analyzeVertexCache(
+          indices, vertexCount
+        );
+
+        std::cout << lodName << ": vertex cache ACMR "
+                  << before.acmr << " -> " << after.acmr << ", ATVR "
+                  << before.atvr << " -> " << after.atvr << std::endl;
+      }
+    }
+
+    // Reorders clusters of the vertex cache pass, so it needs to run after it
+    if (options.optimizeOverdraw) {
+      Excal::MeshOptimizer::OverdrawStats before;
+      if (options.printStats) {
+        before = Excal::MeshOptimizer::analyzeOverdraw(
+          indices, positions, vertexCount, positionStride
+        );
+      }
+
+      Excal::MeshOptimizer::optimizeOverdraw(
+        indices, positions, vertexCount, positionStride, options.overdrawThreshold
+      );
+
+      if (options.printStats) {
+        const auto after = Excal::MeshOptimizer::analyzeOverdraw(
+          indices, positions, vertexCount, positionStride
+        );
+
+        std::cout << lodName << ": overdraw "
+                  << before.overdraw << " -> " << after.overdraw << std::endl;
+      }
+    }
+  }
+
+  // LODs are stored one after another, from most to least detailed
+  mesh.lods.clear();
+
+  if (lodIndices.size() == 1) {
+    mesh.indices = std::move(lodIndices[0]);
+  } else {
+    mesh.indices.clear();
+
+    for (size_t i=0; i < lodIndices.size(); i++) {
+      mesh.lods.push_back({
+        static_cast<uint32_t>(mesh.indices.size()),
+        static_cast<uint32_t>(lodIndices[i].size()),
+        lodErrors[i]
+      });
+
+      mesh.indices.insert(
+        mesh.indices.end(), lodIndices[i].begin(), lodIndices[i].end()
+      );
+    }
+
+    auto getPosition = [&](size_t i) {
+      const float* position = reinterpret_cast<const float*>(
+        reinterpret_cast<const char*>(positions) + i * positionStride
+      );
+      return glm::vec3(position[0], position[1], position[2]);
+    };
+
+    glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+    for (size_t i=0; i < vertexCount; i++) {
+      boundsMin = glm::min(boundsMin, getPosition(i));
+      boundsMax = glm::max(boundsMax, getPosition(i));
+    }
+
+    mesh.boundsCenter   = (boundsMin + boundsMax) * 0.5f;
+    mesh.boundingRadius = 0.0f;
+
+    for (size_t i=0; i < vertexCount; i++) {
+      mesh.boundingRadius = std::max(
+        mesh.boundingRadius, glm::length(getPosition(i) - mesh.boundsCenter)
+      );
+    }
+
+    if (options.printStats) {
+      std::cout << name << ": LOD triangles";
+      for (const auto& lod : mesh.lods) {
+        std::cout << " " << lod.indexCount / 3 << " (error " << lod.error << ")";
+      }
+      std::cout << std::endl;
+    }
+  }
+
+  // Meshlets split each LOD's range without reordering triangles, so
+  // they should be built after triangle order is final
+  mesh.meshlets.clear();
+
+  if (options.buildMeshlets) {
+    if (mesh.lods.empty()) {
+      mesh.meshlets = Excal::MeshOptimizer::buildMeshlets(
+        mesh.indices, positions, vertexCount, positionStride, 0, mesh.indices.size()
+      );
+    }
+
+    for (auto& lod : mesh.lods) {
+      const auto meshlets = Excal::MeshOptimizer::buildMeshlets(
+        mesh.indices, positions, vertexCount, positionStride,
+        lod.firstIndex, lod.indexCount
+      );
+
+      lod.firstMeshlet = mesh.meshlets.size();
+      lod.meshletCount = meshlets.size();
+      mesh.meshlets.insert(mesh.meshlets.end(), meshlets.begin(), meshlets.end());
+    }
+
+    if (options.printStats && !mesh.meshlets.empty()) {
+      size_t vertexTotal = 0;
+      size_t indexTotal  = 0;
+
+      for (const auto& meshlet : mesh.meshlets) {
+        vertexTotal += meshlet.vertexCount;
+        indexTotal  += meshlet.indexCount;
+      }
+
+      std::cout << name << ": " << mesh.meshlets.size() << " meshlets, average "
+                << vertexTotal / float(mesh.meshlets.size()) << " vertices, "
+                << indexTotal / 3.0f / mesh.meshlets.size() << " triangles" << std::endl;
+    }
+  }
+
+  // Runs last, so vertex order follows the final triangle order
+  // LOD 0 comes first in the index buffer, so it decides the vertex order
+  if (options.optimizeVertexFetch) {
+    // Stats are for LOD 0, since LODs are never drawn one after another
+    auto getLod0Indices = [&]() {
+      const size_t count = mesh.lods.empty() ? mesh.indices.size()
+                                              : mesh.lods[0].indexCount;
+
+      return std::vector<uint32_t>(
+        mesh.indices.begin(), mesh.indices.begin() + count
+      );
+    };
+
+    Excal::MeshOptimizer::VertexFetchStats before;
+    if (options.printStats) {
+      before = Excal::MeshOptimizer::analyzeVertexFetch(
+        getLod0Indices(), vertexCount, sizeof(Vertex)
+      );
+    }
+
+    // Mapped vertices are read only, so they're copied to be reordered
+    if (mesh.mappedVertices.file) {
+      std::vector<Vertex> scratch;
+      const Vertex* vertices = getMappedVertices(mesh.mappedVertices, scratch);
+
+      mesh.vertices.assign(vertices, vertices + mesh.mappedVertices.count);
+      mesh.mappedVertices = {};
+    }
+
+    if (!mesh.glbVertices.file) {
+      Excal::MeshOptimizer::optimizeVertexFetch(mesh.indices, mesh.vertices);
+    } else {
+      // GLB vertices stay in the file, so only the order they're read in
+      // changes, through vertexOrder
+      auto& glbVertices = mesh.glbVertices;
+
+      const auto remap = Excal::MeshOptimizer::getVertexFetchRemap(
+        mesh.indices, vertexCount
+      );
+
+      size_t newVertexCount = 0;
+      for (auto newIndex : remap) {
+        newVertexCount += newIndex != UINT32_MAX;
+      }
+
+      std::vector<uint32_t> vertexOrder(newVertexCount);
+
+      for (size_t i=0; i < vertexCount; i++) {
+        if (remap[i] != UINT32_MAX) {
+          vertexOrder[remap[i]] = glbVertices.vertexOrder.empty()
+                                  ? i : glbVertices.vertexOrder[i];
+        }
+      }
+
+      for (auto& index : mesh.indices) {
+        index = remap[index];
+      }
+
+      glbVertices.vertexOrder = std::move(vertexOrder);
+      glbVertices.vertexCount = glbVertices.vertexOrder.size();
+    }
+
+    if (options.printStats) {
+      const auto after = Excal::MeshOptimizer::analyzeVertexFetch(
+        getLod0Indices(), getVertexCount(mesh), sizeof(Vertex)
+      );
+
+      std::cout << name << ": vertex fetch overfetch "
+                << before.overfetch << " -> " << after.overfetch << std::endl;
+    }
+  }
+}
+
+Lod selectLod(
+  const Model&     model,
+  const glm::vec3& cameraPos,
+  const float      pixelsPerUnit,
+  const float      maxPixelError
+) {
+  const Mesh& mesh = *model.mesh;
+
+  if (mesh.lods.empty()) {
+    return Lod{
+      0, static_cast<uint32_t>(getIndices(mesh).size()), 0.0f,
+      0, static_cast<uint32_t>(mesh.meshlets.size())
+    };
+  }
+
+  // Models rotate about position, so the sphere of a rotating model is
+  // grown to cover every rotation
+  const bool rotates = model.rotationsPerSecond != 0;
+
+  const glm::vec3 center = rotates
+                           ? model.position
+                           : model.position + mesh.boundsCenter * model.scale;
+
+  const float radius = rotates
+                       ? (glm::length(mesh.boundsCenter) + mesh.boundingRadius) * model.scale
+                       : mesh.boundingRadius * model.scale;
+
+  // Distance to the closest point of the model's bounding sphere
+  const float distance = std::max(glm::length(cameraPos - center) - radius, 1e-3f);
+
+  size_t lod = 0;
+
+  while (   lod + 1 < mesh.lods.size()
+         &&   mesh.lods[lod + 1].error * model.scale / distance * pixelsPerUnit
+           <= maxPixelError
+  ) {
+    lod++;
+  }
+
+  return mesh.lods[lod];
+}
+
+size_t getVertexCount(const Mesh& mesh)
+{
+  if (mesh.mappedVertices.file) {
+    return mesh.mappedVertices.count;
+  }
+
+  return mesh.glbVertices.file ? mesh.glbVertices.vertexCount : mesh.vertices.size();
+}
+
+const std::vector<uint32_t>& getIndices(const Mesh& mesh)
+{
+  return mesh.sharedIndices ? *mesh.sharedIndices : mesh.indices;
+}
+
+VertexQuantization getVertexQuantization(const Mesh& mesh)
+{
+  if (mesh.mappedVertices.file) {
+    return mesh.mappedVertices.quantization;
+  }
+
+  VertexBounds bounds;
+  forEachVertex(mesh, [&](size_t, const Vertex& vertex) {
+    bounds.add(vertex);
+  });
+
+  return bounds.getQuantization();
+}
+
+VertexQuantization getHeightQuantization(const Mesh& mesh)
+{
+  const size_t gridVertexCount = (size_t) mesh.gridWidth * mesh.gridHeight;
+  const size_t skirtCount      = 2 * ((size_t) mesh.gridWidth + mesh.gridHeight);
+  const size_t vertexCount     = getVertexCount(mesh);
+
+  if (   mesh.gridWidth < 2 || mesh.gridHeight < 2
+      || (vertexCount != gridVertexCount && vertexCount != gridVertexCount + skirtCount)
+  ) {
+    throw std::runtime_error("height vertices need a mesh with gridWidth and gridHeight set");
+  }
+
+  auto quantization = getVertexQuantization(mesh);
+
+  // x and z are read as the grid's columns and rows, not as unorm values
+  quantization.positionScale.x = 1.0f;
+  quantization.positionScale.z = 1.0f;
+
+  return quantization;
+}
+
+size_t getVertexSize(const std::string& vertexFormat)
+{
+  if (vertexFormat == "packed") {
+    return sizeof(PackedVertex);
+  }
+  if (vertexFormat == "height") {
+    return sizeof(HeightVertex);
+  }
+  return sizeof(Vertex);
+}
+
+void writeVertices(const Mesh& mesh, Vertex* dst)
+{
+  // Compressed vertices are decoded straight to dst
+  if (mesh.mappedVertices.encodedData) {
+    Excal::MeshCodec::decodeVertices(
+      mesh.mappedVertices.encodedData, mesh.mappedVertices.encodedSize,
+      mesh.mappedVertices.count, sizeof(Vertex), dst
+    );
+    return;
+  }
+
+  if (mesh.mappedVertices.file) {
+    memcpy(dst, mesh.mappedVertices.data, mesh.mappedVertices.count * sizeof(Vertex));
+    return;
+  }
+
+  if (!mesh.glbVertices.file) {
+    std::copy(mesh.vertices.begin(), mesh.vertices.end(), dst);
+    return;
+  }
+
+  forEachVertex(mesh, [&](size_t i, const Vertex& vertex) {
+    dst[i] = vertex;
+  });
+}
+
+void writePackedVertices(
+  const Mesh&               mesh,
+  const VertexQuantization& quantization,
+  PackedVertex*             dst
+) {
+  forEachVertex(mesh, [&](size_t i, const Vertex& vertex) {
+    dst[i] = packVertex(vertex, quantization);
+  });
+}
+
+void writeHeightVertices(
+  const Mesh&               mesh,
+  const VertexQuantization& quantization,
+  HeightVertex*             dst
+) {
+  forEachVertex(mesh, [&](size_t i, const Vertex& vertex) {
+    const float     height = (vertex.pos.y - quantization.positionOffset.y)
+                             / quantization.positionScale.y;
+    const glm::vec2 normal = encodeOctahedral(vertex.normal);
+
+    dst[i].height    = quantizeUnorm16(height);
+    dst[i].normal[0] = quantizeSnorm8(normal.x);
+    dst[i].normal[1] = quantizeSnorm8(normal.y);
+  });
+}
+
+std::vector<PackedVertex> packVertices(
+  const std::vector<Vertex>& vertices,
+  VertexQuantization&        quantization
+) {
+  VertexBounds bounds;
+  for (const auto& vertex : vertices) {
+    bounds.add(vertex);
+  }
+
+  quantization = bounds.getQuantization();
+
+  std::vector<PackedVertex> packedVertices(vertices.size());
+
+  for (size_t i=0; i < vertices.size(); i++) {
+    packedVertices[i] = packVertex(vertices[i], quantization);
+  }
+
+  return packedVertices;
+}
+
+std::vector<ModelLoadResult> loadModels(
+  const std::vector<ModelCreateInfo>& createInfos
+) {
+  std::vector<ModelLoadResult> results(createInfos.size());
+
+  // Models with the same mesh are grouped so each mesh is loaded by one
+  // task. A registry miss doesn't block other threads, so separate tasks
+  // would each load the mesh
+  std::unordered_map<std::string, size_t> meshIndices;
+  std::vector<size_t>                     firstCreateInfos;
+  std::vector<size_t>                     createInfoMeshes(createInfos.size());
+
+  for (size_t i=0; i < createInfos.size(); i++) {
+    const auto key = Excal::MeshRegistry::getMeshKey(
+      createInfos[i].modelPath, createInfos[i].options
+    );
+
+    auto [it, inserted] = meshIndices.emplace(key, firstCreateInfos.size());
+    if (inserted) {
+      firstCreateInfos.push_back(i);
+    }
+
+    createInfoMeshes[i] = it->second;
+  }
+
+  std::vector<std::shared_ptr<const Mesh>> meshes(firstCreateInfos.size());
+  std::vector<std::string>                 errors(firstCreateInfos.size());
+
+  Excal::getThreadPool().parallelFor(firstCreateInfos.size(), [&](size_t i) {
+    const auto& createInfo = createInfos[firstCreateInfos[i]];
+
+    try {
+      meshes[i] = Excal::MeshRegistry::getMesh(
+        createInfo.modelPath, createInfo.options
+      );
+    } catch (const std::exception& e) {
+      errors[i] = e.what();
+    }
+  });
+
+  for (size_t i=0; i < createInfos.size(); i++) {
+    const auto& createInfo = createInfos[i];
+    const size_t mesh      = createInfoMeshes[i];
+
+    if (!meshes[mesh]) {
+      results[i].error = "failed to load model " + createInfo.modelPath
+                       + ": " + errors[mesh];
+      continue;
+    }
+
+    results[i].model = Model {
+      meshes[mesh],
+      createInfo.diffuseTexturePath,
+      createInfo.normalTexturePath,
+      createInfo.position,
+      createInfo.scale
+    };
+    results[i].loaded = true;
+  }
+
+  return results;
+}
+
+std::vector<Model> createModels(
+  const std::vector<ModelCreateInfo>& createInfos
+) {
+  auto results = loadModels(createInfos);
+
+  std::vector<Model> models;
+  std::string errors;
+
+  for (auto& result : results) {
+    if (result.loaded) {
+      models.push_back(std::move(result.model));
+    } else {
+      errors += result.error + "\n";
+    }
+  }
+
+  if (!errors.empty()) {
+    throw std::runtime_error(errors);
+  }
+
+  return models;
+}
 }
@@ -1,32 +1,269 @@
 #pragma once
 
 #include "vector"
+#include <memory>
 #include "structs.h"
+#include "objParser.h"
+#include "meshOptimizer.h"
+#include "gltf.h"
 
 namespace Excal::Model
 {
 struct ModelData {
   std::vector<uint32_t> indices;
   std::vector<Vertex>   vertices;
+  glm::vec3             boundsMin = glm::vec3(0.0);
+  glm::vec3             boundsMax = glm::vec3(0.0);
 };
 
-struct Model {
+// Range of a model's indices that draws one level of detail
+struct Lod {
+  uint32_t firstIndex   = 0;
+  uint32_t indexCount   = 0;
+  float    error        = 0.0; // Max distance from the full detail surface
+  uint32_t firstMeshlet = 0;   // Meshlets that split the range, if built
+  uint32_t meshletCount = 0;
+};
+
+// Bounds that a model's packed vertices are quantized against
+// Quantized values are mapped back with offset + value * scale
+struct VertexQuantization {
+  glm::vec3 positionOffset = glm::vec3(0.0);
+  glm::vec3 positionScale  = glm::vec3(1.0);
+  glm::vec2 texCoordOffset = glm::vec2(0.0);
+  glm::vec2 texCoordScale  = glm::vec2(1.0);
+};
+
+// Vertices stored in a memory mapped file, such as an asset pack (see
+// assetPack.h), either as an array of Vertex in data, or encoded with
+// Excal::MeshCodec in encodedData
+struct MappedVertices {
+  std::shared_ptr<const Excal::Utils::MappedFile> file;
+  const Vertex*  data        = nullptr;
+  const uint8_t* encodedData = nullptr;
+  size_t         encodedSize = 0;
+  size_t         count       = 0;
+
+  // Stored with the vertices, so they aren't decoded just to find it
+  VertexQuantization quantization;
+};
+
+// Geometry of a model, shared by every model that draws it
+// The engine uploads each mesh once, however many models use it
+struct Mesh {
   std::vector<uint32_t> indices;
   std::vector<Vertex>   vertices;
+
+  // Indices shared with other meshes of the same topology (e.g. terrain
+  // chunks), which the engine uploads once for all of them
+  // indices is empty when this is set, use getIndices to read either
+  std::shared_ptr<const std::vector<uint32_t>> sharedIndices;
+
+  // Vertices of meshes loaded from GLB files or asset packs, read from
+  // their mapped file when they're uploaded
+  // vertices is empty when either file is set
+  Excal::Gltf::GlbVertices glbVertices;
+  MappedVertices           mappedVertices;
+
+  // Most to least detailed, all indexing vertices
+  // Empty if indices only hold the full detail mesh
+  std::vector<Lod> lods;
+
+  // Index ranges of indices, for culling parts of the mesh
+  std::vector<Excal::MeshOptimizer::Meshlet> meshlets;
+
+  // Bounding sphere of vertices, used to pick LODs
+  glm::vec3 boundsCenter   = glm::vec3(0.0);
+  float     boundingRadius = 0.0;
+
+  // Set for height map grids, which can be drawn with HeightVertex
+  // Vertices are gridWidth x gridHeight points 1 apart in x and z, row by
+  // row, optionally followed by skirt vertices going around the grid's
+  // edges (+x along the first row, then +z, -x and -z), below their edge
+  uint32_t gridWidth  = 0;
+  uint32_t gridHeight = 0;
+};
+
+struct Model {
+  std::shared_ptr<const Mesh> mesh;
   std::string diffuseTexturePath = "../textures/ivysaur_diffuse.jpg";
   std::string normalTexturePath  = "../textures/ivysaur_normal.jpg";
   glm::vec3   position           = glm::vec3(0.0);
   float       scale              = 1.0;
   float       rotationsPerSecond = 0.0;
+
+  // Hidden models are uploaded but not drawn
+  bool visible = true;
+
+  // Streamed models get their own vertex range, even if they share a mesh
+  // with other models, so Engine::updateModelMesh can replace their mesh
+  bool streamed = false;
+
+  // Set by the engine when it uploads packed or height vertices
+  VertexQuantization quantization;
+
+  // Passed to the shaders as is, for values only the app's shaders
+  // know the meaning of
+  glm::vec4 shaderParameters = glm::vec4(0.0);
+};
+
+// Optional optimization passes run on a model's mesh after it's loaded
+// Meshes are shared per path and options, so new options must be added
+// to the key in meshRegistry.cpp
+struct ModelOptions {
+  bool optimizeVertexCache = false; // Reorder triangles for vertex reuse
+  bool optimizeOverdraw    = false; // Sort triangle clusters front to back
+  bool optimizeVertexFetch = false; // Store vertices in first use order
+  bool buildMeshlets       = false; // Split each LOD into cullable meshlets
+  bool printStats          = false; // Print the effect of each pass
+
+  // Max ACMR increase allowed by the overdraw pass, 1.05 allows 5% more misses
+  float overdrawThreshold = 1.05f;
+
+  // Levels of detail to generate, including the full detail mesh
+  // Each level targets lodReduction times the triangles of the previous one
+  int   lodCount     = 1;
+  float lodReduction = 0.5f;
+};
+
+// Arguments of createModel, used to load many models at once
+struct ModelCreateInfo {
+  std::string  modelPath;
+  glm::vec3    position           = glm::vec3(0.0);
+  float        scale              = 1.0;
+  std::string  diffuseTexturePath = "../textures/ivysaur_diffuse.jpg";
+  std::string  normalTexturePath  = "../textures/ivysaur_normal.jpg";
+  ModelOptions options            = {};
+};
+
+struct ModelLoadResult {
+  Model       model;
+  bool        loaded = false;
+  std::string error;  // Names the model path if loading failed
 };
 
+// Parses and welds an OBJ model with Excal::ObjParser
+// Normals are read from the model, or generated if any corner lacks one,
+// and tangents are always generated
 ModelData loadModel(const std::string& modelPath);
 
+// Merges corners of a parsed OBJ model into unique vertices
+// Corners are compared by their (position, texcoord, normal) index tuples,
+// after mapping attributes with equal values to the same index
+ModelData weldVertices(const Excal::ObjParser::ObjData& objData);
+
+// Reference implementation of weldVertices that hashes full vertices
+ModelData weldVerticesHashed(const Excal::ObjParser::ObjData& objData);
+
+// Sets each vertex's normal to the sum of the face normals of triangles
+// around its position, weighted by area, so that vertices split along
+// texture seams are shaded smoothly. Runs on the engine's thread pool
+// With onlyMissing, authored normals are kept, and only vertices whose
+// normal is still 0 (missing from the source) get one
+void generateNormals(
+  const std::vector<uint32_t>& indices,
+  std::vector<Vertex>&         vertices,
+  const bool                   onlyMissing = false
+);
+
+// Sets each vertex's tangent from the texture coordinates of the triangles
+// that use it, orthogonalized against its normal
+// tangent.w is the handedness of the bitangent, cross(normal, tangent) * w
+void generateTangents(
+  const std::vector<uint32_t>& indices,
+  std::vector<Vertex>&         vertices
+);
+
+// Reference implementation of loadModel using tinyobjloader
+ModelData loadModelTinyObj(const std::string& modelPath);
+
+// Same as loadModel, but reads from and populates the binary mesh cache
+// stored next to the model (see meshCache.h)
+ModelData loadModelCached(const std::string& modelPath);
+
+// The model's mesh is loaded through Excal::MeshRegistry, so models created
+// from the same path and options share one mesh
 Model createModel(
   const std::string& modelPath,
   const glm::vec3    position,
   const float        scale,
   const std::string& diffuseTexturePath = "../textures/ivysaur_diffuse.jpg",
-  const std::string& normalTexturePath  = "../textures/ivysaur_normal.jpg"
+  const std::string& normalTexturePath  = "../textures/ivysaur_normal.jpg",
+  const ModelOptions& options           = {}
+);
+
+// Runs the passes enabled in options on a mesh's indices and vertices
+// Used by createModel, and can be used on procedurally generated meshes
+// name is only used to label printed stats
+void optimizeMesh(
+  Mesh&               mesh,
+  const ModelOptions& options,
+  const std::string&  name = "model"
+);
+
+// Picks the least detailed LOD whose error covers at most maxPixelError
+// pixels on screen, seen from cameraPos
+// pixelsPerUnit is the height in pixels of 1 unit at a distance of 1,
+// i.e. screenHeight / (2 * tan(fovY / 2))
+Lod selectLod(
+  const Model&     model,
+  const glm::vec3& cameraPos,
+  const float      pixelsPerUnit,
+  const float      maxPixelError
+);
+
+// Vertices of a mesh, wherever they're stored
+size_t getVertexCount(const Mesh& mesh);
+
+// Indices of a mesh, shared or not
+const std::vector<uint32_t>& getIndices(const Mesh& mesh);
+
+// Quantization that packs a mesh's vertices to PackedVertex, relative to
+// the bounds of their positions and texture coordinates
+// Read from the pack for mapped vertices, without reading the vertices
+VertexQuantization getVertexQuantization(const Mesh& mesh);
+
+// Quantization that packs a grid mesh's vertices to HeightVertex, where x
+// and z are the vertex's column and row, and y is relative to the bounds
+// of the heights. Throws if the mesh isn't a grid
+VertexQuantization getHeightQuantization(const Mesh& mesh);
+
+// Bytes per vertex of an EngineConfig::vertexFormat
+size_t getVertexSize(const std::string& vertexFormat);
+
+// Write getVertexCount(mesh) vertices to dst, e.g. a mapped staging buffer
+void writeVertices(const Mesh& mesh, Vertex* dst);
+
+void writePackedVertices(
+  const Mesh&               mesh,
+  const VertexQuantization& quantization,
+  PackedVertex*             dst
+);
+
+void writeHeightVertices(
+  const Mesh&               mesh,
+  const VertexQuantization& quantization,
+  HeightVertex*             dst
+);
+
+// Quantizes vertices to PackedVertex, relative to the bounds of their
+// positions and texture coordinates, which are written to quantization
+std::vector<PackedVertex> packVertices(
+  const std::vector<Vertex>& vertices,
+  VertexQuantization&        quantization
+);
+
+// Loads the mesh of every model on the engine's thread pool, once for
+// models with the same path and options
+// Results are in the same order as createInfos, and a failed load
+// doesn't stop the other models from loading
+std::vector<ModelLoadResult> loadModels(
+  const std::vector<ModelCreateInfo>& createInfos
+);
+
+// Same as loadModels, but throws an error listing every model
+// that failed to load (in the order of createInfos)
+std::vector<Model> createModels(
+  const std::vector<ModelCreateInfo>& createInfos
 );
 }
@@ -0,0 +1,438 @@
+#include "objParser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "threadPool.h"
+#include "utils.h"
+
+namespace Excal::ObjParser
+{
+namespace
+{
+// Smallest chunk worth handing to another thread
+const size_t minChunkSize = 256 * 1024;
+
+enum class LineType { eOther, ePosition, eTexcoord, eNormal, eFace };
+
+struct ElementCounts {
+  size_t positions = 0;
+  size_t texcoords = 0;
+  size_t normals   = 0;
+  size_t corners   = 0;
+};
+
+struct Chunk {
+  const char*   begin;
+  const char*   end;
+  ElementCounts counts;  // Elements in this chunk
+  ElementCounts offsets; // Elements in all previous chunks
+};
+
+inline bool isSpace(const char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool isDigit(const char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+inline const char* skipSpaces(const char* p, const char* end)
+{
+  while (p < end && isSpace(*p)) {
+    p++;
+  }
+
+  return p;
+}
+
+inline const char* findLineEnd(const char* p, const char* end)
+{
+  auto lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+  return lineEnd ? lineEnd : end;
+}
+
+// Returns the line type, and moves p to the start of the line's arguments
+LineType getLineType(const char*& p, const char* lineEnd)
+{
+  p = skipSpaces(p, lineEnd);
+
+  if (lineEnd - p < 2) {
+    return LineType::eOther;
+  }
+
+  LineType type = LineType::eOther;
+  size_t   keywordLength = 1;
+
+  if (p[0] == 'v') {
+    if (isSpace(p[1])) {
+      type = LineType::ePosition;
+    } else if (lineEnd - p > 2 && isSpace(p[2])) {
+      keywordLength = 2;
+
+      if      (p[1] == 't') { type = LineType::eTexcoord; }
+      else if (p[1] == 'n') { type = LineType::eNormal;   }
+    }
+  } else if (p[0] == 'f' && isSpace(p[1])) {
+    type = LineType::eFace;
+  }
+
+  p += keywordLength;
+
+  return type;
+}
+
+// Number of corners in a face line, excluding its keyword
+size_t countFaceVertices(const char* p, const char* lineEnd)
+{
+  size_t nVertices = 0;
+
+  while (true) {
+    p = skipSpaces(p, lineEnd);
+
+    if (p == lineEnd || *p == '#') {
+      return nVertices;
+    }
+
+    nVertices++;
+
+    while (p < lineEnd && !isSpace(*p)) {
+      p++;
+    }
+  }
+}
+
+ElementCounts countElements(const char* begin, const char* end)
+{
+  ElementCounts counts;
+
+  for (const char* line = begin; line < end;) {
+    const char* lineEnd = findLineEnd(line, end);
+    const char* p       = line;
+
+    switch (getLineType(p, lineEnd)) {
+      case LineType::ePosition: counts.positions++; break;
+      case LineType::eTexcoord: counts.texcoords++; break;
+      case LineType::eNormal:   counts.normals++;   break;
+      case LineType::eFace: {
+        const size_t nVertices = countFaceVertices(p, lineEnd);
+        if (nVertices >= 3) {
+          counts.corners += (nVertices - 2) * 3;
+        }
+        break;
+      }
+      default: break;
+    }
+
+    line = lineEnd < end ? lineEnd + 1 : end;
+  }
+
+  return counts;
+}
+
+int32_t parseInt(const char*& p, const char* end)
+{
+  bool negative = false;
+
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
+
+  int64_t value = 0;
+  while (p < end && isDigit(*p)) {
+    value = value * 10 + (*p - '0');
+    p++;
+  }
+
+  return static_cast<int32_t>(negative ? -value : value);
+}
+
+// OBJ indices are one based, negative indices are relative to the
+// number of elements defined before the face. 0 means a missing index
+// (or one parseInt couldn't read), which is only allowed for optional
+// indices (texcoords and normals), and resolves to -1
+int32_t resolveIndex(
+  const int32_t index,
+  const size_t  nDefined,
+  const size_t  nTotal,
+  const bool    optional
+) {
+  if (index == 0) {
+    if (!optional) {
+      throw std::runtime_error("face index out of range in OBJ file");
+    }
+    return -1;
+  }
+
+  const int64_t resolved = index > 0 ? int64_t(index) - 1
+                                     : int64_t(nDefined) + index;
+
+  if (resolved < 0 || resolved >= int64_t(nTotal)) {
+    throw std::runtime_error("face index out of range in OBJ file");
+  }
+
+  return static_cast<int32_t>(resolved);
+}
+
+const char* parseFloats(const char* p, const char* end, float* out, const int n)
+{
+  for (int i=0; i < n; i++) {
+    p = skipSpaces(p, end);
+    out[i] = parseFloat(p, end);
+  }
+
+  return p;
+}
+
+void parseChunk(
+  const Chunk&         chunk,
+  const ElementCounts& totals,
+  ObjData&             objData
+) {
+  float*    positions = objData.positions.data() + chunk.offsets.positions * 3;
+  float*    texcoords = objData.texcoords.data() + chunk.offsets.texcoords * 2;
+  float*    normals   = objData.normals.data()   + chunk.offsets.normals   * 3;
+  ObjIndex* corners   = objData.corners.data()   + chunk.offsets.corners;
+
+  // Elements defined so far, used to resolve relative indices
+  ElementCounts defined = chunk.offsets;
+
+  std::vector<ObjIndex> polygon;
+
+  for (const char* line = chunk.begin; line < chunk.end;) {
+    const char* lineEnd = findLineEnd(line, chunk.end);
+    const char* p       = line;
+
+    switch (getLineType(p, lineEnd)) {
+      case LineType::ePosition:
+        parseFloats(p, lineEnd, positions, 3);
+        positions += 3;
+        defined.positions++;
+        break;
+
+      case LineType::eTexcoord:
+        parseFloats(p, lineEnd, texcoords, 2);
+        texcoords += 2;
+        defined.texcoords++;
+        break;
+
+      case LineType::eNormal:
+        parseFloats(p, lineEnd, normals, 3);
+        normals += 3;
+        defined.normals++;
+        break;
+
+      case LineType::eFace: {
+        polygon.clear();
+
+        while (true) {
+          p = skipSpaces(p, lineEnd);
+
+          if (p == lineEnd || *p == '#') {
+            break;
+          }
+
+          // v, v/vt, v//vn, or v/vt/vn
+          int32_t v = parseInt(p, lineEnd), vt = 0, vn = 0;
+
+          if (p < lineEnd && *p == '/') {
+            p++;
+            vt = parseInt(p, lineEnd);
+
+            if (p < lineEnd && *p == '/') {
+              p++;
+              vn = parseInt(p, lineEnd);
+            }
+          }
+
+          polygon.push_back({
+            resolveIndex(v,  defined.positions, totals.positions, false),
+            resolveIndex(vt, defined.texcoords, totals.texcoords, true),
+            resolveIndex(vn, defined.normals,   totals.normals,   true)
+          });
+
+          // Skip anything unexpected in the token
+          while (p < lineEnd && !isSpace(*p)) {
+            p++;
+          }
+        }
+
+        // Fan triangulation, matching tinyobj for convex polygons
+        for (size_t i=1; i+1 < polygon.size(); i++) {
+          *corners++ = polygon[0];
+          *corners++ = polygon[i];
+          *corners++ = polygon[i+1];
+        }
+        break;
+      }
+
+      default: break;
+    }
+
+    line = lineEnd < chunk.end ? lineEnd + 1 : chunk.end;
+  }
+}
+}
+
+float parseFloat(const char*& cursor, const char* end)
+{
+  // Powers of ten that are exactly representable as doubles
+  static const double powersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  const char* p = cursor;
+  bool negative = false;
+
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
+
+  // Accumulate up to 19 significant digits, which fit in a uint64_t
+  uint64_t mantissa = 0;
+  int      nDigits  = 0;
+  int      exponent = 0;
+  bool     hasDigits = false;
+
+  while (p < end && isDigit(*p)) {
+    if (nDigits < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      nDigits += mantissa != 0;
+    } else {
+      exponent++;
+    }
+    hasDigits = true;
+    p++;
+  }
+
+  if (p < end && *p == '.') {
+    p++;
+
+    while (p < end && isDigit(*p)) {
+      if (nDigits < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        nDigits += mantissa != 0;
+        exponent--;
+      }
+      hasDigits = true;
+      p++;
+    }
+  }
+
+  if (!hasDigits) {
+    cursor = p;
+    return 0.0f;
+  }
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char* exponentStart = p++;
+    bool negativeExponent = false;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+      negativeExponent = *p == '-';
+      p++;
+    }
+
+    if (p < end && isDigit(*p)) {
+      int explicitExponent = 0;
+
+      while (p < end && isDigit(*p)) {
+        explicitExponent = std::min(explicitExponent * 10 + (*p - '0'), 1000);
+        p++;
+      }
+
+      exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    } else {
+      // Not an exponent, e.g. "1.0e"
+      p = exponentStart;
+    }
+  }
+
+  cursor = p;
+
+  double value = static_cast<double>(mantissa);
+
+  if (exponent < 0 && exponent >= -22) {
+    value /= powersOfTen[-exponent];
+  } else if (exponent > 0 && exponent <= 22) {
+    value *= powersOfTen[exponent];
+  } else if (exponent != 0) {
+    value *= std::pow(10.0, exponent);
+  }
+
+  return static_cast<float>(negative ? -value : value);
+}
+
+ObjData parseObj(const char* data, const size_t size)
+{
+  const char* end = data + size;
+
+  auto& threadPool = Excal::getThreadPool();
+
+  // Split into line aligned chunks, several per thread to balance load
+  const size_t maxChunks = threadPool.getThreadCount() * 4;
+  const size_t nChunks   = std::max<size_t>(
+    1, std::min(maxChunks, size / minChunkSize)
+  );
+
+  std::vector<Chunk> chunks;
+  const char* chunkBegin = data;
+
+  for (size_t i=1; i <= nChunks && chunkBegin < end; i++) {
+    const char* chunkEnd = i == nChunks ? end : data + size * i / nChunks;
+
+    if (chunkEnd < chunkBegin) {
+      chunkEnd = chunkBegin;
+    }
+
+    chunkEnd = chunkEnd < end ? findLineEnd(chunkEnd, end) : end;
+    chunkEnd = chunkEnd < end ? chunkEnd + 1 : end;
+
+    chunks.push_back({ chunkBegin, chunkEnd, {}, {} });
+    chunkBegin = chunkEnd;
+  }
+
+  // First pass: count elements so output can be allocated exactly once
+  threadPool.parallelFor(chunks.size(), [&](size_t i) {
+    chunks[i].counts = countElements(chunks[i].begin, chunks[i].end);
+  });
+
+  ElementCounts totals;
+
+  for (auto& chunk : chunks) {
+    chunk.offsets = totals;
+
+    totals.positions += chunk.counts.positions;
+    totals.texcoords += chunk.counts.texcoords;
+    totals.normals   += chunk.counts.normals;
+    totals.corners   += chunk.counts.corners;
+  }
+
+  ObjData objData;
+  objData.positions.resize(totals.positions * 3);
+  objData.texcoords.resize(totals.texcoords * 2);
+  objData.normals.resize(totals.normals * 3);
+  objData.corners.resize(totals.corners);
+
+  // Second pass: parse each chunk into its slice of the output
+  threadPool.parallelFor(chunks.size(), [&](size_t i) {
+    parseChunk(chunks[i], totals, objData);
+  });
+
+  return objData;
+}
+
+ObjData parseObj(const std::string& path)
+{
+  Excal::Utils::MappedFile file(path);
+
+  return parseObj(file.data(), file.size());
+}
+}
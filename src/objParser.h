@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+// Multithreaded Wavefront OBJ parser
+// The file is memory mapped and split into line aligned chunks that are
+// parsed in parallel. A first pass counts the elements in each chunk, so
+// the second pass can write straight into exactly sized output arrays
+// Only geometry is parsed (v, vt, vn, f), other statements are skipped
+namespace Excal::ObjParser
+{
+// Zero based indices into ObjData's arrays, -1 if the corner doesn't have one
+struct ObjIndex {
+  int32_t vertexIndex;
+  int32_t texcoordIndex;
+  int32_t normalIndex;
+};
+
+struct ObjData {
+  std::vector<float>    positions;  // x, y, z
+  std::vector<float>    texcoords;  // u, v
+  std::vector<float>    normals;    // x, y, z
+  std::vector<ObjIndex> corners;    // 3 per triangle, polygons are fan triangulated
+};
+
+ObjData parseObj(const std::string& path);
+
+ObjData parseObj(const char* data, const size_t size);
+
+// Locale independent float parser
+// Advances cursor past the parsed number, returns 0 if there is no number
+float parseFloat(const char*& cursor, const char* end);
+}
@@ -100,7 +100,8 @@ vk::Pipeline createGraphicsPipeline(
   const vk::SampleCountFlagBits& msaaSamples,
   const std::string&             vertShaderPath,
   const std::string&             fragShaderPath,
-  const std::string&             frontFace
+  const std::string&             frontFace,
+  const std::string&             vertexFormat
 ) {
   auto vertShaderModule = createShaderModule(device, vertShaderPath);
   auto fragShaderModule = createShaderModule(device, fragShaderPath);
@@ -129,8 +130,25 @@ vk::Pipeline createGraphicsPipeline(
     {}, vk::PrimitiveTopology::eTriangleList, VK_FALSE
   );
 
-  auto bindingDescription    = Vertex::getBindingDescription();
-  auto attributeDescriptions = Vertex::getAttributeDescriptions();
+  vk::VertexInputBindingDescription                bindingDescription;
+  std::vector<vk::VertexInputAttributeDescription> attributeDescriptions;
+
+  if (vertexFormat == "packed") {
+    const auto attributes = PackedVertex::getAttributeDescriptions();
+
+    bindingDescription = PackedVertex::getBindingDescription();
+    attributeDescriptions.assign(attributes.begin(), attributes.end());
+  } else if (vertexFormat == "height") {
+    const auto attributes = HeightVertex::getAttributeDescriptions();
+
+    bindingDescription = HeightVertex::getBindingDescription();
+    attributeDescriptions.assign(attributes.begin(), attributes.end());
+  } else {
+    const auto attributes = Vertex::getAttributeDescriptions();
+
+    bindingDescription = Vertex::getBindingDescription();
+    attributeDescriptions.assign(attributes.begin(), attributes.end());
+  }
 
   vk::PipelineVertexInputStateCreateInfo vertexInputInfo(
     {}, 1, &bindingDescription,
@@ -19,7 +19,8 @@ vk::Pipeline createGraphicsPipeline(
   const vk::SampleCountFlagBits& msaaSamples,
   const std::string&             vertShaderPath,
   const std::string&             fragShaderPath,
-  const std::string&             frontFace
+  const std::string&             frontFace,
+  const std::string&             vertexFormat
 );
 
 vk::ShaderModule createShaderModule(
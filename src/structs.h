@@ -39,6 +39,7 @@ struct Vertex {
   glm::vec3 color;
   glm::vec3 normal;
   glm::vec2 texCoord;
+  glm::vec4 tangent; // w is the handedness of the bitangent
 
   static vk::VertexInputBindingDescription getBindingDescription() {
     return vk::VertexInputBindingDescription(
@@ -46,8 +47,8 @@ struct Vertex {
     );
   }
 
-  static std::array<vk::VertexInputAttributeDescription, 4> getAttributeDescriptions() {
-    std::array<vk::VertexInputAttributeDescription, 4> attributeDescriptions;
+  static std::array<vk::VertexInputAttributeDescription, 5> getAttributeDescriptions() {
+    std::array<vk::VertexInputAttributeDescription, 5> attributeDescriptions;
 
     // Position
     attributeDescriptions[0] = vk::VertexInputAttributeDescription(
@@ -69,6 +70,11 @@ struct Vertex {
       3, 0, vk::Format::eR32G32Sfloat, offsetof(Vertex, texCoord)
     );
 
+    // Tangent
+    attributeDescriptions[4] = vk::VertexInputAttributeDescription(
+      4, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(Vertex, tangent)
+    );
+
     return attributeDescriptions;
   }
 
@@ -77,7 +83,8 @@ struct Vertex {
     return pos == other.pos &&
            color == other.color &&
            normal == other.normal &&
-           texCoord == other.texCoord;
+           texCoord == other.texCoord &&
+           tangent == other.tangent;
   }
 };
 
@@ -93,6 +100,87 @@ namespace std {
   };
 }
 
+// Compact vertex, 24 bytes instead of the 80 of Vertex
+// Positions and texture coordinates are unorm16 relative to the bounds of
+// their model (see Excal::Model::packVertices), and are dequantized with the
+// model's DynamicUniformBufferObject
+// Normals and tangents are octahedral encoded as snorm16, and colors are unorm8
+struct PackedVertex {
+  uint16_t pos[4]; // w is the tangent's handedness, 0 for -1 and 65535 for 1
+  uint8_t  color[4];
+  int16_t  normal[2];
+  uint16_t texCoord[2];
+  int16_t  tangent[2];
+
+  static vk::VertexInputBindingDescription getBindingDescription() {
+    return vk::VertexInputBindingDescription(
+      0, sizeof(PackedVertex), vk::VertexInputRate::eVertex
+    );
+  }
+
+  // Same locations as Vertex, but normals and tangents must be decoded by the shader
+  static std::array<vk::VertexInputAttributeDescription, 5> getAttributeDescriptions() {
+    std::array<vk::VertexInputAttributeDescription, 5> attributeDescriptions;
+
+    // Position
+    attributeDescriptions[0] = vk::VertexInputAttributeDescription(
+      0, 0, vk::Format::eR16G16B16A16Unorm, offsetof(PackedVertex, pos)
+    );
+
+    // Color
+    attributeDescriptions[1] = vk::VertexInputAttributeDescription(
+      1, 0, vk::Format::eR8G8B8A8Unorm, offsetof(PackedVertex, color)
+    );
+
+    // Normal
+    attributeDescriptions[2] = vk::VertexInputAttributeDescription(
+      2, 0, vk::Format::eR16G16Snorm, offsetof(PackedVertex, normal)
+    );
+
+    // Texture coordinates
+    attributeDescriptions[3] = vk::VertexInputAttributeDescription(
+      3, 0, vk::Format::eR16G16Unorm, offsetof(PackedVertex, texCoord)
+    );
+
+    // Tangent
+    attributeDescriptions[4] = vk::VertexInputAttributeDescription(
+      4, 0, vk::Format::eR16G16Snorm, offsetof(PackedVertex, tangent)
+    );
+
+    return attributeDescriptions;
+  }
+};
+
+// Vertex of a height map grid (see Excal::Model::Mesh::gridWidth), where
+// only y is stored and the shader finds x and z from gl_VertexIndex
+// Colors aren't stored either, so they must be derived from the height
+struct HeightVertex {
+  uint16_t height;
+  int8_t   normal[2]; // Octahedral encoded
+
+  static vk::VertexInputBindingDescription getBindingDescription() {
+    return vk::VertexInputBindingDescription(
+      0, sizeof(HeightVertex), vk::VertexInputRate::eVertex
+    );
+  }
+
+  static std::array<vk::VertexInputAttributeDescription, 2> getAttributeDescriptions() {
+    std::array<vk::VertexInputAttributeDescription, 2> attributeDescriptions;
+
+    // Height
+    attributeDescriptions[0] = vk::VertexInputAttributeDescription(
+      0, 0, vk::Format::eR16Unorm, offsetof(HeightVertex, height)
+    );
+
+    // Normal
+    attributeDescriptions[1] = vk::VertexInputAttributeDescription(
+      1, 0, vk::Format::eR8G8Snorm, offsetof(HeightVertex, normal)
+    );
+
+    return attributeDescriptions;
+  }
+};
+
 // Account for Vulkan aligment requirements
 struct UniformBufferObject {
   alignas(16) glm::mat4 view;
@@ -104,4 +192,17 @@ struct UniformBufferObject {
 
 struct DynamicUniformBufferObject {
   glm::mat4 model;
+
+  // Maps vertex positions and texture coordinates to model space
+  // Identity unless the engine uses packed or height vertices
+  glm::vec4 positionOffset    = glm::vec4(0.0);
+  glm::vec4 positionScale     = glm::vec4(1.0);
+  glm::vec4 texCoordTransform = glm::vec4(0.0, 0.0, 1.0, 1.0); // xy offset, zw scale
+
+  // Width and height of the mesh's grid, and its first vertex, which
+  // gl_VertexIndex includes. Only used with HeightVertex
+  glm::ivec4 heightGrid = glm::ivec4(0);
+
+  // Model::shaderParameters
+  glm::vec4 shaderParameters = glm::vec4(0.0);
 };
@@ -0,0 +1,160 @@
+#include "threadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+
+namespace Excal
+{
+ThreadPool::ThreadPool(const size_t nThreads)
+{
+  for (size_t i=0; i < nThreads; i++) {
+    workers.emplace_back([this] { workerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    stopping = true;
+  }
+
+  tasksAvailable.notify_all();
+
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::workerLoop()
+{
+  while (true) {
+    std::function<void()> task;
+
+    {
+      std::unique_lock<std::mutex> lock(tasksMutex);
+      tasksAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+
+      if (stopping && tasks.empty()) {
+        return;
+      }
+
+      task = std::move(tasks.front());
+      tasks.pop();
+    }
+
+    task();
+  }
+}
+
+bool ThreadPool::runPendingTask()
+{
+  std::function<void()> task;
+
+  {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+
+    if (tasks.empty()) {
+      return false;
+    }
+
+    task = std::move(tasks.front());
+    tasks.pop();
+  }
+
+  task();
+
+  return true;
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+  {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    tasks.push(std::move(task));
+  }
+
+  tasksAvailable.notify_one();
+}
+
+void ThreadPool::parallelFor(
+  const size_t                       count,
+  const std::function<void(size_t)>& fn
+) {
+  if (count == 0) {
+    return;
+  }
+
+  // State is shared with helper tasks, which may only get to run
+  // after parallelFor has already returned
+  struct Job {
+    std::atomic<size_t>             nextIndex{0};
+    std::atomic<size_t>             nFinished{0};
+    std::mutex                      errorMutex;
+    size_t                          errorIndex = SIZE_MAX;
+    std::exception_ptr              error;
+    std::function<void(size_t)>     fn;
+    size_t                          count;
+  };
+
+  auto job   = std::make_shared<Job>();
+  job->fn    = fn;
+  job->count = count;
+
+  auto runJob = [](const std::shared_ptr<Job>& job) {
+    size_t i;
+    while ((i = job->nextIndex.fetch_add(1)) < job->count) {
+      try {
+        job->fn(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(job->errorMutex);
+        if (i < job->errorIndex) {
+          job->errorIndex = i;
+          job->error      = std::current_exception();
+        }
+      }
+      job->nFinished.fetch_add(1);
+    }
+  };
+
+  // One helper per worker is enough, each helper keeps claiming indices
+  const size_t nHelpers = std::min(workers.size(), count - 1);
+
+  if (nHelpers > 0) {
+    {
+      std::lock_guard<std::mutex> lock(tasksMutex);
+      for (size_t i=0; i < nHelpers; i++) {
+        tasks.push([job, runJob] { runJob(job); });
+      }
+    }
+
+    tasksAvailable.notify_all();
+  }
+
+  runJob(job);
+
+  // Indices claimed by other threads may still be running
+  // Help with other queued work (e.g. nested parallelFor calls) meanwhile
+  while (job->nFinished.load() < count) {
+    if (!runPendingTask()) {
+      std::this_thread::yield();
+    }
+  }
+
+  if (job->error) {
+    std::rethrow_exception(job->error);
+  }
+}
+
+ThreadPool& getThreadPool()
+{
+  static ThreadPool threadPool(
+    std::max(1u, std::thread::hardware_concurrency())
+  );
+
+  return threadPool;
+}
+}
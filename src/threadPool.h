@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace Excal
+{
+// Fixed size pool of worker threads
+// Threads that wait on the pool (e.g. in parallelFor) execute queued work
+// while waiting, so parallelFor can be called from inside a pool task
+class ThreadPool
+{
+public:
+  ThreadPool(const size_t nThreads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&)            = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Calls fn(i) for every i in [0, count) and blocks until all calls return
+  // If any call throws, the exception from the lowest index is rethrown
+  // after every other call has finished
+  void parallelFor(
+    const size_t                       count,
+    const std::function<void(size_t)>& fn
+  );
+
+  // Queues task to run on a worker thread and returns without waiting
+  // Exceptions thrown by task aren't caught, so it must handle its own
+  void submit(std::function<void()> task);
+
+  size_t getThreadCount() const { return workers.size(); }
+
+private:
+  std::vector<std::thread>          workers;
+  std::queue<std::function<void()>> tasks;
+  std::mutex                        tasksMutex;
+  std::condition_variable           tasksAvailable;
+  bool                              stopping = false;
+
+  void workerLoop();
+  bool runPendingTask();
+};
+
+// Pool shared by the engine and apps, sized to the number of hardware threads
+ThreadPool& getThreadPool();
+}
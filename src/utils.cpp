@@ -2,6 +2,18 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
 
 namespace Excal::Utils
 {
@@ -28,4 +40,123 @@ void alignedFree(void* data)
 	free(data);
 #endif
 }
+
+MappedFile::MappedFile(const std::string& path)
+{
+#if defined(_MSC_VER) || defined(__MINGW32__)
+  std::ifstream file(path, std::ios::ate | std::ios::binary);
+
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file " + path);
+  }
+
+  fileSize = (size_t) file.tellg();
+  fallbackBuffer.resize(fileSize);
+
+  file.seekg(0);
+  file.read(fallbackBuffer.data(), fileSize);
+
+  fileData = fallbackBuffer.data();
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+
+  if (fd == -1) {
+    throw std::runtime_error("failed to open file " + path);
+  }
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) == -1) {
+    close(fd);
+    throw std::runtime_error("failed to stat file " + path);
+  }
+
+  fileSize = (size_t) fileStat.st_size;
+
+  // mmap doesn't accept zero length mappings
+  if (fileSize > 0) {
+    void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (mapping == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("failed to map file " + path);
+    }
+
+    // Files are almost always read front to back
+    madvise(mapping, fileSize, MADV_SEQUENTIAL);
+    fileData = static_cast<const char*>(mapping);
+  }
+
+  // The mapping stays valid after its file descriptor is closed
+  close(fd);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+  if (fileData) {
+    munmap(const_cast<char*>(fileData), fileSize);
+  }
+#endif
+}
+
+bool getFileInfo(
+  const std::string& path,
+  uint64_t&          fileSize,
+  int64_t&           fileMtime
+) {
+  std::error_code ec;
+
+  fileSize = std::filesystem::file_size(path, ec);
+  if (ec) {
+    return false;
+  }
+
+  auto writeTime = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return false;
+  }
+
+  fileMtime = writeTime.time_since_epoch().count();
+
+  return true;
+}
+
+uint64_t hashBytes(const void* data, const size_t size)
+{
+  // Mixes one 64-bit word at a time, with the multiply and finalizer from MurmurHash2
+  const uint64_t m = 0xc6a4a7935bd1e995ull;
+  const int      r = 47;
+
+  uint64_t h = 0x9e3779b97f4a7c15ull ^ (size * m);
+
+  const char* bytes  = static_cast<const char*>(data);
+  const size_t words = size / 8;
+
+  for (size_t i=0; i < words; i++) {
+    uint64_t k;
+    memcpy(&k, bytes + i*8, 8);
+
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+
+    h ^= k;
+    h *= m;
+  }
+
+  // Fold in any trailing bytes. data may be null when size is 0
+  if (size % 8 != 0) {
+    uint64_t tail = 0;
+    memcpy(&tail, bytes + words*8, size - words*8);
+    h ^= tail;
+    h *= m;
+  }
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+
+  return h;
+}
 }
@@ -2,6 +2,10 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
 
 namespace Excal::Utils
 {
@@ -9,4 +13,34 @@ namespace Excal::Utils
 // There is currently no standard for this in C++ that works across all platforms and vendors, so we abstract this
 void* alignedAlloc(size_t size, size_t alignment);
 void  alignedFree(void* data);
+
+// Read-only view of a file's contents, backed by mmap where available
+// On other platforms the file is read into memory instead
+class MappedFile {
+public:
+  MappedFile(const std::string& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&)            = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* data() const { return fileData; }
+  size_t      size() const { return fileSize; }
+
+private:
+  const char*       fileData = nullptr;
+  size_t            fileSize = 0;
+  std::vector<char> fallbackBuffer;
+};
+
+// Size and last modification time of a file, used to detect stale caches
+// Returns false if the file can't be found
+bool getFileInfo(
+  const std::string& path,
+  uint64_t&          fileSize,
+  int64_t&           fileMtime
+);
+
+// Fast non-cryptographic 64-bit hash of a block of memory
+uint64_t hashBytes(const void* data, const size_t size);
 }
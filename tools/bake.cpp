@@ -0,0 +1,167 @@
+// excal-bake, writes the asset packs that Excal::AssetPack::mount reads
+//
+// Usage: excal-bake [options] -o <pack> <inputs...>
+// Inputs ending in .obj or .glb are welded and optimized into meshes,
+// and any other input is decoded as a texture
+// Meshes and textures are found by the path they're given with, so run
+// the baker from the directory the app runs from, with the same paths
+// that are passed to createModel
+//
+// Options, matching Excal::Model::ModelOptions:
+//   --vertex-cache              optimizeVertexCache
+//   --overdraw                  optimizeOverdraw
+//   --vertex-fetch              optimizeVertexFetch
+//   --meshlets                  buildMeshlets
+//   --overdraw-threshold <f>    overdrawThreshold
+//   --lods <n>                  lodCount
+//   --lod-reduction <f>         lodReduction
+// A mesh is only read from a pack by models created with the same options
+//
+//   --compress                  Encode mesh vertices and indices with
+//                               Excal::MeshCodec, for smaller packs
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "assetPack.h"
+#include "meshRegistry.h"
+#include "model.h"
+
+namespace
+{
+void printUsage()
+{
+  fprintf(stderr,
+    "Usage: excal-bake [options] -o <pack> <inputs...>\n"
+    "  --vertex-cache --overdraw --vertex-fetch --meshlets\n"
+    "  --overdraw-threshold <f> --lods <n> --lod-reduction <f>\n"
+    "  --compress\n"
+  );
+}
+
+bool isMeshPath(const std::string& path)
+{
+  for (const std::string extension : { ".obj", ".glb" }) {
+    if (   path.size() >= extension.size()
+        && path.compare(path.size() - extension.size(), extension.size(), extension) == 0
+    ) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+Excal::AssetPack::TextureAsset loadTexture(const std::string& texturePath)
+{
+  int width, height, channels;
+  stbi_uc* pixels = stbi_load(
+    texturePath.c_str(), &width, &height, &channels, STBI_rgb_alpha
+  );
+
+  if (!pixels) {
+    throw std::runtime_error("failed to load texture " + texturePath);
+  }
+
+  Excal::AssetPack::TextureAsset texture;
+  texture.path   = texturePath;
+  texture.width  = width;
+  texture.height = height;
+  texture.pixels.assign(pixels, pixels + size_t(width) * height * 4);
+
+  stbi_image_free(pixels);
+
+  return texture;
+}
+}
+
+int main(int argc, char** argv)
+{
+  Excal::Model::ModelOptions options;
+  std::string                packPath;
+  bool                       compress = false;
+  std::vector<std::string>   meshPaths;
+  std::vector<std::string>   texturePaths;
+
+  for (int i=1; i < argc; i++) {
+    const std::string arg = argv[i];
+    const bool hasValue   = i + 1 < argc;
+
+    if      (arg == "--vertex-cache") { options.optimizeVertexCache = true; }
+    else if (arg == "--overdraw")     { options.optimizeOverdraw    = true; }
+    else if (arg == "--vertex-fetch") { options.optimizeVertexFetch = true; }
+    else if (arg == "--meshlets")     { options.buildMeshlets       = true; }
+    else if (arg == "--compress")     { compress                    = true; }
+    else if (arg == "--overdraw-threshold" && hasValue) {
+      options.overdrawThreshold = std::strtof(argv[++i], nullptr);
+    } else if (arg == "--lods" && hasValue) {
+      options.lodCount = std::atoi(argv[++i]);
+    } else if (arg == "--lod-reduction" && hasValue) {
+      options.lodReduction = std::strtof(argv[++i], nullptr);
+    } else if (arg == "-o" && hasValue) {
+      packPath = argv[++i];
+    } else if (!arg.empty() && arg[0] == '-') {
+      printUsage();
+      return EXIT_FAILURE;
+    } else if (isMeshPath(arg)) {
+      meshPaths.push_back(arg);
+    } else {
+      texturePaths.push_back(arg);
+    }
+  }
+
+  if (packPath.empty() || (meshPaths.empty() && texturePaths.empty())) {
+    printUsage();
+    return EXIT_FAILURE;
+  }
+
+  try {
+    std::vector<Excal::AssetPack::MeshAsset>    meshes;
+    std::vector<Excal::AssetPack::TextureAsset> textures;
+
+    // Load on the thread pool, the same way the engine would at startup
+    std::vector<Excal::Model::ModelCreateInfo> createInfos;
+    for (const auto& path : meshPaths) {
+      Excal::Model::ModelCreateInfo createInfo;
+      createInfo.modelPath = path;
+      createInfo.options   = options;
+      createInfos.push_back(createInfo);
+    }
+
+    const auto models = Excal::Model::createModels(createInfos);
+
+    for (size_t i=0; i < models.size(); i++) {
+      meshes.push_back({
+        Excal::MeshRegistry::getMeshKey(meshPaths[i], options), models[i].mesh
+      });
+
+      printf("%s: %zu vertices, %zu triangles\n",
+        meshPaths[i].c_str(),
+        Excal::Model::getVertexCount(*models[i].mesh),
+        models[i].mesh->indices.size() / 3
+      );
+    }
+
+    for (const auto& path : texturePaths) {
+      textures.push_back(loadTexture(path));
+
+      printf("%s: %ux%u\n", path.c_str(), textures.back().width, textures.back().height);
+    }
+
+    Excal::AssetPack::writePack(packPath, meshes, textures, compress);
+
+    printf("Wrote %s\n", packPath.c_str());
+  } catch (const std::exception& e) {
+    fprintf(stderr, "excal-bake: %s\n", e.what());
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}